@@ -0,0 +1,415 @@
+/// @file       Bench.cpp
+/// @brief      Synthetic CSL library generator and catalog benchmark
+/// @details    Catalog-related performance (loading, matching, copying `.obj` files,
+///             reading the vertical offset) depends on the size and shape of the installed
+///             CSL library. To evaluate changes without distributing proprietary
+///             CSL sets, BenchGenerateCSL() writes any number of packages
+///             with `xsb_aircraft.txt` and `.obj` files, and BenchCSL()
+///             measures load times and matching throughput.\n
+///             Aircraft types are taken from `Doc8643.txt`. As there is no list of
+///             airlines in the resources, ICAO-like airline codes are synthesized.
+///             Generation is seeded, so the same parameters always produce the same library.\n
+///             BenchMatching() replays a corpus of match queries, e.g. taken
+///             from real traffic, reports throughput and latency percentiles,
+///             and serves as correctness oracle: With a fixed seed it writes
+///             or compares quality, candidate set, and chosen model of each query
+///             against a reference file.
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#include "XPMP2.h"
+#include "Bench.h"
+
+#include <random>
+
+#define BENCH_XSB_AIRCRAFT_TXT  "xsb_aircraft.txt"
+#define INFO_GEN_START          "Generating %lu synthetic CSL models in %lu packages with %lu vertices each into %s"
+#define INFO_GEN_DONE           "Generated %lu models, %lu .obj files in %.1fs"
+#define ERR_GEN_NO_DOC8643      "Doc8643 not loaded, call XPMPMultiplayerInit() first"
+#define ERR_GEN_WRITE           "Could not write %s"
+#define INFO_BENCH_LOAD         "Benchmark: %s load of %s took %.1fms, catalog has %lu models"
+#define INFO_BENCH_MATCH        "Benchmark: %lu matches against %lu models in %.1fms: %.0f matches/s"
+#define ERR_BENCH_QUERY_FILE    "Could not read match queries from %s"
+#define ERR_BENCH_REF_FILE      "Could not open matching reference file %s"
+#define INFO_BENCH_LATENCY      "Benchmark: %lu queries, %.0f queries/s, latency p50 %.1fus, p90 %.1fus, p99 %.1fus, max %.1fus"
+#define INFO_BENCH_REF_WRITTEN  "Benchmark: Matching reference written to %s"
+#define INFO_BENCH_REF_OK       "Benchmark: All %lu queries match the reference"
+#define WARN_BENCH_REF_DIFF     "Benchmark: Query %lu '%s' differs from reference: quality %d/%d, candidates %lu/%lu (%s), chosen '%s'/'%s'"
+#define WARN_BENCH_REF_SUMMARY  "Benchmark: Of %lu queries compared %lu differ in quality, %lu in candidates, %lu in the chosen model"
+#define BENCH_REF_HEADER        "# XPMP2 matching reference: quality, number of candidates, candidate hash, chosen model"
+
+namespace XPMP2 {
+
+/// Seed for generating libraries and match requests, so that results are reproducible
+constexpr unsigned BENCH_SEED = 8643;
+/// Number of distinct synthetic airline codes
+constexpr size_t BENCH_NUM_AIRLINES = 300;
+/// Maximum number of liveries sharing one `.obj` file
+constexpr size_t BENCH_MAX_LIVERIES = 32;
+/// Vertices per ring of the synthetic fuselage
+constexpr size_t BENCH_RING_VERT = 32;
+/// Share of match requests, which use a type/airline combination existing in the catalog
+constexpr double BENCH_EXISTING_SHARE = 0.7;
+
+/// Milliseconds passed since `tStart`
+static double BenchMsSince (std::chrono::steady_clock::time_point tStart)
+{
+    return std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now() - tStart).count();
+}
+
+/// Synthesize ICAO-like airline codes
+static std::vector<std::string> BenchAirlines (std::mt19937& rnd)
+{
+    std::uniform_int_distribution<int> letter('A', 'Z');
+    std::vector<std::string> vec;
+    vec.reserve(BENCH_NUM_AIRLINES);
+    while (vec.size() < BENCH_NUM_AIRLINES) {
+        std::string s(3, ' ');
+        for (char& c : s)
+            c = char(letter(rnd));
+        vec.push_back(s);
+    }
+    return vec;
+}
+
+/// @brief Write an `.obj` file: a cylindric fuselage of `nVert` vertices with its lowest point at `-vertOfs`
+/// @details Includes an animation on a dataRef listed in `Obj8DataRefs.txt`,
+///          so that replacing dataRefs has something to do.
+static bool BenchWriteObj (const std::string& path, size_t nVert, float vertOfs)
+{
+    std::ofstream f(path, std::ios::trunc);
+    if (!f) return false;
+    const size_t nIdx = nVert - nVert % 3;
+    const float r = 2.0f;
+    f << "I\n800\nOBJ\n\nTEXTURE synth.png\n";
+    f << "POINT_COUNTS " << nVert << " 0 0 " << nIdx << "\n\n";
+    f.setf(std::ios::fixed);
+    f.precision(4);
+    for (size_t i = 0; i < nVert; ++i) {
+        const float a = float(i % BENCH_RING_VERT) * 2.0f * float(PI) / float(BENCH_RING_VERT);
+        const float z = float(i / BENCH_RING_VERT) * 0.25f;
+        f << "VT " << r * std::cos(a) << ' ' << r * std::sin(a) + r - vertOfs << ' ' << z << ' '
+          << std::cos(a) << ' ' << std::sin(a) << " 0 "
+          << float(i % BENCH_RING_VERT) / float(BENCH_RING_VERT) << " 0.5\n";
+    }
+    f << '\n';
+    for (size_t i = 0; i < nIdx; ++i)
+        f << "IDX " << i << '\n';
+    f << "\nANIM_begin\n"
+         "ANIM_rotate 1 0 0 0 30 0 1 cjs/world_traffic/hstab_ratio\n"
+         "TRIS 0 " << nIdx << "\n"
+         "ANIM_end\n";
+    return bool(f);
+}
+
+/// One match query with its result
+struct BenchQueryTy {
+    std::string type, airline, livery;     ///< query parameters
+    int quality = 0;                        ///< resulting quality
+    size_t nCand = 0;                       ///< number of candidates of best quality
+    uint64_t candHash = 0;                  ///< fingerprint of the candidate set
+    std::string chosen;                     ///< name of the chosen model
+    
+    /// Query as text for log output
+    std::string Text () const { return type + ' ' + airline + ' ' + livery; }
+};
+
+/// Fingerprint of a candidate set, independent of its order (FNV-1a of the sorted, unique model names)
+static uint64_t BenchCandHash (std::vector<CSLModel*>& vecCand)
+{
+    std::sort(vecCand.begin(), vecCand.end(),
+              [](const CSLModel* a, const CSLModel* b){ return a->GetModelName() < b->GetModelName(); });
+    vecCand.erase(std::unique(vecCand.begin(), vecCand.end()), vecCand.end());
+    uint64_t h = 14695981039346656037ull;
+    for (const CSLModel* pMdl : vecCand) {
+        for (char c : pMdl->GetModelName()) {
+            h ^= uint64_t(uint8_t(c));
+            h *= 1099511628211ull;
+        }
+        h ^= uint64_t('\n');
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+/// Read match queries, one per line: `type [airline [livery]]`
+static bool BenchReadQueries (const char* path, std::vector<BenchQueryTy>& vecQ)
+{
+    std::ifstream f(path);
+    if (!f) return false;
+    std::string ln;
+    while (safeGetline(f, ln)) {
+        if (ln.empty() || ln[0] == '#') continue;
+        std::vector<std::string> tok = str_tokenize(ln, WHITESPACE);
+        if (tok.empty()) continue;
+        BenchQueryTy q;
+        q.type = tok[0];
+        if (tok.size() >= 2) q.airline = tok[1];
+        if (tok.size() >= 3) q.livery  = tok[2];
+        vecQ.push_back(std::move(q));
+    }
+    return true;
+}
+
+}       // namespace XPMP2
+
+//
+// MARK: Benchmark functions
+//
+
+using namespace XPMP2;
+
+// Write a synthetic CSL library
+const char* BenchGenerateCSL (const char* inFolder,
+                              size_t inNumModels,
+                              size_t inNumPackages,
+                              size_t inNumVertices)
+{
+    if (glob.mapDoc8643.empty())
+        return ERR_GEN_NO_DOC8643;
+    if (!inFolder || !inNumModels)
+        return "No folder or no models given";
+    inNumPackages = std::max<size_t>(inNumPackages, 1);
+    inNumVertices = std::max<size_t>(inNumVertices, 3);
+    LOG_MSG(logINFO, INFO_GEN_START, inNumModels, inNumPackages, inNumVertices, inFolder);
+    const auto tStart = std::chrono::steady_clock::now();
+    
+    // Collect aircraft types, synthesize airlines
+    std::mt19937 rnd(BENCH_SEED);
+    std::vector<std::string> vecTypes;
+    for (const mapDoc8643Ty::value_type& p : glob.mapDoc8643)
+        if (!p.second.empty())
+            vecTypes.push_back(p.first);
+    const std::vector<std::string> vecAirlines = BenchAirlines(rnd);
+    std::uniform_int_distribution<size_t> rndType(0, vecTypes.size()-1);
+    std::uniform_int_distribution<size_t> rndAirline(0, vecAirlines.size()-1);
+    std::uniform_int_distribution<size_t> rndLiveries(1, BENCH_MAX_LIVERIES);
+    std::uniform_real_distribution<float> rndVertOfs(1.0f, 5.0f);
+    
+    const std::string dirSep(XPLMGetDirectorySeparator());
+    std::string root(inFolder);
+    if (!root.empty() && root.back() != dirSep[0])
+        root += dirSep;
+    CreateDir(root);
+    
+    size_t nModels = 0, nObj = 0;
+    for (size_t pkg = 0; pkg < inNumPackages; ++pkg)
+    {
+        // Package names include the total number of models,
+        // so that libraries of different sizes can be loaded side by side
+        const std::string pkgName = "Synth" + std::to_string(inNumModels) + "_" + std::to_string(pkg+1);
+        const std::string pkgDir = root + pkgName + dirSep;
+        CreateDir(pkgDir);
+        const std::string xsbPath = pkgDir + BENCH_XSB_AIRCRAFT_TXT;
+        std::ofstream xsb(xsbPath, std::ios::trunc);
+        if (!xsb) {
+            LOG_MSG(logERR, ERR_GEN_WRITE, xsbPath.c_str());
+            return "Could not write xsb_aircraft.txt";
+        }
+        xsb << "EXPORT_NAME " << pkgName << "\n\n";
+        
+        // This package's share of models
+        const size_t nPkgModels = inNumModels / inNumPackages + (pkg < inNumModels % inNumPackages ? 1 : 0);
+        for (size_t m = 0; m < nPkgModels; ++nObj)
+        {
+            // One .obj file per type, shared by a number of liveries
+            const std::string& type = vecTypes[rndType(rnd)];
+            const std::string objName = type + "_" + std::to_string(nObj) + ".obj";
+            const float vertOfs = rndVertOfs(rnd);
+            if (!BenchWriteObj(pkgDir + objName, inNumVertices, vertOfs)) {
+                LOG_MSG(logERR, ERR_GEN_WRITE, (pkgDir + objName).c_str());
+                return "Could not write .obj file";
+            }
+            
+            // Models using this .obj file: the first without airline,
+            // every other one without VERT_OFFSET, so that it needs to be read from the .obj file
+            const size_t nLiveries = std::min(rndLiveries(rnd), nPkgModels - m);
+            for (size_t l = 0; l < nLiveries; ++l, ++m, ++nModels) {
+                const std::string airline = l ? vecAirlines[rndAirline(rnd)] : "";
+                xsb << "OBJ8_AIRCRAFT " << type << '_' << (airline.empty() ? "GEN" : airline) << '_' << nModels << '\n';
+                xsb << "OBJ8 SOLID YES " << pkgName << '/' << objName << '\n';
+                if (nModels % 2)
+                    xsb << "VERT_OFFSET " << vertOfs << '\n';
+                xsb << "MATCHES " << type;
+                if (!airline.empty())
+                    xsb << ' ' << airline;
+                xsb << "\n\n";
+            }
+        }
+    }
+    
+    LOG_MSG(logINFO, INFO_GEN_DONE, nModels, nObj, BenchMsSince(tStart) / 1000.0);
+    return "";
+}
+
+// Measure load times and matching throughput
+BenchCSLResultTy BenchCSL (const char* inCSLFolder, size_t inNumMatches)
+{
+    BenchCSLResultTy res;
+    if (!inCSLFolder)
+        return res;
+    
+    // Cold load: the models are new to the catalog
+    auto tStart = std::chrono::steady_clock::now();
+    CSLModelsLoad(inCSLFolder);
+    res.coldLoadMs = BenchMsSince(tStart);
+    res.numModels = glob.catCSLModels.size();
+    LOG_MSG(logINFO, INFO_BENCH_LOAD, "Cold", inCSLFolder, res.coldLoadMs, res.numModels);
+    
+    // Warm load: files are in the OS cache, all models are known already.
+    // Silence the expected warnings about duplicates meanwhile.
+    const logLevelTy lvl = glob.logLvl;
+    glob.logLvl = logERR;
+    tStart = std::chrono::steady_clock::now();
+    CSLModelsLoad(inCSLFolder);
+    res.warmLoadMs = BenchMsSince(tStart);
+    glob.logLvl = lvl;
+    LOG_MSG(logINFO, INFO_BENCH_LOAD, "Warm", inCSLFolder, res.warmLoadMs, res.numModels);
+    
+    // Prepare match requests: a mix of existing type/airline combinations and random ones
+    if (!inNumMatches || glob.catCSLModels.empty())
+        return res;
+    std::mt19937 rnd(BENCH_SEED);
+    std::vector<std::string> vecTypes;
+    for (const mapDoc8643Ty::value_type& p : glob.mapDoc8643)
+        vecTypes.push_back(p.first);
+    const std::vector<std::string> vecAirlines = BenchAirlines(rnd);
+    std::uniform_int_distribution<size_t> rndMdl(0, glob.catCSLModels.size()-1);
+    std::uniform_int_distribution<size_t> rndType(0, vecTypes.empty() ? 0 : vecTypes.size()-1);
+    std::uniform_int_distribution<size_t> rndAirline(0, vecAirlines.size()-1);
+    std::bernoulli_distribution rndExisting(BENCH_EXISTING_SHARE);
+    std::vector<std::pair<std::string,std::string> > vecReq;
+    vecReq.reserve(inNumMatches);
+    for (size_t i = 0; i < inNumMatches; ++i) {
+        if (vecTypes.empty() || rndExisting(rnd)) {
+            const CSLModel& mdl = glob.catCSLModels[rndMdl(rnd)];
+            vecReq.emplace_back(mdl.GetIcaoType(), mdl.GetIcaoAirline());
+        } else
+            vecReq.emplace_back(vecTypes[rndType(rnd)], vecAirlines[rndAirline(rnd)]);
+    }
+    
+    // Matching throughput
+    const std::string noLivery;
+    CSLModel* pMdl = nullptr;
+    tStart = std::chrono::steady_clock::now();
+    for (const auto& req : vecReq)
+        CSLModelMatching(req.first, req.second, noLivery, pMdl);
+    const double ms = BenchMsSince(tStart);
+    res.matchesPerSec = ms > 0.0 ? double(inNumMatches) * 1000.0 / ms : 0.0;
+    LOG_MSG(logINFO, INFO_BENCH_MATCH, inNumMatches, res.numModels, ms, res.matchesPerSec);
+    return res;
+}
+
+// Replay a corpus of match queries, measure, and compare to a reference
+BenchMatchResultTy BenchMatching (const char* inQueryFile,
+                                  const char* inRefFile,
+                                  bool inWriteRef,
+                                  unsigned inSeed)
+{
+    BenchMatchResultTy res;
+    std::vector<BenchQueryTy> vecQ;
+    if (!inQueryFile || !BenchReadQueries(inQueryFile, vecQ) || vecQ.empty()) {
+        LOG_MSG(logERR, ERR_BENCH_QUERY_FILE, inQueryFile ? inQueryFile : "<nullptr>");
+        return res;
+    }
+    
+    // Run all queries, timing each individually
+    std::srand(inSeed);                     // matching's random choice among equally good models
+    std::vector<double> vecUs;
+    vecUs.reserve(vecQ.size());
+    std::vector<CSLModel*> vecCand;
+    CSLModel* pMdl = nullptr;
+    for (BenchQueryTy& q : vecQ) {
+        const auto tStart = std::chrono::steady_clock::now();
+        q.quality = CSLModelMatching(q.type, q.airline, q.livery, pMdl, nullptr, &vecCand);
+        vecUs.push_back(BenchMsSince(tStart) * 1000.0);
+        q.candHash = BenchCandHash(vecCand);
+        q.nCand = vecCand.size();
+        if (pMdl) q.chosen = pMdl->GetModelName();
+    }
+    
+    // Throughput and latency percentiles
+    res.numQueries = vecQ.size();
+    const double totalUs = std::accumulate(vecUs.begin(), vecUs.end(), 0.0);
+    res.queriesPerSec = totalUs > 0.0 ? double(res.numQueries) * 1000000.0 / totalUs : 0.0;
+    std::sort(vecUs.begin(), vecUs.end());
+    auto percentile = [&vecUs](double p)
+    { return vecUs[std::min(vecUs.size()-1, size_t(p * double(vecUs.size())))]; };
+    res.p50Us = percentile(0.50);
+    res.p90Us = percentile(0.90);
+    res.p99Us = percentile(0.99);
+    res.maxUs = vecUs.back();
+    LOG_MSG(logINFO, INFO_BENCH_LATENCY, res.numQueries, res.queriesPerSec,
+            res.p50Us, res.p90Us, res.p99Us, res.maxUs);
+    
+    if (!inRefFile || !inRefFile[0])
+        return res;
+    
+    // Write a reference file
+    if (inWriteRef) {
+        std::ofstream f(inRefFile, std::ios::trunc);
+        if (!f) {
+            LOG_MSG(logERR, ERR_BENCH_REF_FILE, inRefFile);
+            return res;
+        }
+        f << BENCH_REF_HEADER << '\n';
+        for (const BenchQueryTy& q : vecQ)
+            f << q.quality << ' ' << q.nCand << ' ' << std::hex << q.candHash << std::dec << ' ' << q.chosen << '\n';
+        LOG_MSG(logINFO, INFO_BENCH_REF_WRITTEN, inRefFile);
+        return res;
+    }
+    
+    // Compare to a reference file
+    std::ifstream f(inRefFile);
+    if (!f) {
+        LOG_MSG(logERR, ERR_BENCH_REF_FILE, inRefFile);
+        return res;
+    }
+    std::string ln;
+    for (size_t i = 0; i < vecQ.size() && safeGetline(f, ln); ) {
+        if (ln.empty() || ln[0] == '#') continue;
+        const BenchQueryTy& q = vecQ[i++];
+        std::istringstream is(ln);
+        int refQuality = 0;
+        size_t refNCand = 0;
+        uint64_t refHash = 0;
+        std::string refChosen;
+        is >> refQuality >> refNCand >> std::hex >> refHash >> std::dec >> std::ws;
+        std::getline(is, refChosen);
+        
+        res.numCompared++;
+        const bool bQualDiff = refQuality != q.quality;
+        const bool bCandDiff = refNCand != q.nCand || refHash != q.candHash;
+        const bool bChoiceDiff = refChosen != q.chosen;
+        if (bQualDiff)   res.numQualityDiff++;
+        if (bCandDiff)   res.numCandidateDiff++;
+        if (bChoiceDiff) res.numChoiceDiff++;
+        if (bQualDiff || bCandDiff || bChoiceDiff)
+            LOG_MSG(logWARN, WARN_BENCH_REF_DIFF, i, q.Text().c_str(),
+                    q.quality, refQuality, q.nCand, refNCand,
+                    bCandDiff ? "differ" : "same",
+                    q.chosen.c_str(), refChosen.c_str());
+    }
+    if (res.numQualityDiff || res.numCandidateDiff || res.numChoiceDiff || res.numCompared != res.numQueries) {
+        LOG_MSG(logWARN, WARN_BENCH_REF_SUMMARY, res.numCompared,
+                res.numQualityDiff, res.numCandidateDiff, res.numChoiceDiff);
+    } else {
+        LOG_MSG(logINFO, INFO_BENCH_REF_OK, res.numCompared);
+    }
+    return res;
+}
@@ -0,0 +1,92 @@
+/// @file       Bench.h
+/// @brief      Synthetic CSL library generator and catalog benchmarks
+/// @details    Used by the XPMP2-Bench tool only, not part of the XPMP2 library.
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#ifndef _Bench_h_
+#define _Bench_h_
+
+#include <cstddef>
+
+/// @brief Writes a synthetic CSL library for benchmarking purposes
+/// @details Aircraft types are taken from `Doc8643.txt`, so call XPMPMultiplayerInit() first.
+///          Each `.obj` file is shared by up to 32 liveries of synthesized airlines.
+///          Every other model has no `VERT_OFFSET` line, so that the vertical offset needs to be read from the `.obj` file.
+///          Package names contain `inNumModels`, so libraries of different sizes
+///          (e.g. 1,000, 9,000, and 40,000 models) can be loaded one after the other
+///          to benchmark growing catalogs.
+/// @param inFolder Folder to write the packages to, created if needed
+/// @param inNumModels Total number of models to write
+/// @param inNumPackages Number of packages to distribute the models over
+/// @param inNumVertices Number of vertices per `.obj` file
+/// @return Empty string on success, otherwise a human-readable error message
+const char* BenchGenerateCSL (const char* inFolder,
+                              size_t inNumModels,
+                              size_t inNumPackages = 10,
+                              size_t inNumVertices = 1000);
+
+/// Results of BenchCSL()
+struct BenchCSLResultTy {
+    size_t  numModels       = 0;    ///< number of models in the catalog after loading
+    double  coldLoadMs      = 0.0;  ///< first load of the folder [ms]
+    double  warmLoadMs      = 0.0;  ///< second load of the same folder, with files in the OS cache and all models known already [ms]
+    double  matchesPerSec   = 0.0;  ///< model matching throughput
+};
+
+/// @brief Loads a CSL folder twice and measures load times and model matching throughput
+/// @details Match requests are a reproducible mix of type/airline combinations
+///          existing in the catalog and random ones. Results are also written to the log.
+/// @param inCSLFolder Root folder to load, e.g. as written by BenchGenerateCSL()
+/// @param inNumMatches Number of match requests to time
+BenchCSLResultTy BenchCSL (const char* inCSLFolder,
+                           size_t inNumMatches = 10000);
+
+/// Results of BenchMatching()
+struct BenchMatchResultTy {
+    size_t  numQueries      = 0;    ///< number of queries run
+    double  queriesPerSec   = 0.0;  ///< matching throughput
+    double  p50Us           = 0.0;  ///< median latency of a query [us]
+    double  p90Us           = 0.0;  ///< 90th percentile latency [us]
+    double  p99Us           = 0.0;  ///< 99th percentile latency [us]
+    double  maxUs           = 0.0;  ///< maximum latency [us]
+    size_t  numCompared     = 0;    ///< number of queries compared to the reference
+    size_t  numQualityDiff  = 0;    ///< number of queries with a different match quality than the reference
+    size_t  numCandidateDiff= 0;    ///< number of queries with a different set of best-quality candidates than the reference
+    size_t  numChoiceDiff   = 0;    ///< number of queries choosing a different model than the reference
+};
+
+/// @brief Model matching microbenchmark and correctness oracle
+/// @details Replays a corpus of match queries against the currently loaded catalog
+///          (real or written by BenchGenerateCSL()), measuring throughput
+///          and latency percentiles.\n
+///          Seeding the random choice among equally good models makes runs reproducible.
+///          Then, a reference run can be written, and later runs, e.g. after optimizing matching,
+///          be compared to it: Quality and candidate set must not change, while the chosen model
+///          might legitimately differ if candidates are enumerated in a different order.
+///          Differences are written to the log.
+/// @param inQueryFile Text file with one query per line: `<type> [<airline> [<livery>]]`, lines starting with `#` are ignored
+/// @param inRefFile (optional) Reference file to write or compare to
+/// @param inWriteRef `true`: write `inRefFile`, `false`: compare to `inRefFile`
+/// @param inSeed Seed for the random choice among equally good models
+BenchMatchResultTy BenchMatching (const char* inQueryFile,
+                                  const char* inRefFile = nullptr,
+                                  bool inWriteRef = false,
+                                  unsigned inSeed = 1);
+
+#endif
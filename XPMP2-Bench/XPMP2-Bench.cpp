@@ -0,0 +1,188 @@
+/// @file       XPMP2-Bench.cpp
+/// @brief      Benchmarks of CSL loading and model matching
+/// @details    Runs XPMP2's CSL loading and model matching outside X-Plane
+///             to measure them on real or synthetic CSL libraries:\n
+///             - `generate` writes a synthetic CSL library of a given size.\n
+///             - `csl` loads a CSL folder twice and measures cold/warm load time
+///               and model matching throughput.\n
+///             - `match` replays a corpus of match queries against the loaded CSL folders,
+///               measuring latency percentiles, and writes or compares to a reference
+///               to show that an optimization didn't change matching results.\n
+///             \n
+///             Exit code is 0 on success, 1 if the command failed or results differ
+///             from the reference, 2 for invalid arguments or if initialization failed.
+/// @see        Bench.h for the benchmark functions
+/// @see        XPLMStub.cpp for how the X-Plane API is replaced
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#include "XPMP2.h"
+#include "XPLMStub.h"
+#include "Bench.h"
+
+#include <cstdio>
+#include <unistd.h>
+
+using namespace XPMP2;
+
+/// Usage information
+static const char* USAGE =
+"Usage: XPMP2-Bench [options] <command> <args>\n"
+"  generate <folder> <models> [<packages> [<vertices>]]\n"
+"                         Write a synthetic CSL library into <folder>\n"
+"  csl <CSL folder> [<matches>]\n"
+"                         Load a CSL folder twice, measure load times and matching throughput\n"
+"  match <query file> <CSL folder> [<CSL folder>...]\n"
+"                         Replay match queries against the loaded CSL folders\n"
+"Options:\n"
+"  --xp <folder>          X-Plane's main folder (default: current folder)\n"
+"  --resources <folder>   XPMP2's Resources folder with Doc8643.txt, related.txt... (default: ./Resources)\n"
+"  --ref <file>           match: Compare results to this reference file\n"
+"  --write-ref            match: Write the reference file instead of comparing to it\n"
+"  --seed <n>             match: Seed for the random choice among equally good models (default: 1)\n"
+"  --verbose              Log info messages, too\n";
+
+/// Command line options
+struct OptionsTy {
+    std::string xpDir;                  ///< X-Plane's main folder
+    std::string resDir = "Resources";   ///< XPMP2's resource folder
+    std::string cmd;                    ///< command to execute
+    std::vector<std::string> vecArg;    ///< arguments of the command
+    std::string refFile;                ///< match: reference file
+    bool bWriteRef = false;             ///< match: write the reference file?
+    unsigned seed = 1;                  ///< match: seed for the random choice
+    bool bVerbose = false;              ///< log info messages?
+} gOpt;
+
+/// Configuration callback for XPMP2
+static int CBIntPrefsFunc (const char*, const char* _key, int _default)
+{
+    if (!strcmp(_key, XPMP_CFG_ITM_LOGLEVEL))       return gOpt.bVerbose ? logINFO : logWARN;
+    if (!strcmp(_key, XPMP_CFG_ITM_SHAREDCAT))      return 0;   // measure parsing, not reading a catalog
+    return _default;
+}
+
+/// Parse the command line, `false` if invalid
+static bool ParseArgs (int argc, char* argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string a (argv[i]);
+        const bool bHasParam = i+1 < argc;
+        if      (a == "--xp" && bHasParam)          gOpt.xpDir = argv[++i];
+        else if (a == "--resources" && bHasParam)   gOpt.resDir = argv[++i];
+        else if (a == "--ref" && bHasParam)         gOpt.refFile = argv[++i];
+        else if (a == "--write-ref")                gOpt.bWriteRef = true;
+        else if (a == "--seed" && bHasParam)        gOpt.seed = unsigned(std::atol(argv[++i]));
+        else if (a == "--verbose")                  gOpt.bVerbose = true;
+        else if (a.compare(0, 2, "--") == 0)        return false;
+        else if (gOpt.cmd.empty())                  gOpt.cmd = a;
+        else                                        gOpt.vecArg.push_back(a);
+    }
+    if (gOpt.bWriteRef && gOpt.refFile.empty())
+        return false;
+    if (gOpt.cmd == "generate") return gOpt.vecArg.size() >= 2 && gOpt.vecArg.size() <= 4;
+    if (gOpt.cmd == "csl")      return gOpt.vecArg.size() >= 1 && gOpt.vecArg.size() <= 2;
+    if (gOpt.cmd == "match")    return gOpt.vecArg.size() >= 2;
+    return false;
+}
+
+/// Make a path absolute, without trailing separator
+static std::string AbsPath (const std::string& path)
+{
+    std::string ret = path;
+    if (ret.empty() || ret[0] != '/') {
+        char cwd[1024] = "";
+        if (getcwd(cwd, sizeof(cwd)))
+            ret = std::string(cwd) + '/' + ret;
+    }
+    while (ret.size() > 1 && ret.back() == '/')
+        ret.pop_back();
+    return ret;
+}
+
+/// Numeric argument `i` of the command, or `def` if not given
+static size_t NumArg (size_t i, size_t def)
+{
+    return i < gOpt.vecArg.size() ? size_t(std::atol(gOpt.vecArg[i].c_str())) : def;
+}
+
+/// Execute the command, returns the exit code
+static int RunCommand ()
+{
+    if (gOpt.cmd == "generate") {
+        const char* res = BenchGenerateCSL(AbsPath(gOpt.vecArg[0]).c_str(),
+                                           NumArg(1, 0), NumArg(2, 10), NumArg(3, 1000));
+        if (res[0]) {
+            fprintf(stderr, "%s\n", res);
+            return 1;
+        }
+        return 0;
+    }
+
+    if (gOpt.cmd == "csl") {
+        const BenchCSLResultTy r = BenchCSL(AbsPath(gOpt.vecArg[0]).c_str(), NumArg(1, 10000));
+        printf("%lu models, cold load %.1fms, warm load %.1fms, %.0f matches/s\n",
+               (unsigned long)r.numModels, r.coldLoadMs, r.warmLoadMs, r.matchesPerSec);
+        return r.numModels > 0 ? 0 : 1;
+    }
+
+    // match: load all CSL folders, then replay the queries
+    for (size_t i = 1; i < gOpt.vecArg.size(); ++i) {
+        const char* res = XPMPLoadCSLPackage(AbsPath(gOpt.vecArg[i]).c_str());
+        if (res[0]) {
+            fprintf(stderr, "%s\n", res);
+            return 1;
+        }
+    }
+    const BenchMatchResultTy r = BenchMatching(gOpt.vecArg[0].c_str(),
+                                               gOpt.refFile.empty() ? nullptr : gOpt.refFile.c_str(),
+                                               gOpt.bWriteRef, gOpt.seed);
+    if (!r.numQueries)
+        return 1;
+    printf("%lu queries, %.0f queries/s, latency p50 %.1fus, p90 %.1fus, p99 %.1fus, max %.1fus\n",
+           (unsigned long)r.numQueries, r.queriesPerSec, r.p50Us, r.p90Us, r.p99Us, r.maxUs);
+    if (r.numCompared) {
+        printf("%lu queries compared to reference: %lu differ in quality, %lu in candidates, %lu in the chosen model\n",
+               (unsigned long)r.numCompared, (unsigned long)r.numQualityDiff,
+               (unsigned long)r.numCandidateDiff, (unsigned long)r.numChoiceDiff);
+        return r.numQualityDiff || r.numCandidateDiff ? 1 : 0;
+    }
+    return 0;
+}
+
+int main (int argc, char* argv[])
+{
+    if (!ParseArgs(argc, argv)) {
+        fputs(USAGE, stderr);
+        return 2;
+    }
+
+    // Set up the stand-in for X-Plane and initialize XPMP2
+    XPLMStubSetSystemPath(AbsPath(gOpt.xpDir.empty() ? "." : gOpt.xpDir));
+    const char* res = XPMPMultiplayerInit("XPMP2-Bench", AbsPath(gOpt.resDir).c_str(),
+                                          CBIntPrefsFunc, "A320", "Bench");
+    if (res[0]) {
+        fprintf(stderr, "Initialization failed: %s\n", res);
+        XPMPMultiplayerCleanup();
+        return 2;
+    }
+
+    const int ret = RunCommand();
+    XPMPMultiplayerCleanup();
+    return ret;
+}
@@ -0,0 +1,335 @@
+/// @file       XPLMStub.cpp
+/// @brief      Minimal stand-in for the X-Plane plugin API, so that XPMP2's CSL loading runs outside X-Plane
+/// @details    Implements all XPLM functions XPMP2 refers to, in DEBUG builds, too.
+///             File system related functions actually work,
+///             `XPLMLoadObjectAsync()` validates the file,
+///             the network time dataRef returns the running time,
+///             `XPLMGetCycleNumber()` counts its calls,
+///             `XPLMCreateInstance()` returns a dummy handle for loaded objects.
+///             Everything else does nothing and returns "not available".
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#include "XPLMStub.h"
+
+// Standard C/C++ headers
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <dirent.h>
+
+// X-Plane SDK
+#include "XPLMCamera.h"
+#include "XPLMDataAccess.h"
+#include "XPLMDisplay.h"
+#include "XPLMGraphics.h"
+#include "XPLMInstance.h"
+#include "XPLMMap.h"
+#include "XPLMPlanes.h"
+#include "XPLMPlugin.h"
+#include "XPLMProcessing.h"
+#include "XPLMScenery.h"
+#include "XPLMUtilities.h"
+
+//
+// MARK: Stub state
+//
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wexit-time-destructors"
+#pragma clang diagnostic ignored "-Wglobal-constructors"
+/// X-Plane's system path, with trailing separator
+static std::string gSystemPath;
+/// A pending XPLMLoadObjectAsync() request
+struct ObjLoadTy {
+    std::string         path;       ///< file to load
+    XPLMObjectLoaded_f  pfnCB;      ///< callback to call
+    void*               refcon;     ///< refcon to pass
+};
+/// Pending XPLMLoadObjectAsync() requests
+static std::vector<ObjLoadTy> gVecObjLoad;
+/// Serializes XPLMDebugString(), which is also called from XPMP2's worker threads
+static std::mutex gDebugStringMutex;
+/// Start of the program, base of the network time
+static const std::chrono::steady_clock::time_point gTsStart = std::chrono::steady_clock::now();
+#pragma clang diagnostic pop
+
+/// Receives XPLMDebugString() output
+static void (*gpfnDebugStringCB)(const char*) = nullptr;
+
+/// The only dataRef we provide: network time
+static int gDrNetwTime = 0;
+/// What we return as loaded object
+static int gObjDummy = 0;
+/// What we return as flight loop, map layer, or instance id
+static int gIdDummy = 0;
+/// Cycle number, advanced with each call to XPLMGetCycleNumber() as there are no frames
+static int gCycleNum = 0;
+
+// Set the folder reported as X-Plane's system path
+void XPLMStubSetSystemPath (const std::string& path)
+{
+    gSystemPath = path;
+    if (!gSystemPath.empty() && gSystemPath.back() != '/')
+        gSystemPath += '/';
+}
+
+// Set the function receiving everything passed to XPLMDebugString()
+void XPLMStubSetDebugStringCB (void (*pfnCB)(const char*))
+{
+    gpfnDebugStringCB = pfnCB;
+}
+
+/// Does the file exist and start with a valid OBJ8 header ("A" or "I", "800", "OBJ")?
+static bool IsObj8File (const std::string& path)
+{
+    std::ifstream f (path);
+    std::string ln[3];
+    for (std::string& l: ln) {
+        if (!std::getline(f, l))
+            return false;
+        while (!l.empty() && (l.back() == '\r' || l.back() == ' ' || l.back() == '\t'))
+            l.pop_back();
+    }
+    return (ln[0] == "A" || ln[0] == "I") && ln[1].compare(0, 3, "800") == 0 && ln[2] == "OBJ";
+}
+
+// Deliver the results of pending XPLMLoadObjectAsync() calls
+void XPLMStubProcessObjLoads ()
+{
+    // (callbacks might request further loads)
+    std::vector<ObjLoadTy> vecObjLoad;
+    vecObjLoad.swap(gVecObjLoad);
+    for (const ObjLoadTy& ol: vecObjLoad)
+        ol.pfnCB(IsObj8File(ol.path) ? XPLMObjectRef(&gObjDummy) : nullptr, ol.refcon);
+}
+
+//
+// MARK: XPLMUtilities, XPLMPlugin
+//
+
+XPLM_API void XPLMDebugString (const char* inString)
+{
+    std::lock_guard<std::mutex> lock (gDebugStringMutex);
+    if (gpfnDebugStringCB)
+        gpfnDebugStringCB(inString);
+    else
+        fputs(inString, stderr);
+}
+
+XPLM_API const char* XPLMGetDirectorySeparator ()
+{
+    return "/";
+}
+
+XPLM_API void XPLMGetSystemPath (char* outSystemPath)
+{
+    strncpy(outSystemPath, gSystemPath.c_str(), 511);
+    outSystemPath[511] = '\0';
+}
+
+XPLM_API int XPLMGetDirectoryContents (const char* inDirectoryPath, int inFirstReturn,
+                                       char* outFileNames, int inFileNameBufSize,
+                                       char** outIndices, int inIndexCount,
+                                       int* outTotalFiles, int* outReturnedFiles)
+{
+    // Read the entire directory, sorted for reproducible results
+    std::vector<std::string> vecNames;
+    DIR* pDir = opendir(inDirectoryPath);
+    if (pDir) {
+        for (dirent* pEnt = readdir(pDir); pEnt; pEnt = readdir(pDir))
+            vecNames.push_back(pEnt->d_name);
+        closedir(pDir);
+    }
+    std::sort(vecNames.begin(), vecNames.end());
+    if (outTotalFiles) *outTotalFiles = int(vecNames.size());
+    
+    // Return as many as fit into the buffers, starting at inFirstReturn
+    int nRet = 0;
+    size_t bufUsed = 0;
+    size_t i = size_t(std::max(inFirstReturn, 0));
+    for (; i < vecNames.size() && nRet < inIndexCount; ++i) {
+        const std::string& n = vecNames[i];
+        if (bufUsed + n.size() + 1 > size_t(inFileNameBufSize))
+            break;
+        memcpy(outFileNames + bufUsed, n.c_str(), n.size() + 1);
+        if (outIndices)
+            outIndices[nRet] = outFileNames + bufUsed;
+        bufUsed += n.size() + 1;
+        ++nRet;
+    }
+    if (outReturnedFiles) *outReturnedFiles = nRet;
+    return i >= vecNames.size() ? 1 : 0;
+}
+
+XPLM_API void XPLMGetVersions (int* outXPlaneVersion, int* outXPLMVersion, XPLMHostApplicationID* outHostID)
+{
+    if (outXPlaneVersion) *outXPlaneVersion = 12000;
+    if (outXPLMVersion) *outXPLMVersion = 400;
+    if (outHostID) *outHostID = xplm_Host_XPlane;
+}
+
+XPLM_API XPLMPluginID XPLMGetMyID ()
+{
+    return 0;
+}
+
+XPLM_API void XPLMGetPluginInfo (XPLMPluginID, char* outName, char* outFilePath,
+                                 char* outSignature, char* outDescription)
+{
+    if (outName)        strcpy(outName, "XPMP2-CSLIndex");
+    if (outFilePath)    outFilePath[0] = '\0';
+    if (outSignature)   strcpy(outSignature, "TwinFan.XPMP2.CSLIndex");
+    if (outDescription) outDescription[0] = '\0';
+}
+
+//
+// MARK: XPLMDataAccess
+//
+
+XPLM_API XPLMDataRef XPLMFindDataRef (const char* inDataRefName)
+{
+    if (!strcmp(inDataRefName, "sim/network/misc/network_time_sec"))
+        return &gDrNetwTime;
+    return nullptr;
+}
+
+XPLM_API float XPLMGetDataf (XPLMDataRef inDataRef)
+{
+    if (inDataRef == &gDrNetwTime)
+        return std::chrono::duration<float>(std::chrono::steady_clock::now() - gTsStart).count();
+    return 0.0f;
+}
+
+XPLM_API int XPLMGetDatai (XPLMDataRef)                         { return 0; }
+XPLM_API int XPLMGetDatavf (XPLMDataRef, float*, int, int)      { return 0; }
+XPLM_API int XPLMGetDatavi (XPLMDataRef, int*, int, int)        { return 0; }
+XPLM_API void XPLMSetDatab (XPLMDataRef, void*, int, int)       {}
+XPLM_API void XPLMSetDataf (XPLMDataRef, float)                 {}
+XPLM_API void XPLMSetDatai (XPLMDataRef, int)                   {}
+XPLM_API void XPLMSetDatavf (XPLMDataRef, float*, int, int)     {}
+XPLM_API void XPLMSetDatavi (XPLMDataRef, int*, int, int)       {}
+
+XPLM_API XPLMDataRef XPLMRegisterDataAccessor (const char*, XPLMDataTypeID, int,
+                                               XPLMGetDatai_f, XPLMSetDatai_f,
+                                               XPLMGetDataf_f, XPLMSetDataf_f,
+                                               XPLMGetDatad_f, XPLMSetDatad_f,
+                                               XPLMGetDatavi_f, XPLMSetDatavi_f,
+                                               XPLMGetDatavf_f, XPLMSetDatavf_f,
+                                               XPLMGetDatab_f, XPLMSetDatab_f,
+                                               void*, void*)
+{
+    return nullptr;
+}
+
+XPLM_API void XPLMUnregisterDataAccessor (XPLMDataRef)          {}
+XPLM_API int XPLMShareData (const char*, XPLMDataTypeID, XPLMDataChanged_f, void*)     { return 1; }
+XPLM_API int XPLMUnshareData (const char*, XPLMDataTypeID, XPLMDataChanged_f, void*)   { return 1; }
+
+//
+// MARK: XPLMScenery, XPLMInstance
+//
+
+XPLM_API void XPLMLoadObjectAsync (const char* inPath, XPLMObjectLoaded_f inCallback, void* inRefcon)
+{
+    gVecObjLoad.push_back({inPath, inCallback, inRefcon});
+}
+
+XPLM_API void XPLMUnloadObject (XPLMObjectRef)                  {}
+XPLM_API XPLMProbeRef XPLMCreateProbe (XPLMProbeType)           { return nullptr; }
+XPLM_API void XPLMDestroyProbe (XPLMProbeRef)                   {}
+XPLM_API XPLMProbeResult XPLMProbeTerrainXYZ (XPLMProbeRef, float, float, float, XPLMProbeInfo_t*)
+{
+    return xplm_ProbeError;
+}
+
+XPLM_API XPLMInstanceRef XPLMCreateInstance (XPLMObjectRef inObj, const char**)  { return inObj ? XPLMInstanceRef(&gIdDummy) : nullptr; }
+XPLM_API void XPLMDestroyInstance (XPLMInstanceRef)             {}
+XPLM_API void XPLMInstanceSetPosition (XPLMInstanceRef, const XPLMDrawInfo_t*, const float*) {}
+
+//
+// MARK: XPLMGraphics, XPLMDisplay, XPLMCamera
+//
+
+XPLM_API void XPLMLocalToWorld (double, double, double, double* outLatitude, double* outLongitude, double* outAltitude)
+{
+    *outLatitude = *outLongitude = *outAltitude = 0.0;
+}
+
+XPLM_API void XPLMWorldToLocal (double, double, double, double* outX, double* outY, double* outZ)
+{
+    *outX = *outY = *outZ = 0.0;
+}
+
+XPLM_API void XPLMDrawString (float*, int, int, char*, int*, XPLMFontID)  {}
+XPLM_API int XPLMRegisterDrawCallback (XPLMDrawCallback_f, XPLMDrawingPhase, int, void*)   { return 1; }
+XPLM_API int XPLMUnregisterDrawCallback (XPLMDrawCallback_f, XPLMDrawingPhase, int, void*) { return 1; }
+
+XPLM_API void XPLMReadCameraPosition (XPLMCameraPosition_t* outCameraPosition)
+{
+    memset(outCameraPosition, 0, sizeof(*outCameraPosition));
+}
+
+//
+// MARK: XPLMProcessing
+//
+
+XPLM_API XPLMFlightLoopID XPLMCreateFlightLoop (XPLMCreateFlightLoop_t*)   { return XPLMFlightLoopID(&gIdDummy); }
+XPLM_API void XPLMDestroyFlightLoop (XPLMFlightLoopID)          {}
+XPLM_API void XPLMScheduleFlightLoop (XPLMFlightLoopID, float, int) {}
+
+// Only used by DEBUG builds of XPMP2 (UPDATE_CYCLE_NUM)
+XPLM_API int XPLMGetCycleNumber ()
+{
+    return ++gCycleNum;
+}
+
+//
+// MARK: XPLMMap
+//
+
+XPLM_API XPLMMapLayerID XPLMCreateMapLayer (XPLMCreateMapLayer_t*)  { return XPLMMapLayerID(&gIdDummy); }
+XPLM_API int XPLMDestroyMapLayer (XPLMMapLayerID)               { return 1; }
+XPLM_API int XPLMMapExists (const char*)                        { return 0; }
+XPLM_API void XPLMRegisterMapCreationHook (XPLMMapCreatedCallback_f, void*) {}
+XPLM_API void XPLMMapProject (XPLMMapProjectionID, double, double, float* outX, float* outY)
+{
+    *outX = *outY = 0.0f;
+}
+XPLM_API float XPLMMapScaleMeter (XPLMMapProjectionID, float, float) { return 1.0f; }
+XPLM_API void XPLMDrawMapIconFromSheet (XPLMMapLayerID, const char*, int, int, int, int,
+                                        float, float, XPLMMapOrientation, float, float) {}
+XPLM_API void XPLMDrawMapLabel (XPLMMapLayerID, const char*, float, float, XPLMMapOrientation, float) {}
+
+//
+// MARK: XPLMPlanes
+//
+
+XPLM_API int XPLMAcquirePlanes (char**, XPLMPlanesAvailable_f, void*)  { return 0; }
+XPLM_API void XPLMReleasePlanes ()                              {}
+XPLM_API void XPLMSetActiveAircraftCount (int)                  {}
+XPLM_API void XPLMDisableAIForPlane (int)                       {}
+XPLM_API void XPLMCountAircraft (int* outTotalAircraft, int* outActiveAircraft, XPLMPluginID* outController)
+{
+    if (outTotalAircraft)   *outTotalAircraft = 1;
+    if (outActiveAircraft)  *outActiveAircraft = 1;
+    if (outController)      *outController = XPLM_NO_PLUGIN_ID;
+}
@@ -0,0 +1,36 @@
+/// @file       XPLMStub.h
+/// @brief      Minimal stand-in for the X-Plane plugin API, so that XPMP2's CSL loading runs outside X-Plane
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#ifndef _XPLMStub_h_
+#define _XPLMStub_h_
+
+#include <string>
+
+/// Set the folder reported as X-Plane's system path by `XPLMGetSystemPath()`
+void XPLMStubSetSystemPath (const std::string& path);
+
+/// Set the function receiving everything passed to `XPLMDebugString()`
+void XPLMStubSetDebugStringCB (void (*pfnCB)(const char*));
+
+/// @brief Deliver the results of pending `XPLMLoadObjectAsync()` calls, as X-Plane would do in a later frame
+/// @details An object "loads" if the file exists and has a valid OBJ8 header.
+void XPLMStubProcessObjLoads ();
+
+#endif
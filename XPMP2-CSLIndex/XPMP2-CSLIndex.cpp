@@ -0,0 +1,293 @@
+/// @file       XPMP2-CSLIndex.cpp
+/// @brief      Offline CSL indexer and validator
+/// @details    Runs XPMP2's CSL loading outside X-Plane against one or more CSL folders,
+///             so that a build server can pre-bake what sim stations would otherwise do on first start:\n
+///             1. Reads all packages like XPMPLoadCSLPackage() and reports all problems found,
+///                like unknown packages, missing `.obj` files, duplicate ids, or non-OBJ8 entries.\n
+///             2. Takes each model through the loading sequence, which creates the
+///                `.xpmp2.obj` copies and scans the `.obj` files for vertical offset and bounds.
+///                `.obj` files without valid OBJ8 header are reported as failed.\n
+///             3. Writes the shared CSL catalog (see config item `models/shared_catalog`)
+///                into X-Plane's `Output/caches/XPMP2` folder.\n
+///             4. Optionally writes a CSV list of all models with vertical offset and bounds.\n
+///             \n
+///             The catalog is only used by plugins with the same `models/replace_datarefs`
+///             and `models/replace_texture` settings, pass the matching options.\n
+///             Exit code is 0 if no errors were reported, 1 if errors were reported,
+///             2 for invalid arguments or if initialization failed.
+/// @see        XPLMStub.cpp for how the X-Plane API is replaced
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#include "XPMP2.h"
+#include "XPLMStub.h"
+
+#include <cstdio>
+#include <thread>
+#include <unistd.h>
+
+using namespace XPMP2;
+
+/// Usage information
+static const char* USAGE =
+"Usage: XPMP2-CSLIndex [options] <CSL folder> [<CSL folder>...]\n"
+"  --xp <folder>          X-Plane's main folder, catalog goes to its Output/caches/XPMP2 (default: current folder)\n"
+"  --resources <folder>   XPMP2's Resources folder with Doc8643.txt, related.txt... (default: ./Resources)\n"
+"  --replace-datarefs     Same as config item models/replace_datarefs = 1\n"
+"  --no-replace-texture   Same as config item models/replace_texture = 0\n"
+"  --no-preload           Neither create .obj copies nor scan .obj files\n"
+"  --no-catalog           Don't write the shared catalog\n"
+"  --report <file>        Write the report into a file instead of to stdout\n"
+"  --index <file>         Write a CSV list of all models with vertical offset and bounds\n"
+"  --verbose              Report info messages, too\n";
+
+/// Number of models taken through the loading sequence in parallel
+constexpr size_t PRELOAD_IN_FLIGHT = 32;
+
+/// Command line options
+struct OptionsTy {
+    std::string xpDir;                  ///< X-Plane's main folder
+    std::string resDir = "Resources";   ///< XPMP2's resource folder
+    std::vector<std::string> vecCSL;    ///< CSL folders to process
+    bool bReplDataRefs = false;         ///< config item models/replace_datarefs
+    bool bReplTexture = true;           ///< config item models/replace_texture
+    bool bPreload = true;               ///< take models through the loading sequence?
+    bool bCatalog = true;               ///< write the shared catalog?
+    std::string reportFile;             ///< report file, empty for stdout
+    std::string indexFile;              ///< CSV list of models, empty for none
+    bool bVerbose = false;              ///< report info messages?
+} gOpt;
+
+/// Collect log messages into the report? (Only while processing CSL folders)
+static bool gbCollect = false;
+/// Collected log messages
+static std::vector<std::string> gVecMsg;
+/// Number of warnings/errors collected
+static unsigned gNumWarn = 0, gNumErr = 0;
+
+/// Problem categories counted in the summary, identified by parts of XPMP2's messages
+static const struct { const char* szLabel; const char* szMsgPart; } CATEGORIES[] = {
+    { "Unknown packages",       "unknown in package path"       },
+    { "Missing .obj files",     "could not be found at"         },
+    { "Invalid .obj files",     "Async load FAILED"             },
+    { "Duplicate model ids",    "Duplicate model"               },
+    { "Duplicate package names","is already in use by"          },
+    { "Non-OBJ8 entries",       "due to outdated format"        },
+};
+
+/// Receives all XPMP2 log output
+static void DebugStringCB (const char* inString)
+{
+    fputs(inString, stderr);
+    if (!gbCollect)
+        return;
+    // Identify the log level: "<time> <acronym>/XPMP2 <LEVEL> ..."
+    const char* pLvl = strstr(inString, "/XPMP2 ");
+    if (!pLvl)
+        return;
+    pLvl += 7;
+    if (!strncmp(pLvl, "WARN", 4))
+        ++gNumWarn;
+    else if (!strncmp(pLvl, "ERROR", 5) || !strncmp(pLvl, "FATAL", 5))
+        ++gNumErr;
+    else if (!gOpt.bVerbose)
+        return;
+    gVecMsg.emplace_back(inString);
+    if (!gVecMsg.back().empty() && gVecMsg.back().back() == '\n')
+        gVecMsg.back().pop_back();
+}
+
+/// Configuration callback for XPMP2
+static int CBIntPrefsFunc (const char*, const char* _key, int _default)
+{
+    if (!strcmp(_key, XPMP_CFG_ITM_REPLDATAREFS))   return gOpt.bReplDataRefs;
+    if (!strcmp(_key, XPMP_CFG_ITM_REPLTEXTURE))    return gOpt.bReplTexture;
+    if (!strcmp(_key, XPMP_CFG_ITM_LOGLEVEL))       return gOpt.bVerbose ? logINFO : logWARN;
+    if (!strcmp(_key, XPMP_CFG_ITM_SHAREDCAT))      return 0;   // we always want to parse, we write the catalog explicitely
+    return _default;
+}
+
+/// Parse the command line, `false` if invalid
+static bool ParseArgs (int argc, char* argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string a (argv[i]);
+        const bool bHasParam = i+1 < argc;
+        if      (a == "--xp" && bHasParam)          gOpt.xpDir = argv[++i];
+        else if (a == "--resources" && bHasParam)   gOpt.resDir = argv[++i];
+        else if (a == "--replace-datarefs")         gOpt.bReplDataRefs = true;
+        else if (a == "--no-replace-texture")       gOpt.bReplTexture = false;
+        else if (a == "--no-preload")               gOpt.bPreload = false;
+        else if (a == "--no-catalog")               gOpt.bCatalog = false;
+        else if (a == "--report" && bHasParam)      gOpt.reportFile = argv[++i];
+        else if (a == "--index" && bHasParam)       gOpt.indexFile = argv[++i];
+        else if (a == "--verbose")                  gOpt.bVerbose = true;
+        else if (a.compare(0, 2, "--") == 0)        return false;
+        else                                        gOpt.vecCSL.push_back(a);
+    }
+    return !gOpt.vecCSL.empty();
+}
+
+/// Make a path absolute, without trailing separator
+static std::string AbsPath (const std::string& path)
+{
+    std::string ret = path;
+    if (ret.empty() || ret[0] != '/') {
+        char cwd[1024] = "";
+        if (getcwd(cwd, sizeof(cwd)))
+            ret = std::string(cwd) + '/' + ret;
+    }
+    while (ret.size() > 1 && ret.back() == '/')
+        ret.pop_back();
+    return ret;
+}
+
+/// @brief Take all models through the loading sequence
+/// @details Creates the `.obj` copies if needed and scans the `.obj` files for vertical offset and bounds.
+///          Models, whose objects fail to load, are taken out of the catalog.
+static void PreloadModels ()
+{
+    // (failing models are removed from the catalog's index, so we work on a copy)
+    std::vector<CSLModel*> vecMdl (glob.catCSLModels.begin(), glob.catCSLModels.end());
+    std::vector<CSLModel*> vecInFlight;
+    size_t next = 0;
+    while (next < vecMdl.size() || !vecInFlight.empty()) {
+        while (next < vecMdl.size() && vecInFlight.size() < PRELOAD_IN_FLIGHT)
+            if (!vecMdl[next]->RequestLoad(0))
+                vecInFlight.push_back(vecMdl[next++]);
+            else
+                ++next;
+        
+        // what X-Plane and the flight loop would do
+        XPLMStubProcessObjLoads();
+        CSLModelsProcessLoads();
+        vecInFlight.erase(std::remove_if(vecInFlight.begin(), vecInFlight.end(),
+                                         [](const CSLModel* pMdl)
+                                         { return pMdl->GetLoadState() != MLS_COPYING &&
+                                                  pMdl->GetLoadState() != MLS_LOADING; }),
+                          vecInFlight.end());
+        if (!vecInFlight.empty())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+/// Write the shared catalog for a CSL folder
+static void WriteCatalog (const std::string& path)
+{
+    std::vector<std::string> paths, dirs;
+    CSLCacheLock lock (path, 5);
+    if (!lock.IsLocked())
+        return;
+    CSLModelsFindPkgs(path, paths, 5, &dirs);
+    CSLCacheWrite(path, 5, paths, dirs);
+}
+
+/// Write the CSV list of all models
+static bool WriteIndex (const std::string& fileName)
+{
+    std::ofstream f (fileName);
+    if (!f)
+        return false;
+    f << "model;icao_type;airline;livery;state;vert_ofs;min_x;min_y;min_z;max_x;max_y;max_z;radius;xsb_aircraft;line\n";
+    for (const CSLModel* pMdl: glob.catCSLModels) {
+        const CSLBoundsTy& b = pMdl->GetBounds();
+        f << pMdl->GetModelName() << ';' << pMdl->GetIcaoType() << ';'
+          << pMdl->GetIcaoAirline() << ';' << pMdl->GetLivery() << ';'
+          << (pMdl->IsReady() ? "ok" : "not loaded") << ';' << pMdl->GetVertOfs() << ';';
+        if (b.bValid)
+            f << b.min[0] << ';' << b.min[1] << ';' << b.min[2] << ';'
+              << b.max[0] << ';' << b.max[1] << ';' << b.max[2] << ';' << b.radius << ';';
+        else
+            f << ";;;;;;;";
+        f << pMdl->xsbAircraftPath.str() << ';' << pMdl->xsbAircraftLn << '\n';
+    }
+    return bool(f);
+}
+
+/// Write the report
+static void WriteReport (FILE* f, unsigned long nModels, unsigned long nPkgs)
+{
+    fprintf(f, "XPMP2-CSLIndex report\n");
+    for (const std::string& csl: gOpt.vecCSL)
+        fprintf(f, "CSL folder:  %s\n", csl.c_str());
+    fprintf(f, "Packages:    %lu\n", nPkgs);
+    fprintf(f, "Models:      %lu\n", nModels);
+    fprintf(f, "Warnings:    %u\n", gNumWarn);
+    fprintf(f, "Errors:      %u\n", gNumErr);
+    for (const auto& cat: CATEGORIES) {
+        const auto n = std::count_if(gVecMsg.begin(), gVecMsg.end(),
+                                     [&cat](const std::string& m){ return m.find(cat.szMsgPart) != std::string::npos; });
+        if (n > 0)
+            fprintf(f, "  %-24s %ld\n", cat.szLabel, long(n));
+    }
+    if (!gVecMsg.empty()) {
+        fprintf(f, "\nMessages:\n");
+        for (const std::string& m: gVecMsg)
+            fprintf(f, "%s\n", m.c_str());
+    }
+}
+
+/// Main function
+int main (int argc, char* argv[])
+{
+    if (!ParseArgs(argc, argv)) {
+        fputs(USAGE, stderr);
+        return 2;
+    }
+    
+    // Set up the stand-in for X-Plane and initialize XPMP2
+    XPLMStubSetSystemPath(AbsPath(gOpt.xpDir.empty() ? "." : gOpt.xpDir));
+    XPLMStubSetDebugStringCB(DebugStringCB);
+    const char* res = XPMPMultiplayerInit("XPMP2-CSLIndex", AbsPath(gOpt.resDir).c_str(),
+                                          CBIntPrefsFunc, "A320", "CSLIndex");
+    if (res[0]) {
+        fprintf(stderr, "Initialization failed: %s\n", res);
+        XPMPMultiplayerCleanup();
+        return 2;
+    }
+    
+    // Read all CSL folders, then take the models through the loading sequence
+    gbCollect = true;
+    std::vector<std::string> vecPath;
+    for (const std::string& csl: gOpt.vecCSL) {
+        vecPath.push_back(AbsPath(csl));
+        CSLModelsLoad(vecPath.back());
+    }
+    if (gOpt.bPreload)
+        PreloadModels();
+    gbCollect = false;
+    
+    // Write results
+    if (gOpt.bCatalog)
+        for (const std::string& path: vecPath)
+            WriteCatalog(path);
+    if (!gOpt.indexFile.empty() && !WriteIndex(gOpt.indexFile))
+        fprintf(stderr, "Could not write %s\n", gOpt.indexFile.c_str());
+    
+    FILE* fReport = gOpt.reportFile.empty() ? stdout : fopen(gOpt.reportFile.c_str(), "w");
+    if (fReport) {
+        WriteReport(fReport, (unsigned long)glob.catCSLModels.size(),
+                    (unsigned long)glob.mapCSLPkgs.size());
+        if (fReport != stdout)
+            fclose(fReport);
+    } else
+        fprintf(stderr, "Could not write %s\n", gOpt.reportFile.c_str());
+    
+    XPMPMultiplayerCleanup();
+    return gNumErr > 0 ? 1 : 0;
+}
@@ -0,0 +1,206 @@
+/// @file       AllocSteadyState.cpp
+/// @brief      Test: XPMP2's flight loop doesn't allocate heap memory in steady state
+/// @details    Runs against the XPLM stub of XPMP2-CSLIndex and a library built with
+///             `XPMP2_ALLOC_AUDIT`, which counts allocations in the flight loop.\n
+///             1. Writes a small CSL package into the work folder and loads it.\n
+///             2. Creates a number of aircraft, with a cap on rendered aircraft,
+///                so that admission to rendering is exercised, too.\n
+///             3. Drives the aircraft flight loop like X-Plane would until all models
+///                are loaded, all admitted aircraft have instances, and
+///                the regular once-a-second work has happened at least once.\n
+///             4. Drives the flight loop for more frames and counts
+///                the allocations in each of them.\n
+///             \n
+///             Usage: `XPMP2-TestAllocSteadyState <Resources folder> <work folder>`\n
+///             Exit code is 0 if no frame allocated, 1 if any frame allocated
+///             or steady state was not reached, 2 for invalid arguments or if initialization failed.
+/// @see        XPLMStub.cpp for how the X-Plane API is replaced
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#include "XPMP2.h"
+#include "XPLMStub.h"
+
+#include <cstdio>
+#include <thread>
+
+#ifndef XPMP2_ALLOC_AUDIT
+#error This test requires XPMP2 to be built with XPMP2_ALLOC_AUDIT
+#endif
+
+using namespace XPMP2;
+
+/// Number of aircraft to create
+constexpr int NUM_AC = 40;
+/// Maximum number of rendered aircraft, less than NUM_AC to exercise admission
+constexpr int MAX_RENDERED = 30;
+/// Minimum warm-up time, covering the once-a-second work in the flight loop [s]
+constexpr float WARMUP_MIN = 2.5f;
+/// Maximum warm-up time, after which steady state is considered not reached [s]
+constexpr float WARMUP_MAX = 20.0f;
+/// Number of frames to count allocations in
+constexpr int NUM_FRAMES = 600;
+/// Time between two frames, so that periodic work happens during the test [ms]
+constexpr int FRAME_PERIOD_MS = 5;
+
+/// Configuration callback for XPMP2
+static int CBIntPrefsFunc (const char*, const char* _key, int _default)
+{
+    if (!strcmp(_key, XPMP_CFG_ITM_LOGLEVEL))       return logWARN;
+    if (!strcmp(_key, XPMP_CFG_ITM_MAXRENDERED))    return MAX_RENDERED;
+    if (!strcmp(_key, XPMP_CFG_ITM_SHAREDCAT))      return 0;
+    return _default;
+}
+
+/// Write a small OBJ8 file with an animation, so that the dataRef subset is used
+static bool WriteObj (const std::string& path, float zOfs)
+{
+    std::ofstream f(path, std::ios::trunc);
+    if (!f) return false;
+    f << "I\n800\nOBJ\n\nPOINT_COUNTS 3 0 0 3\n\n";
+    f << "VT -2 -1.5 " << zOfs << " 0 1 0 0 0\n";
+    f << "VT  2 -1.5 " << zOfs << " 0 1 0 1 0\n";
+    f << "VT  0  1.0 " << zOfs + 3.0f << " 0 1 0 0 1\n\n";
+    f << "IDX 0\nIDX 1\nIDX 2\n\n";
+    f << "ANIM_begin\n"
+         "\tANIM_rotate 1 0 0 0 30 0 1 libxplanemp/controls/gear_ratio\n"
+         "\tTRIS 0 3\n"
+         "ANIM_end\n";
+    return bool(f);
+}
+
+/// Write a CSL package with two models, one of them consisting of two objects
+static bool WriteCSL (const std::string& dir)
+{
+    mkdir(dir.c_str(), 0755);
+    std::ofstream f(dir + "/xsb_aircraft.txt", std::ios::trunc);
+    f << "EXPORT_NAME XPMP2-Test\n\n"
+         "OBJ8_AIRCRAFT A320_TEST\n"
+         "OBJ8 SOLID YES XPMP2-Test/a.obj\n"
+         "OBJ8 GLASS YES XPMP2-Test/b.obj\n"
+         "ICAO A320\n\n"
+         "OBJ8_AIRCRAFT B738_TEST\n"
+         "OBJ8 SOLID YES XPMP2-Test/b.obj\n"
+         "ICAO B738\n";
+    return bool(f) && WriteObj(dir + "/a.obj", 0.0f) && WriteObj(dir + "/b.obj", 5.0f);
+}
+
+/// Test aircraft, moves along a circle without allocating
+class TestAircraft : public Aircraft {
+public:
+    /// Constructor just passes on
+    using Aircraft::Aircraft;
+
+    /// Moves a bit each frame
+    void UpdatePosition (float _elapsed, int) override
+    {
+        drawInfo.heading = std::fmod(drawInfo.heading + _elapsed * 3.0f, 360.0f);
+        drawInfo.x += _elapsed * 10.0f;
+        v[V_CONTROLS_GEAR_RATIO] = 1.0f;
+    }
+
+    /// Has instances?
+    bool HasInstances () const { return !listInst.empty(); }
+
+    /// Run XPMP2's aircraft flight loop once, like X-Plane would, and return the allocations made in it
+    static unsigned long RunFrame (float _elapsed, int _flCounter)
+    {
+        FlightLoopCB(_elapsed, _elapsed, _flCounter, nullptr);
+        return AllocFrameCount();
+    }
+};
+
+/// Main function
+int main (int argc, char* argv[])
+{
+    if (argc != 3) {
+        fputs("Usage: XPMP2-TestAllocSteadyState <Resources folder> <work folder>\n", stderr);
+        return 2;
+    }
+    const std::string resDir = argv[1];
+    const std::string workDir = argv[2];
+    mkdir(workDir.c_str(), 0755);
+    if (!WriteCSL(workDir + "/XPMP2-Test")) {
+        fprintf(stderr, "Could not write the CSL package into %s\n", workDir.c_str());
+        return 2;
+    }
+
+    // Set up the stand-in for X-Plane and initialize XPMP2
+    XPLMStubSetSystemPath(workDir);
+    const char* res = XPMPMultiplayerInit("XPMP2-Test", resDir.c_str(),
+                                          CBIntPrefsFunc, "A320", "Test");
+    if (!res[0])
+        res = XPMPLoadCSLPackage(workDir.c_str());
+    if (res[0]) {
+        fprintf(stderr, "Initialization failed: %s\n", res);
+        XPMPMultiplayerCleanup();
+        return 2;
+    }
+
+    // Create the aircraft
+    std::vector<std::unique_ptr<TestAircraft> > vecAc;
+    for (int i = 0; i < NUM_AC; ++i) {
+        vecAc.emplace_back(new TestAircraft(i % 2 ? "A320" : "B738", "DLH", ""));
+        vecAc.back()->drawInfo.x = float(i) * 100.0f;
+        vecAc.back()->drawInfo.z = float(i % 7) * 500.0f;
+    }
+
+    // Warm up until all admitted aircraft have instances
+    const float elapsed = float(FRAME_PERIOD_MS) / 1000.0f;
+    const auto tStart = std::chrono::steady_clock::now();
+    int flCounter = 0;
+    int nInst = 0;
+    float tWarmUp = 0.0f;
+    for (; tWarmUp < WARMUP_MAX; ++flCounter) {
+        XPLMStubProcessObjLoads();
+        TestAircraft::RunFrame(elapsed, flCounter);
+        std::this_thread::sleep_for(std::chrono::milliseconds(FRAME_PERIOD_MS));
+        tWarmUp = std::chrono::duration<float>(std::chrono::steady_clock::now() - tStart).count();
+        nInst = int(std::count_if(vecAc.cbegin(), vecAc.cend(),
+                                  [](const std::unique_ptr<TestAircraft>& pAc){ return pAc->HasInstances(); }));
+        if (tWarmUp >= WARMUP_MIN && nInst == MAX_RENDERED)
+            break;
+    }
+    if (nInst != MAX_RENDERED) {
+        fprintf(stderr, "Steady state not reached: %d of %d aircraft have instances after %.1fs\n",
+                nInst, MAX_RENDERED, double(tWarmUp));
+        vecAc.clear();
+        XPMPMultiplayerCleanup();
+        return 1;
+    }
+
+    // Steady state: count allocations per frame
+    int nAllocFrames = 0;
+    unsigned long maxAllocs = 0;
+    for (int i = 0; i < NUM_FRAMES; ++i, ++flCounter) {
+        const unsigned long n = TestAircraft::RunFrame(elapsed, flCounter);
+        if (n > 0) {
+            if (!nAllocFrames)
+                fprintf(stderr, "Frame %d allocated %lu times\n", i, n);
+            ++nAllocFrames;
+            maxAllocs = std::max(maxAllocs, n);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(FRAME_PERIOD_MS));
+    }
+    printf("%d frames with %d aircraft (%d rendered): %d frames allocated, max %lu allocations per frame\n",
+           NUM_FRAMES, NUM_AC, nInst, nAllocFrames, maxAllocs);
+
+    vecAc.clear();
+    XPMPMultiplayerCleanup();
+    return nAllocFrames > 0 ? 1 : 0;
+}
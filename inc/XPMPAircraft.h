@@ -31,6 +31,10 @@
 #include <string>
 #include <vector>
 #include <list>
+#include <functional>
+#include <memory>
+#include <future>
+#include <cmath>
 
 //
 // MARK: XPMP2 New Definitions
@@ -137,6 +141,32 @@ struct CSLModelInfo_t {
     CSLModelInfo_t(const XPMP2::CSLModel& csl);
 };
 
+/// Criteria by which XPMP2::CSLModelsQuery() filters the catalog of CSL models
+enum CSLModelFilterTy {
+    CSL_FILTER_TYPE = 0,        ///< ICAO aircraft type, like "A319"
+    CSL_FILTER_AIRLINE,         ///< ICAO airline code, like "DLH"
+    CSL_FILTER_RELATED,         ///< all models in the same "related" group as the given ICAO aircraft type
+    CSL_FILTER_PACKAGE,         ///< CSL package name as defined by `xsb_aircraft.txt::EXPORT_NAME`
+};
+
+/// Number of CSL models in the catalog, same as XPMPGetNumberOfInstalledModels()
+size_t CSLModelsCount ();
+
+/// @brief Information on the `_idx`-th CSL model in constant time
+/// @note Index numbers may change if more models are loaded, don't rely on them.
+/// @param _idx Number between `0` and `CSLModelsCount()-1`
+/// @exception std::out_of_range if `_idx` is too large
+CSLModelInfo_t CSLModelsGetInfo (size_t _idx);
+
+/// @brief Returns all CSL models meeting the filter criterion
+/// @details Backed by indexes built when loading the models,
+///          so the effort depends on the number of results only, not on the size of the catalog.
+/// @param _filter Which attribute to filter on
+/// @param _value Value the attribute must equal (or ICAO aircraft type for CSL_FILTER_RELATED)
+/// @return Vector of model information, sorted by related group, type, and model id
+std::vector<CSLModelInfo_t> CSLModelsQuery (CSLModelFilterTy _filter,
+                                            const std::string& _value);
+
 /// @brief Actual representation of all aircraft in XPMP2.
 /// @note In modern implementations, this class shall be subclassed by your plugin's code.
 class Aircraft {
@@ -211,7 +241,10 @@ protected:
     bool bVisible               = true;     ///< Shall this plane be drawn at the moment?
     
     XPMP2::CSLModel*    pCSLMdl = nullptr;  ///< the CSL model in use
+    XPMP2::CSLModel*    pCSLMdlUpgrade = nullptr;   ///< progressive matching: better model being loaded, replaces `pCSLMdl` once ready
+    XPMP2::CSLModel*    pLODMdl = nullptr;  ///< distance-based level of detail: generic low-detail model shown while far away
     int                 matchQuality = -1;  ///< quality of the match with the CSL model
+    int                 upgradeQuality = 0; ///< quality of `pCSLMdlUpgrade` if found by UpgradeModel(), which then replaces `pCSLMdl` directly
     int                 acRelGrp = 0;       ///< related group, ie. line in `related.txt` in which this a/c appears, if any
     
     // this is data from about a second ago to calculate cartesian velocities
@@ -220,6 +253,9 @@ protected:
     
     /// X-Plane instance handles for all objects making up the model
     std::list<XPLMInstanceRef> listInst;
+    /// @brief Gather index into `v` if the instances were created with the model's dataRef subset only
+    /// @details `nullptr` if instances use all dataRefs
+    const std::vector<uint16_t>* pInstDrIdx = nullptr;
     /// Which `sim/cockpit2/tcas/targets`-index does this plane occupy? [1..63], `-1` if none
     int                 tcasTargetIdx = -1;
 
@@ -232,6 +268,8 @@ protected:
 
     /// Y Probe for terrain testing, needed in ground clamping
     XPLMProbeRef        hProbe = nullptr;
+    /// Terrain height found by the last Y probe (local coordinates), reused while the quality governor thins out probing
+    float               probeGroundY = NAN;
     
     // Data used for drawing icons in X-Plane's map
     int                 mapIconRow = 0;     ///< map icon coordinates, row
@@ -242,6 +280,10 @@ protected:
     
 private:
     bool bDestroyInst           = false;    ///< Instance to be destroyed in next flight loop callback?
+    bool bWaitMdlLoad           = false;    ///< Waiting for the model to finish loading, will be notified by the model
+    bool bLODWanted             = false;    ///< Far enough away to be shown by the low-detail model?
+    bool bInstLOD               = false;    ///< Instances are (to be) created from the low-detail model `pLODMdl`?
+    bool bRenderAdmitted        = true;     ///< Admitted to rendering under the cap on rendered aircraft?
     
 public:
     /// Constructor creates a new aircraft object, which will be managed and displayed
@@ -273,6 +315,8 @@ public:
     bool        IsCurrentlyShownAsTcasTarget () const { return tcasTargetIdx >= 1; }
     /// Is this plane currently also being tracked by X-Plane's classic AI/multiplayer?
     bool        IsCurrentlyShownAsAI () const;
+    /// Is this plane admitted to rendering? (Not if exceeding the configured maximum number of rendered aircraft)
+    bool        IsRenderAdmitted () const { return bRenderAdmitted; }
     /// Is this plane to be drawn on TCAS? (It will if transponder is not switched off)
     bool        ShowAsAIPlane () const { return IsVisible() && acRadar.mode != xpmpTransponderMode_Standby; }
     /// Reset TCAS target slot index to `-1`
@@ -294,6 +338,12 @@ public:
     /// @brief Finds a match again, using the existing parameters, eg. after more models have been loaded
     /// @return match quality, the lower the better
     int ReMatchModel () { return ChangeModel(acIcaoType,acIcaoAirline,acLivery); }
+    
+    /// @brief Matches again, but changes the model only if a better one is found
+    /// @details Keeps showing the current model until the better one is loaded.
+    ///          Called automatically for aircraft, which might benefit from models newly added to the catalog.
+    /// @return Is the plane switching to a better model?
+    bool UpgradeModel ();
 
     /// Assigns the given model per name, returns if successful
     bool AssignModel (const std::string& _modelName);
@@ -307,6 +357,13 @@ public:
     int         GetMatchQuality () const { return matchQuality; }
     /// Vertical offset, ie. the value that needs to be added to `drawInfo.y` to make the aircraft appear on the ground
     float       GetVertOfs () const;
+    /// @brief Radius [m] of a sphere around the plane's position, which encloses the entire model
+    /// @details Read from the `.obj` files, until then estimated from the wake turbulence category.
+    ///          Can serve distance or frustum culling, or to compute the on-screen size.
+    float       GetModelRadius () const;
+    /// @brief Height [m] of the model's top above the plane's position
+    /// @details Read from the `.obj` files, until then estimated from the wake turbulence category.
+    float       GetModelTop () const;
 
     /// Is the a/c object valid?
     bool IsValid() const { return bValid; }
@@ -318,6 +375,12 @@ public:
     /// Is the plane visible?
     bool IsVisible () const { return bVisible && bValid; }
     
+    /// @brief Approximate memory footprint of this object in bytes
+    /// @details `sizeof(Aircraft)` plus heap memory used by members (strings exceeding
+    ///          the small string buffer, the dataRef array, and the list of instance handles).
+    ///          Members of derived classes are not included.
+    size_t GetMemFootprint () const;
+    
     /// Distance to camera [m]
     float GetCameraDist () const { return camDist; }
     /// Bearing from camera [°]
@@ -454,6 +517,8 @@ public:
 protected:
     /// Internal: Flight loop callback function controlling update and movement of all planes
     static float FlightLoopCB (float, float, int, void*);
+    /// Internal: Decide which aircraft are rendered if the number of rendered aircraft is capped
+    static void AdmitForRendering ();
     /// Internal: This puts the instance into XP's sky and makes it move
     void DoMove ();
     /// Internal: Update the plane's distance/bearing from the camera location
@@ -464,6 +529,20 @@ protected:
     bool CreateInstances ();
     /// Destroy all instances
     void DestroyInstances ();
+    /// Internal: Called by a CSL model, for which we wait, when its loading sequence has ended
+    void ModelLoaded (XPMP2::CSLModel* pMdl);
+    /// Internal: Use the given model, which has been matched with quality `q`, and have `pUpgrade` loaded if given
+    void UseModel (XPMP2::CSLModel* pMdl, int q, XPMP2::CSLModel* pUpgrade);
+    /// Internal: The model instances are (to be) created from, either the matched or the low-detail model
+    XPMP2::CSLModel* GetInstModel () const { return bInstLOD ? pLODMdl : pCSLMdl; }
+    
+    // Distance-based level of detail, implemented in LOD.cpp:
+    /// Decide if the low-detail model is to be shown, based on camera distance
+    void LODUpdate ();
+    /// Switch instances between matched and low-detail model once the target model is loaded
+    void LODSwap ();
+    /// Return to the matched model, e.g. before the model changes
+    void LODReset ();
     
     /// @brief Put together the map label
     /// @details Called about once a second. Label depends on tcasTargetIdx
@@ -476,11 +555,54 @@ protected:
     friend void AIMultiUpdate ();
     friend size_t AIUpdateTCASTargets ();
     friend size_t AIUpdateMultiplayerDataRefs ();
+    // Restoring from a scene snapshot, implemented in Scene.cpp
+    friend bool SceneRestoreAc (Aircraft& ac,
+                                const std::string& _icaoType,
+                                const std::string& _icaoAirline,
+                                const std::string& _livery,
+                                const std::string& _modelName);
+    // Models notify waiting aircraft when loading ends, implemented in CSLModels.cpp
+    friend class CSLModel;
 };
 
 /// Find aircraft by its plane ID, can return nullptr
 Aircraft* AcFindByID (XPMPPlaneID _id);
 
+//
+// MARK: Command queue for use from any thread
+//       Aircraft lifecycle operations need to be executed in X-Plane's main thread.
+//       These functions can be called from any thread. They queue the command
+//       and return immediately. Queued commands are executed in the next
+//       flight loop(s), limited by a per-frame time budget.
+//       Exceptions (e.g. XPMP2::XPMP2Error raised by the constructor)
+//       are passed on via the returned future.
+//
+
+/// @brief Queue the creation of an aircraft
+/// @param _fCreate Function called in X-Plane's main thread, shall create your XPMP2::Aircraft-derived object.
+///                 The object stays yours, XPMP2 doesn't take ownership.
+/// @return Future receiving the plane id of the created aircraft
+std::future<XPMPPlaneID> AcQueueCreate (std::function<Aircraft*()> _fCreate);
+
+/// @brief Queue the destruction of an aircraft
+/// @details The queue takes over ownership of the object and `delete`s it in X-Plane's main thread.
+///          Aircraft, which you don't own exclusively or which were not created with `new`,
+///          need to be destroyed by you in the main thread instead.
+/// @param _pAc Your aircraft object, ownership is passed to the queue
+/// @return Future receiving if an aircraft was passed (and has now been destroyed)
+std::future<bool> AcQueueDestroy (std::unique_ptr<Aircraft> _pAc);
+
+/// @brief Queue a model change, see XPMP2::Aircraft::ChangeModel()
+/// @return Future receiving the match quality, `-1` if the plane doesn't exist
+std::future<int> AcQueueChangeModel (XPMPPlaneID _id,
+                                     const std::string& _icaoType,
+                                     const std::string& _icaoAirline,
+                                     const std::string& _livery);
+
+/// @brief Queue a visibility change, see XPMP2::Aircraft::SetVisible()
+/// @return Future receiving if the plane exists
+std::future<bool> AcQueueSetVisible (XPMPPlaneID _id, bool _bVisible);
+
 //
 // MARK: XPMP2 Exception class
 //
@@ -56,6 +56,8 @@
 #define _XPLMMultiplayer_h_
 
 #include <string>
+#include <vector>
+#include <cstdint>
 #include "XPLMDefs.h"
 
 #ifdef __cplusplus
@@ -260,10 +262,18 @@ constexpr XPMPPlaneID MAX_MODE_S_ID = 0x00FFFFFF;
 // Config key definitions
 #define XPMP_CFG_ITM_REPLDATAREFS    "replace_datarefs"     ///< Config key: Replace dataRefs in OBJ8 files upon load, creating new OBJ8 files for XPMP2 (defaults to OFF!)
 #define XPMP_CFG_ITM_REPLTEXTURE     "replace_texture"      ///< Config key: Replace textures in OBJ8 files upon load if needed (specified on the OBJ8 line in xsb_aircraft.txt), creating new OBJ8 files
+#define XPMP_CFG_ITM_MATCHLOADED     "match_prefer_loaded"  ///< Config key: Model matching prefers models already loaded among equally good matches
+#define XPMP_CFG_ITM_MATCHPROGRESS   "match_progressive"    ///< Config key: Show an already loaded lesser match right away, switch to the best match once loaded
+#define XPMP_CFG_ITM_WATCHCSL        "watch_csl"            ///< Config key: Watch loaded CSL folders for changes and add/update/remove models while running
+#define XPMP_CFG_ITM_SHAREDCAT       "shared_catalog"       ///< Config key: Share the parsed CSL catalog with other XPMP2 plugins via a cache file in `Output/caches/XPMP2`
 #define XPMP_CFG_ITM_CLAMPALL        "clamp_all_to_ground"  ///< Config key: Ensure no plane sinks below ground, no matter of XPMP2::Aircraft::bClampToGround
 #define XPMP_CFG_ITM_HANDLE_DUP_ID   "handle_dup_id"        ///< Config key: Boolean: If XPMP2::Aircraft::modeS_id already exists then assign a new unique one, overwrites XPMP2::Aircraft::modeS_id
+#define XPMP_CFG_ITM_MAXRENDERED     "max_rendered"         ///< Config key: Maximum number of aircraft rendered, the closest/most important ones are admitted, `0` = unlimited
+#define XPMP_CFG_ITM_FRAMETIME       "frame_time_target"    ///< Config key: Target frame time [ms], XPMP2 reduces labels, rendered aircraft, update and clamping rates if exceeded, `0` = off
 #define XPMP_CFG_ITM_LOGLEVEL        "log_level"            ///< Config key: General level of logging into `Log.txt` (0 = Debug, 1 = Info, 2 = Warning, 3 = Error, 4 = Fatal)
 #define XPMP_CFG_ITM_MODELMATCHING   "model_matching"       ///< Config key: Write information on model matching into `Log.txt`
+#define XPMP_CFG_ITM_PROFILESTARTUP  "profile_startup"      ///< Config key: Profile startup phases and CSL package loading, see XPMPWriteStartupProfile()
+#define XPMP_CFG_ITM_COSTATTR        "cost_attribution"     ///< Config key: Sample time spent per aircraft, aircraft class, and model, see XPMPGetCostTopN()
 
 /// @brief Definition for the type of configuration callback function
 /// @details The plugin using XPMP2 can provide such a callback function via XPMPMultiplayerInit().
@@ -273,10 +283,18 @@ constexpr XPMPPlaneID MAX_MODE_S_ID = 0x00FFFFFF;
 /// `------- | ------------------- | ---- | ------- | -------------------------------------------------------------------------`\n
 /// `models  | replace_datarefs    | int  |    0    | Replace dataRefs in OBJ8 files upon load, creating new OBJ8 files for XPMP2 (defaults to OFF!)`\n
 /// `models  | replace_texture     | int  |    1    | Replace textures in OBJ8 files upon load if needed (specified on the OBJ8 line in xsb_aircraft.txt), creating new OBJ8 files`\n
+/// `models  | match_prefer_loaded | int  |    0    | Model matching prefers models already loaded among equally good matches`\n
+/// `models  | match_progressive   | int  |    0    | Show an already loaded lesser match right away, switch to the best match once loaded`\n
+/// `models  | watch_csl           | int  |    0    | Watch loaded CSL folders for changes and add/update/remove models while running`\n
+/// `models  | shared_catalog      | int  |    0    | Share the parsed CSL catalog with other XPMP2 plugins via a cache file in Output/caches/XPMP2`\n
 /// `planes  | clamp_all_to_ground | int  |    1    | Ensure no plane sinks below ground, no matter of XPMP2::Aircraft::bClampToGround`\n
 /// `planes  | handle_dup_id       | int  |    0    | Boolean: If XPMP2::Aircraft::modeS_id already exists then assign a new unique one, overwrites XPMP2::Aircraft::modeS_id`\n
+/// `planes  | max_rendered        | int  |    0    | Maximum number of aircraft rendered, the closest/most important ones are admitted, 0 = unlimited`\n
+/// `planes  | frame_time_target   | int  |    0    | Target frame time [ms], XPMP2 reduces labels, rendered aircraft, update and clamping rates if exceeded, 0 = off`\n
 /// `debug   | log_level           | int  |    2    | General level of logging into Log.txt (0 = Debug, 1 = Info, 2 = Warning, 3 = Error, 4 = Fatal)`\n
 /// `debug   | model_matching      | int  |    0    | Write information on model matching into Log.txt`\n
+/// `debug   | profile_startup     | int  |    0    | Profile startup phases and CSL package loading, see XPMPWriteStartupProfile()`\n
+/// `debug   | cost_attribution    | int  |    0    | Sample time spent per aircraft, aircraft class, and model, see XPMPGetCostTopN()`\n
 /// @note There is no immediate requirement to check the value of `_section` in your implementation.
 ///       `_key` by itself is unique. Compare it with any of the `XPMP_CFG_ITM_*` values and return your value.
 /// @param _section Configuration section, ie. group of values, any of the `XPMP_CFG_SEC_...` values
@@ -395,10 +413,21 @@ bool XPMPHasControlOfAIAircraft();
 ///          file, like textures. If validated successfully the model is added to an
 ///          internal catalogue.\n
 ///          Actual loading of objects is done later and asynchronously only
-///          when needed during aircraft creation.
+///          when needed during aircraft creation.\n
+///          Existing aircraft, for which the added models provide a better match,
+///          switch to them over the next frames, each one as soon as its new model is loaded.
 /// @param inCSLFolder Root folder to start the search.
 const char *    XPMPLoadCSLPackage(const char * inCSLFolder);
 
+/// @brief Writes the startup profile, sorted by time, to `Log.txt`, and optionally to a JSON file
+/// @details Requires the config item `debug/profile_startup` to be set before XPMPMultiplayerInit().
+///          Then wall time, files touched, bytes read, and models produced are recorded
+///          for each startup phase and each CSL package. After each call to XPMPLoadCSLPackage()
+///          the profile is also written to `Log.txt` automatically.
+/// @param inJsonPath (optional) Path to a JSON file to write the profile to, as an array of objects
+/// @return Empty string on success, otherwise a human-readable error message
+const char *    XPMPWriteStartupProfile(const char * inJsonPath = nullptr);
+
 
 /// @brief Legacy function only provided for backwards compatibility. Does not actually do anything.
 [[deprecated("No longer needed, does not do anything.")]]
@@ -433,6 +462,7 @@ void XPMPGetModelInfo(int inIndex, const char **outModelName, const char **outIc
 /// @param[out] outIcao Receives ICAO aircraft designator
 /// @param[out] outAirline Receives ICAO airline code
 /// @param[out] outLivery Receives special livery string
+/// @see XPMP2::CSLModelsGetInfo() and XPMP2::CSLModelsQuery() for complete model information and filtered queries
 void XPMPGetModelInfo2(int inIndex, std::string& outModelName,  std::string& outIcao, std::string& outAirline, std::string& outLivery);
 
 
@@ -602,6 +632,103 @@ XPMPPlaneID XPMPGetNthPlane(long                    index);
 XPMP2::Aircraft* XPMPGetAircraft (XPMPPlaneID _id);
 
 
+/// @brief Reports the memory footprint of all aircraft into `Log.txt`
+/// @see XPMP2::Aircraft::GetMemFootprint()
+/// @return Total number of bytes used by all aircraft objects
+size_t XPMPReportAircraftFootprint ();
+
+
+/// @brief State of one aircraft as of the last published snapshot, see XPMPGetAircraftSnapshot()
+/// @details Plain data only, so that the whole snapshot is one contiguous copy
+struct XPMPAcState_t {
+    XPMPPlaneID     id = 0;                 ///< plane id (ICAO transponder hex code)
+    double          lat = 0.0;              ///< latitude [degrees]
+    double          lon = 0.0;              ///< longitude [degrees]
+    double          alt_ft = 0.0;           ///< altitude [ft]
+    float           x = 0.0f;               ///< local coordinates [m]
+    float           y = 0.0f;               ///< local coordinates [m]
+    float           z = 0.0f;               ///< local coordinates [m]
+    float           pitch = 0.0f;           ///< pitch [degrees]
+    float           heading = 0.0f;         ///< heading [degrees]
+    float           roll = 0.0f;            ///< roll [degrees]
+    float           gearRatio = 0.0f;       ///< gear deploy ratio
+    float           flapRatio = 0.0f;       ///< flaps deploy ratio
+    float           speedbrakeRatio = 0.0f; ///< speedbrakes deploy ratio
+    float           thrustRatio = 0.0f;     ///< thrust ratio
+    bool            lightsTaxi = false;     ///< taxi lights on?
+    bool            lightsLanding = false;  ///< landing lights on?
+    bool            lightsBeacon = false;   ///< beacon lights on?
+    bool            lightsStrobe = false;   ///< strobe lights on?
+    bool            lightsNav = false;      ///< navigation lights on?
+    bool            bVisible = false;       ///< visible, see XPMP2::Aircraft::IsVisible()
+    bool            bRendered = false;      ///< admitted for rendering, see XPMP2::Aircraft::IsRenderAdmitted()
+    char            cslModel[64] = "";      ///< name of the CSL model in use (potentially truncated)
+};
+
+/// @brief Copies the aircraft snapshot of the last frame, callable from any thread
+/// @details XPMP2 publishes an immutable snapshot of all aircraft once per frame
+///          into one of three buffers, so that readers never block the flight loop
+///          and the flight loop never waits for readers.
+///          Publishing starts with the first call to this function,
+///          so the very first call returns `false`.
+/// @param[out] outStates Receives the state of all aircraft, capacity is reused
+/// @param[out] outTs If given receives the network time of the snapshot
+/// @return Has a snapshot been available?
+bool XPMPGetAircraftSnapshot (std::vector<XPMPAcState_t>& outStates, float* outTs = nullptr);
+
+
+/// @brief Starts recording all aircraft input into a binary file
+/// @details Records create, model change, and destroy events as well as,
+///          once per frame, the state of all aircraft (`drawInfo`, `v`, `acRadar`,
+///          and - when changed - `acInfoTexts` and `label`).
+///          Replay the file with XPMPStartReplay() to reproduce a traffic situation.
+/// @param inFileName Path of the file to write, will be overwritten
+/// @return Empty string in case of success, otherwise a human-readable error message
+const char* XPMPStartRecording (const char* inFileName);
+
+/// Stops recording
+void XPMPStopRecording ();
+
+/// @brief Starts replaying a recording made by XPMPStartRecording()
+/// @details Replayed aircraft are created with the recorded plane ids,
+///          so they should not collide with your own aircraft.
+///          When the end of the recording is reached, all replayed aircraft are removed.
+/// @param inFileName Path of the recording
+/// @param inMaxSpeed `false`: replay in the original timing, `true`: replay one recorded frame per flight loop
+/// @return Empty string in case of success, otherwise a human-readable error message
+const char* XPMPStartReplay (const char* inFileName, bool inMaxSpeed = false);
+
+/// Stops replaying, removes all replayed aircraft
+void XPMPStopReplay ();
+
+
+/// Categories of cost attribution
+enum XPMPCostCategory_t {
+    xpmp_Cost_Aircraft = 0,     ///< time spent in XPMP2::Aircraft::UpdatePosition() per aircraft
+    xpmp_Cost_Type,             ///< time spent in XPMP2::Aircraft::UpdatePosition() per dynamic class (like `XPCAircraft` or your own subclass)
+    xpmp_Cost_Model,            ///< time spent creating instances per CSL model
+};
+
+/// Cost attributed to one aircraft, class, or model
+struct XPMPCostInfo_t {
+    std::string     name;           ///< plane id and model name, class name, or model name
+    unsigned long   samples = 0;    ///< number of samples taken
+    double          totalUs = 0.0;  ///< total time of all samples [us]
+    double          avgUs   = 0.0;  ///< average time per sample [us]
+    double          maxUs   = 0.0;  ///< maximum time of a single sample [us]
+};
+
+/// @brief Returns the top offenders of a cost category, sorted by total time
+/// @details Requires configuration item `debug/cost_attribution`.
+///          Aircraft cost is sampled every 16th frame only.
+/// @param inCat Category of cost attribution
+/// @param inN Maximum number of entries to return
+std::vector<XPMPCostInfo_t> XPMPGetCostTopN (XPMPCostCategory_t inCat, size_t inN = 10);
+
+/// Resets all collected cost attribution data
+void XPMPResetCostStats ();
+
+
 /// @brief Define default aircraft and ground vehicle ICAO types
 /// @param _acIcaoType Default ICAO aircraft type designator, used when matching returns nothing
 /// @param _carIcaoType Type used to identify ground vehicels (internally defaults to "ZZZC") 
@@ -646,6 +773,106 @@ void            XPMPRegisterPlaneNotifierFunc(XPMPPlaneNotifier_f       inFunc,
 void            XPMPUnregisterPlaneNotifierFunc(XPMPPlaneNotifier_f     inFunc,
                                                 void *                  inRefcon);
 
+
+/// One event as delivered to a batched notification callback
+struct XPMPPlaneNotificationEvent_t {
+    XPMPPlaneID             planeId;        ///< Identifies the affected plane
+    XPMPPlaneNotification   notification;   ///< The event that took place
+};
+
+
+/// @brief Type of the batched callback function you provide,
+///        called once per frame with all events of that frame
+/// @details Events are in the order they happened. If a plane is created and
+///          destroyed again within the same frame then none of its events
+///          are delivered. Repeated model changes of the same plane within
+///          one frame are delivered only once.
+/// @note    By the time of the callback, planes reported as destroyed no longer exist.
+/// @param inEvents Array of events
+/// @param inNumEvents Number of events in `inEvents`, always > 0
+/// @param inRefcon A refcon that you provided in XPMPRegisterPlaneNotifierBatchFunc()
+typedef void (*XPMPPlaneNotifierBatch_f)(const XPMPPlaneNotificationEvent_t* inEvents,
+                                         int                                 inNumEvents,
+                                         void *                              inRefcon);
+
+
+/// @brief Registers a batched callback, which is called once per frame
+///        with all events defined in ::XPMPPlaneNotification that happened since
+/// @details This is an alternative to XPMPRegisterPlaneNotifierFunc()
+///          that avoids calling back for each individual event,
+///          which can be many if a lot of planes are created at once.
+/// @param inFunc Pointer to your callback function
+/// @param inRefcon A refcon passed through to your callback
+void            XPMPRegisterPlaneNotifierBatchFunc(XPMPPlaneNotifierBatch_f  inFunc,
+                                                   void *                    inRefcon);
+
+
+/// @brief Unregisters a batched notification callback. Both function pointer and refcon
+///        must match what was registered.
+/// @param inFunc Pointer to your callback function
+/// @param inRefcon A refcon passed through to your callback
+void            XPMPUnregisterPlaneNotifierBatchFunc(XPMPPlaneNotifierBatch_f inFunc,
+                                                     void *                   inRefcon);
+
+/************************************************************************************
+ * MARK: SCENE SNAPSHOT AND RESTORE
+ ************************************************************************************/
+
+/// @brief Serializes all current aircraft into a compact binary blob
+/// @details Call this before your plugin unloads or re-creates all its aircraft.
+///          Per aircraft, the blob holds plane id, CSL model in use, match quality,
+///          `drawInfo`, the `v` array, label, radar status, info texts, and TCAS slot.
+///          Keep the blob in memory or in a file and hand it back to
+///          XPMPSceneRestore() after the reload.
+/// @note The blob is meant to survive a plugin reload only,
+///       it is not suitable for long-term storage or exchange between platforms.
+/// @param[out] outBlob Receives the binary snapshot
+/// @return Number of aircraft in the snapshot
+size_t XPMPSceneSnapshot (std::vector<uint8_t>& outBlob);
+
+/// @brief Provides a previously taken snapshot for restoring aircraft
+/// @details Call after XPMPMultiplayerInit() and after loading CSL packages,
+///          but before re-creating your aircraft.
+///          Aircraft, which are then created with the same plane id
+///          (XPMP2::Aircraft::modeS_id) as in the snapshot, take over position,
+///          dataRef values, texts, and TCAS slot from the snapshot.
+///          Type, airline, and livery always are the ones passed to the constructor.
+///          Only if these (and the model name, if passed) are unchanged
+///          the aircraft also takes over the model and skips model matching.
+///          Restore data not used within 60 seconds is discarded.
+/// @param inBlob A blob previously created by XPMPSceneSnapshot()
+/// @param inMaxInstPerFrame (optional) While restoring, at most this many aircraft
+///        create their instances per frame to avoid a stutter. `0` means unlimited.
+/// @return Empty string in case of success, otherwise a human-readable error message.
+const char* XPMPSceneRestore (const std::vector<uint8_t>& inBlob,
+                              int inMaxInstPerFrame = 10);
+
+/// @brief Discards any restore data not yet used by re-created aircraft
+void XPMPSceneRestoreDiscard ();
+
+/************************************************************************************
+ * MARK: LEVEL OF DETAIL
+ ************************************************************************************/
+
+/// @brief Configure the distance beyond which aircraft are shown by a generic low-detail model
+/// @details Low-detail models are defined per Doc8643 classification and WTC by XPMPSetLODModel().
+///          Aircraft coming closer than 90% of this distance are shown with their matched model again.
+///          Switching happens only once the other model is loaded, so that aircraft stay visible throughout.
+/// @param _dist_nm Distance in nm, `0` disables distance-based level of detail (default)
+void XPMPSetLODDistance (float _dist_nm);
+
+/// @brief Define the generic low-detail model for distant aircraft of a Doc8643 classification and WTC
+/// @details The most specific definition is used: classification and WTC,
+///          then classification only, then WTC only, then a definition with both empty.
+///          Call after loading CSL packages.
+/// @param inClassification Doc8643 classification like "L2J", empty for any classification
+/// @param inWTC Wake turbulence category like "M", empty for any category
+/// @param inModelName Id of a loaded CSL model (see CSLModelInfo_t::cslId), `nullptr` or empty removes the definition
+/// @return Empty string in case of success, otherwise a human-readable error message.
+const char* XPMPSetLODModel (const char* inClassification,
+                             const char* inWTC,
+                             const char* inModelName);
+
 /************************************************************************************
  * MARK: PLANE RENDERING API (unsued in XPMP2)
  ************************************************************************************/
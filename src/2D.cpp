@@ -112,6 +112,9 @@ static bool ConvertTo2d(const float x, const float y, const float z,
 // MARK: Drawing Control
 //
 
+/// Distance between the model's top and its label [m]
+constexpr float LABEL_TOP_MARGIN = 1.0f;
+
 /// @brief Write the labels of all aircraft
 /// @see This code bases on the last part of `XPMPDefaultPlaneRenderer` of the original libxplanemp
 /// @author Ben Supnik, Chris Serio, Chris Collins, Birger Hoppe
@@ -128,9 +131,11 @@ void TwoDDrawLabels ()
     // Determine the maximum distance for label drawing.
     // Depends on current actual visibility as well as a configurable maximum
     XPLMReadCameraPosition(&posCamera);
+    // (The quality governor might reduce it.)
     const float maxLabelDist = (std::min(glob.maxLabelDist,
                                          (glob.bLabelCutOffAtVisibility && drVisibility) ? XPLMGetDataf(drVisibility) : glob.maxLabelDist)
-                                * posCamera.zoom);    // Labels get easier to see when users zooms.
+                                * posCamera.zoom      // Labels get easier to see when users zooms.
+                                * GovLabelDistFactor());
     
     // Loop over all aircraft and draw their labels
     for (auto& p: glob.mapAc)
@@ -146,18 +151,8 @@ void TwoDDrawLabels ()
                 continue;
             
             // Vertical label offset: Idea is to place the label _above_ the plane
-            // (as opposed to across), but finding the exact height of the plane
-            // would require scanning the .obj file (well...we do so in CSLObj::FetchVertOfsFromObjFile (), but don't want to scan _every_ file)
-            // We just use 3 fixed offset depending on the wake-turbulence category
-            float vertLabelOfs = 7.0f;
-            const XPMP2::CSLModel* pCSLMdl = ac.GetModel();
-            if (pCSLMdl) {              // there's no reason why there shouldn't be a CSL model...just to be safe, though
-                switch (pCSLMdl->GetDoc8643().wtc[0])
-                {
-                    case 'L': vertLabelOfs = 3.0f; break;
-                    case 'H': vertLabelOfs = 8.0f; break;
-                }
-            }
+            // (as opposed to across), so we use the model's top as read from the .obj files
+            const float vertLabelOfs = ac.GetModelTop() + LABEL_TOP_MARGIN;
         
             // Map the 3D coordinates of the aircraft to 2D coordinates of the flat screen
             int x = -1, y = -1;
@@ -195,6 +190,7 @@ int CPLabelDrawing (XPLMDrawingPhase     /*inPhase*/,
                     void *               /*inRefcon*/)
 {
     UPDATE_CYCLE_NUM;               // DEBUG only: Store current cycle number in glob.xpCycleNum
+    AllocScope allocScope;          // XPMP2_ALLOC_AUDIT only: Count allocations
     TwoDDrawLabels();
     return 1;
 }
@@ -48,8 +48,6 @@ namespace XPMP2 {
 constexpr float FAR_AWAY_VAL_GL = 9999999.9f;
 /// How often do we reassign AI slots? [seconds]
 constexpr float AISLOT_CHANGE_PERIOD = 15.0f;
-/// How much distance does each AIPrio add?
-constexpr int AI_PRIO_MULTIPLIER = 10 * M_per_NM;
 /// A constant array of zero values supporting quick array initialization
 float F_NULL[10] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
 
@@ -440,6 +438,7 @@ size_t AIUpdateTCASTargets ()
                 ac.prev_ts = now;
                 
                 // Flight or tail number as FlightID
+                // (short enough for the small string optimization, so doesn't allocate)
                 char s[8];
                 memset(s, 0, sizeof(s));
                 STRCPY_S(s, ac.GetFlightId().c_str());
@@ -447,7 +446,7 @@ size_t AIUpdateTCASTargets ()
                 
                 // Icao Type code
                 memset(s, 0, sizeof(s));
-                STRCPY_S(s, ac.acIcaoType.substr(0,sizeof(s)-1).c_str());
+                STRCPY_S(s, ac.acIcaoType.c_str());   // truncates, no need for a temporary substr()
                 XPLMSetDatab(drTcasIcaoType, s, int(slot * sizeof(s)), sizeof(s));
                 
                 // Shared data for providing textual info (see XPMPInfoTexts_t)
@@ -23,6 +23,9 @@
 
 namespace XPMP2 {
 
+/// How much distance does each AIPrio add?
+constexpr int AI_PRIO_MULTIPLIER = 10 * M_per_NM;
+
 /// Initialize the module
 void AIMultiInit ();
 
@@ -45,12 +45,30 @@ using namespace XPMP2;
 #define ERR_ADD_DATAREF_INIT    "Could not add dataRef %s, XPMP2 not yet initialized?"
 #define ERR_ADD_DATAREF_PLANES  "Could add dataRef %s only if no aircraft are flying, but currently there are %lu aircraft."
 #define DEBUG_DATAREF_ADDED     "Added dataRef %s as index %lu"
+#define INFO_FOOTPRINT          "Aircraft footprint: %lu aircraft use %lu bytes (avg %lu, sizeof(Aircraft) = %lu), %lu with further heap allocations besides %lu bytes of dataRef values"
+#define DEBUG_CMD_QUEUE_DONE    "Command queue: Executed %lu commands, %lu remaining"
 
 namespace XPMP2 {
 
 /// The id of our flight loop callback
 XPLMFlightLoopID gFlightLoopID = nullptr;
 
+/// The id of the flight loop callback executing queued commands
+XPLMFlightLoopID gCmdFlightLoopID = nullptr;
+
+/// Time budget per frame for executing queued commands
+constexpr std::chrono::microseconds CMD_QUEUE_BUDGET(2000);
+/// How often to look for queued commands while there are no aircraft, which would wake us [s]
+constexpr float CMD_QUEUE_IDLE_PERIOD = 0.5f;
+
+/// How often to re-decide which aircraft are rendered if capped? [s]
+constexpr float RENDER_ADMIT_PERIOD = 1.0f;
+/// Hysteresis: an already rendered aircraft's score is reduced by this factor, so that it isn't easily replaced
+constexpr float RENDER_ADMIT_HYSTERESIS = 0.9f;
+
+/// Flight loop callback executing queued commands
+static float AcCmdFlightLoopCB (float, float, int, void*);
+
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wexit-time-destructors"
 /// @brief The list of dataRefs we support to be read by the CSL Model (for gear, flaps, lights etc.)
@@ -118,6 +136,16 @@ std::vector<XPLMDataRef> ahDataRefs;
 /// Standard name for "no model"
 static std::string noMdlName("<none>");     // exit-time destuctor accepted
 
+/// Commands queued from any thread for execution in XP's main thread
+static std::list<std::function<void()> > gListCmds;
+/// Controls access to gListCmds
+static std::mutex gMutexCmds;
+/// Are there any queued commands? (Saves locking the mutex every frame)
+static std::atomic_bool gbCmdQueued(false);
+
+/// Scores computed by Aircraft::AdmitForRendering(), kept to reuse the buffer's capacity
+static std::vector<std::pair<float,Aircraft*> > gVecAdmitScore;
+
 #pragma clang diagnostic pop
 
 
@@ -134,7 +162,8 @@ Aircraft::Aircraft(const std::string& _icaoType,
 modeS_id(_modeS_id ? _modeS_id : glob.NextPlaneId()),    // assign the next synthetic plane id
 drawInfo({sizeof(drawInfo), 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f}),
 // create an approrpiately sized 'v' array and initialize with zeroes
-v(DR_NAMES.size(), 0.0f)
+// (DR_NAMES includes the terminating nullptr, which doesn't need a value)
+v(DR_NAMES.size()-1, 0.0f)
 {
     // Verify uniqueness of modeS if defined by caller
     if (_modeS_id) {
@@ -156,8 +185,13 @@ v(DR_NAMES.size(), 0.0f)
         }
     }
     
+    // If restoring a scene snapshot then this a/c might take over
+    // its state from there, incl. the model if type/airline/livery are unchanged
+    if (modeS_id == _modeS_id)
+        SceneRestoreAc(*this, _icaoType, _icaoAirline, _livery, _modelName);
+    
     // if given try to find the CSL model to use by its name
-    if (!_modelName.empty())
+    if (!pCSLMdl && !_modelName.empty())
         AssignModel(_modelName);
     
     // Let Matching happen, if we still don't have a model
@@ -195,6 +229,7 @@ Aircraft::~Aircraft ()
     XPMPSendNotification(*this, xpmp_PlaneNotification_Destroyed);
     
     // Remove the instance
+    LODReset();
     DestroyInstances();
     
     // Decrease the reference counter of the CSL model
@@ -203,6 +238,7 @@ Aircraft::~Aircraft ()
 
     // remove myself from the global map of planes
     glob.mapAc.erase(modeS_id);
+    CostAircraftRemoved(modeS_id);
     
     // remove the Y Probe
     if (hProbe) {
@@ -244,6 +280,7 @@ std::string XPMP2::Aircraft::GetFlightId() const
         std::string ret(acInfoTexts.aptFrom);
         ret += '-';
         ret += acInfoTexts.aptTo;
+        return ret;
     }
 
     // nothing found
@@ -258,11 +295,58 @@ int Aircraft::ChangeModel (const std::string& _icaoType,
 {
     // Let matching happen
     CSLModel* pMdl = nullptr;
+    CSLModel* pUpgrade = nullptr;
     int q = CSLModelMatching(_icaoType,
                              _icaoAirline,
                              _livery,
-                             pMdl);
+                             pMdl,
+                             &pUpgrade);
+
+    // save the match parameters, then use the selected model
+    acIcaoType      = _icaoType;
+    acIcaoAirline   = _icaoAirline;
+    acLivery        = _livery;
+    UseModel(pMdl, q, pUpgrade);
+    return q;
+}
+
 
+// Switch to a better model only, keeping the current one until the better one is loaded
+bool Aircraft::UpgradeModel ()
+{
+    // Match again, but without progressive matching, we want to know the best model
+    CSLModel* pMdl = nullptr;
+    std::vector<CSLModel*> vecCand;
+    const int q = CSLModelMatching(acIcaoType, acIcaoAirline, acLivery,
+                                   pMdl, nullptr, &vecCand);
+    if (!pMdl)
+        return false;
+    // Not better than what we have? (A model assigned by name has quality 0 and is kept anyway)
+    if (pCSLMdl && q >= matchQuality)
+        return false;
+    // Already using or loading one of the best models?
+    for (const CSLModel* pCand: vecCand)
+        if (pCand == pCSLMdl || pCand == pCSLMdlUpgrade)
+            return false;
+    
+    // Nothing shown yet or the better model is ready: switch right away
+    if (!pCSLMdl || pMdl->IsReady()) {
+        UseModel(pMdl, q, nullptr);
+        return true;
+    }
+    
+    // Have the better model loaded first, ModelLoaded() switches to it then
+    pCSLMdlUpgrade  = pMdl;
+    upgradeQuality  = q;
+    if (pMdl->RequestLoad(modeS_id))
+        ModelLoaded(pMdl);              // (unlikely, but it could be ready already)
+    return true;
+}
+
+
+// Use the given model, which has been matched with the given quality
+void Aircraft::UseModel (CSLModel* pMdl, int q, CSLModel* pUpgrade)
+{
     // Is this a change to the currently used model?
     const bool bChangeExisting = (pCSLMdl && pMdl != pCSLMdl);
     if (bChangeExisting) {
@@ -273,16 +357,17 @@ int Aircraft::ChangeModel (const std::string& _icaoType,
                 pMdl ? pMdl->GetModelName().c_str() : noMdlName.c_str());
         DestroyInstances();
     }
+    // A different model might need a different low-detail model
+    if (pMdl != pCSLMdl)
+        LODReset();
     // Decrease the reference counter of the current CSL model
     if (pCSLMdl)
         pCSLMdl->DecRefCnt();
 
     // save the newly selected model
     pCSLMdl         = pMdl;             // could theoretically be nullptr!
+    bWaitMdlLoad    = false;            // (a new model needs to be requested again)
     matchQuality    = q;
-    acIcaoType      = _icaoType;
-    acIcaoAirline   = _icaoAirline;
-    acLivery        = _livery;
     acRelGrp        = RelatedGet(acIcaoType);
 
     // Increase the reference counter of the CSL model to track that the object is being used
@@ -296,7 +381,11 @@ int Aircraft::ChangeModel (const std::string& _icaoType,
     if (bChangeExisting)
         XPMPSendNotification(*this, xpmp_PlaneNotification_ModelChanged);
 
-    return q;
+    // Progressive matching: Have the better model loaded in the background, we'll be notified
+    pCSLMdlUpgrade  = pUpgrade;
+    upgradeQuality  = 0;
+    if (pCSLMdlUpgrade && pCSLMdlUpgrade->RequestLoad(modeS_id))
+        ModelLoaded(pCSLMdlUpgrade);    // (unlikely, but it could be ready already)
 }
 
 
@@ -319,12 +408,17 @@ bool Aircraft::AssignModel (const std::string& _modelName)
                 pMdl->GetModelName().c_str());
         DestroyInstances();                 // remove the current instance (which is based on the previous model)
     }
+    if (pMdl != pCSLMdl)
+        LODReset();
     // Decrease the reference counter of the current CSL model
     if (pCSLMdl)
         pCSLMdl->DecRefCnt();
     
     // save the newly selected model
     pCSLMdl         = pMdl;
+    pCSLMdlUpgrade  = nullptr;
+    upgradeQuality  = 0;
+    bWaitMdlLoad    = false;
     matchQuality    = 0;
     acIcaoType      = pCSLMdl->GetIcaoType();
     acIcaoAirline   = pCSLMdl->GetIcaoAirline();
@@ -352,24 +446,84 @@ const std::string& Aircraft::GetModelName () const
 }
 
 
+/// Heap memory used by a string, 0 if it fits into the small string buffer
+static size_t StrHeapSize (const std::string& s)
+{
+    static const size_t SSO_CAP = std::string().capacity();
+    return s.capacity() > SSO_CAP ? s.capacity() + 1 : 0;
+}
+
+// Approximate memory footprint of this object in bytes
+size_t Aircraft::GetMemFootprint () const
+{
+    size_t sz = sizeof(Aircraft);
+    sz += StrHeapSize(acIcaoType) + StrHeapSize(acIcaoAirline) + StrHeapSize(acLivery);
+    sz += StrHeapSize(label) + StrHeapSize(mapLabel);
+    sz += v.capacity() * sizeof(float);
+    // each list node holds the handle plus two links
+    sz += listInst.size() * (sizeof(XPLMInstanceRef) + 2 * sizeof(void*));
+    return sz;
+}
+
+
 // Vertical offset, ie. the value that needs to be added to drawInfo.y to make the aircraft appear on the ground
 /// @details 1. add `VERT_OFFSET`, which pushes the plane up on the tarmac onto its gear
 ///          2. reduce again by the tire deflection (which reduces gear's size,
 ///             but based on experience is not exactly aligned with planes altitude in meters.
 float Aircraft::GetVertOfs () const
 {
-    if (pCSLMdl)
-        return pCSLMdl->GetVertOfs() * vertOfsRatio - GetTireDeflection() * gearDeflectRatio;
+    // (applies to the model the instances are created from)
+    const CSLModel* pMdl = GetInstModel();
+    if (pMdl)
+        return pMdl->GetVertOfs() * vertOfsRatio - GetTireDeflection() * gearDeflectRatio;
     else
         return 0.0f;
 }
 
+/// @brief Rough model dimensions by wake turbulence category, used before the `.obj` files are scanned
+/// @param[out] radius Bounding-sphere radius [m]
+/// @param[out] top Height of the top above the plane's position [m]
+static void AcEstimateSize (const CSLModel* pCSLMdl, float& radius, float& top)
+{
+    radius = 25.0f;
+    top = 6.0f;
+    if (pCSLMdl) {
+        switch (pCSLMdl->GetDoc8643().wtc[0])
+        {
+            case 'L': radius = 10.0f; top = 2.0f; break;
+            case 'H': radius = 40.0f; top = 7.0f; break;
+        }
+    }
+}
+
+// Radius of a sphere around the plane's position, which encloses the entire model
+float Aircraft::GetModelRadius () const
+{
+    if (pCSLMdl && pCSLMdl->GetBounds().bValid)
+        return pCSLMdl->GetBounds().radius;
+    float radius, top;
+    AcEstimateSize(pCSLMdl, radius, top);
+    return radius;
+}
+
+// Height of the model's top above the plane's position
+float Aircraft::GetModelTop () const
+{
+    if (pCSLMdl && pCSLMdl->GetBounds().bValid)
+        return pCSLMdl->GetBounds().max[1];
+    float radius, top;
+    AcEstimateSize(pCSLMdl, radius, top);
+    return top;
+}
+
 // Static: Flight loop callback function
 float Aircraft::FlightLoopCB(float _elapsedSinceLastCall, float, int _flCounter, void*)
 {
     // This is a plugin entry function, so we try to catch all exceptions
     try {
         UPDATE_CYCLE_NUM;               // DEBUG only: Store current cycle number in glob.xpCycleNum
+        AllocFrameStart();              // XPMP2_ALLOC_AUDIT only: Count allocations per frame
+        AllocScope allocScope;
 
         // Update configuration
         glob.UpdateCfgVals();
@@ -381,6 +535,28 @@ float Aircraft::FlightLoopCB(float _elapsedSinceLastCall, float, int _flCounter,
         // As we need the current timestamp more often we read it here once
         const float now = GetMiscNetwTime();
 
+        // Reset the per-frame budget for instance creation
+        SceneFrameStart();
+        GovFrameStart(_flCounter);
+        const bool bCostSample = CostSampleFrame(_flCounter);
+        
+        // Commands queued from other threads? Wake up the command flight loop
+        if (gbCmdQueued)
+            XPLMScheduleFlightLoop(gCmdFlightLoopID, -1.0f, 0);
+        
+        // Advance models being loaded, notifies aircraft waiting for them
+        CSLModelsProcessLoads();
+        // After catalog changes: check some more aircraft for better matches
+        RematchFrame();
+        
+        // If replaying a recording: Drive the replayed aircraft
+        ReplayStep(now);
+        
+        // If the number of rendered aircraft is capped: Decide which are rendered
+        static float tsAdmit = 0.0f;
+        if (CheckEverySoOften(tsAdmit, RENDER_ADMIT_PERIOD, now))
+            AdmitForRendering();
+
         // Update positional and configurational values
         for (mapAcTy::value_type& pair : glob.mapAc) {
             Aircraft& ac = *pair.second;
@@ -392,7 +568,10 @@ float Aircraft::FlightLoopCB(float _elapsedSinceLastCall, float, int _flCounter,
                 continue;
             try {
                 // Have the aircraft provide up-to-date position and orientation values
-                ac.UpdatePosition(_elapsedSinceLastCall, _flCounter);
+                {
+                    CostTimer cost(bCostSample ? &ac : nullptr);
+                    ac.UpdatePosition(_elapsedSinceLastCall, _flCounter);
+                }
                 // A/c still valid? Then proceed:
                 if (ac.IsValid()) {
                     // If requested, clamp to ground, ie. make sure it is not below ground
@@ -401,23 +580,38 @@ float Aircraft::FlightLoopCB(float _elapsedSinceLastCall, float, int _flCounter,
                     // Update plane's distance/bearing every second only
                     if (CheckEverySoOften(ac.camTimLstUpd, 1.0f, now)) {
                         ac.UpdateDistBearingCamera(posCamera);
+                        ac.LODUpdate();
                         ac.ComputeMapLabel();
                     }
-                    // Actually move the plane, ie. the instance that represents it
-                    ac.DoMove();
+                    // Actually move the plane, ie. the instance that represents it,
+                    // distant aircraft not in every frame if the quality governor says so
+                    // (UpdatePosition() is still called every frame to account for all elapsed time)
+                    if (!GovSkipMove(ac))
+                        ac.DoMove();
                 }
             }
             CATCH_AC(ac)
         }
 
+        // Publish a snapshot of all aircraft for readers on other threads, record them if requested
+        SnapshotPublish(now);
+        RecordFrame(now);
+
         // Publish aircraft data on the AI/multiplayer dataRefs
         AIMultiUpdate();
+        
+        // Inform batch observers about this frame's events
+        XPMPFlushNotifications();
+        
+        // Let the quality governor evaluate how expensive this frame was
+        GovFrameEnd();
+        CostPeriodicReport();
     }
     catch (const std::exception& e) { LOG_MSG(logFATAL, ERR_EXCEPTION, e.what()); }
     catch (...) { LOG_MSG(logFATAL, ERR_EXCEPTION, "<unknown>"); }
 
-    // Don't call me again if there are no more aircraft,
-    if (glob.mapAc.empty()) {
+    // Don't call me again if there are no more aircraft (and no replay, which might create some),
+    if (glob.mapAc.empty() && !ReplayIsActive()) {
         LOG_MSG(logDEBUG, "Flight loop callback ended");
         return 0.0f;
     }
@@ -427,21 +621,89 @@ float Aircraft::FlightLoopCB(float _elapsedSinceLastCall, float, int _flCounter,
     }
 }
 
+// Decide which aircraft are rendered if the number of rendered aircraft is capped
+/// @details Score is the camera distance plus `aiPrio` weighted the same way as
+///          for TCAS slot assignment, aircraft on TCAS are preferred.
+///          The lower the score the more important.
+///          Already rendered aircraft get a bonus so that aircraft at the
+///          boundary don't flicker in and out.
+void Aircraft::AdmitForRendering ()
+{
+    // Not capped? Then all are admitted
+    // (the quality governor might reduce that number)
+    const size_t maxAc = GovMaxRendered(size_t(glob.maxRenderedAc));
+    if (maxAc == 0 || glob.mapAc.size() <= maxAc) {
+        for (mapAcTy::value_type& pair : glob.mapAc)
+            pair.second->bRenderAdmitted = true;
+        return;
+    }
+    
+    // Compute a score for all aircraft that would be drawn
+    // (reusing the buffer, which only grows with the number of aircraft)
+    std::vector<std::pair<float,Aircraft*> >& vecScore = gVecAdmitScore;
+    vecScore.clear();
+    vecScore.reserve(glob.mapAc.size());
+    for (mapAcTy::value_type& pair : glob.mapAc) {
+        Aircraft& ac = *pair.second;
+        if (!ac.IsValid() || !ac.IsVisible()) {
+            ac.bRenderAdmitted = true;          // (doesn't matter, not drawn anyway)
+            continue;
+        }
+        float score = ac.GetCameraDist() + float(ac.aiPrio * AI_PRIO_MULTIPLIER);
+        if (ac.IsCurrentlyShownAsTcasTarget())
+            score -= float(AI_PRIO_MULTIPLIER);
+        if (ac.bRenderAdmitted)
+            score *= RENDER_ADMIT_HYSTERESIS;
+        vecScore.emplace_back(score, &ac);
+    }
+    
+    // Admit the `maxAc` best ones
+    if (vecScore.size() > maxAc)
+        std::nth_element(vecScore.begin(), vecScore.begin() + long(maxAc), vecScore.end(),
+                         [](const std::pair<float,Aircraft*>& a, const std::pair<float,Aircraft*>& b)
+                         { return a.first < b.first; });
+    for (size_t i = 0; i < vecScore.size(); ++i)
+        vecScore[i].second->bRenderAdmitted = i < maxAc;
+    vecScore.clear();                           // don't keep pointers to aircraft
+}
+
 // This puts the instance into XP's sky and makes it move
 void Aircraft::DoMove ()
 {
+    // Not admitted under the cap on rendered aircraft? Then we don't keep instances
+    if (!bRenderAdmitted) {
+        if (!listInst.empty())
+            DestroyInstances();
+        return;
+    }
+    
     // Only for visible planes
     if (IsVisible()) {
+        // Distance-based level of detail: switch between matched and low-detail model
+        if (bLODWanted != bInstLOD)
+            LODSwap();
         // Already have instances? 
         if (!listInst.empty()) {
             // Move the instances (this is probably the single most important line of code ;-) )
-            for (XPLMInstanceRef hInst: listInst)
-                XPLMInstanceSetPosition(hInst, &drawInfo, v.data());
+            if (pInstDrIdx) {
+                // Instances know the model's dataRef subset only, so pass just those values
+                SmallVecTy<float,V_COUNT> vSub(pInstDrIdx->size(), 0.0f);
+                for (size_t i = 0; i < pInstDrIdx->size(); ++i)
+                    vSub[i] = v[(*pInstDrIdx)[i]];
+                for (XPLMInstanceRef hInst: listInst)
+                    XPLMInstanceSetPosition(hInst, &drawInfo, vSub.data());
+            } else {
+                for (XPLMInstanceRef hInst: listInst)
+                    XPLMInstanceSetPosition(hInst, &drawInfo, v.data());
+            }
         } else {
             // Try creating instances
             // In an attempt to work around a crash documented in TwinFan/LiveTraffic#191 https://github.com/TwinFan/LiveTraffic/issues/191
             // we create instance only in this flight loop callback but don't set their positions
-            CreateInstances();
+            // (After a scene restore, the number of instances created per frame is limited)
+            // While waiting for the model to load we do nothing, the model notifies us when ready
+            if (!bWaitMdlLoad && SceneInstCreateAllowed() && CreateInstances())
+                SceneInstCreated();
         }
     }
 }
@@ -459,23 +721,30 @@ void Aircraft::ClampToGround ()
     }
     
     // Where's the ground?
-    XPLMProbeInfo_t infoProbe = {
-        sizeof(XPLMProbeInfo_t),            // structSIze
-        0.0f, 0.0f, 0.0f,                   // location
-        0.0f, 0.0f, 0.0f,                   // normal vector
-        0.0f, 0.0f, 0.0f,                   // velocity vector
-        0                                   // is_wet
-    };
-    if (XPLMProbeTerrainXYZ(hProbe,
-                            drawInfo.x, drawInfo.y, drawInfo.z,
-                            &infoProbe) == xplm_ProbeHitTerrain)
-    {
-        // if currently the aircraft would be below ground,
-        // then lift it on the ground
-        infoProbe.locationY += GetVertOfs();
-        if (drawInfo.y < infoProbe.locationY)
-            drawInfo.y = infoProbe.locationY;
+    // (The quality governor might let us reuse the last probe result instead)
+    if (std::isnan(probeGroundY) || !GovSkipProbe(*this)) {
+        XPLMProbeInfo_t infoProbe = {
+            sizeof(XPLMProbeInfo_t),            // structSIze
+            0.0f, 0.0f, 0.0f,                   // location
+            0.0f, 0.0f, 0.0f,                   // normal vector
+            0.0f, 0.0f, 0.0f,                   // velocity vector
+            0                                   // is_wet
+        };
+        if (XPLMProbeTerrainXYZ(hProbe,
+                                drawInfo.x, drawInfo.y, drawInfo.z,
+                                &infoProbe) == xplm_ProbeHitTerrain)
+            probeGroundY = infoProbe.locationY;
+        else {
+            probeGroundY = NAN;
+            return;
+        }
     }
+    
+    // if currently the aircraft would be below ground,
+    // then lift it on the ground
+    const float groundY = probeGroundY + GetVertOfs();
+    if (drawInfo.y < groundY)
+        drawInfo.y = groundY;
 }
 
 // Internal: Update the plane's distance/bearing from the camera location
@@ -495,17 +764,25 @@ bool Aircraft::CreateInstances ()
     // If we have instances already we just return
     if (!listInst.empty()) return true;
 
-    // Let's see if we can get ALL object handles:
-    LOG_ASSERT(pCSLMdl);
-    std::list<XPLMObjectRef> listObj = pCSLMdl->GetAllObjRefs();
-    if (listObj.empty())                    // we couldn't...
+    // Is the model ready? If not we will be notified once it is
+    // (might be the low-detail model for distant aircraft)
+    CSLModel* pMdl = GetInstModel();
+    LOG_ASSERT(pMdl);
+    if (!pMdl->RequestLoad(modeS_id)) {
+        bWaitMdlLoad = true;
         return false;
+    }
+    CostTimer cost(pMdl);                   // attribute instance creation time to the model
     
-    // OK, we got a complete list of objects, so let's instanciate them:
-    for (XPLMObjectRef hObj: listObj) {
+    // Register only the dataRefs the model's objects actually use, if known
+    const bool bDrSubset = pMdl->HasDrSubset();
+    const char** drNames = bDrSubset ? pMdl->GetDrNames() : DR_NAMES.data();
+    
+    // OK, all objects are available, so let's instanciate them:
+    for (const CSLObj& obj: pMdl->listObj) {
         // Create a (new) instance of this CSL Model object,
-        // registering all the dataRef names we support
-        XPLMInstanceRef hInst = XPLMCreateInstance (hObj, DR_NAMES.data());
+        // registering the dataRef names
+        XPLMInstanceRef hInst = XPLMCreateInstance (obj.GetObjRef(), drNames);
         
         // Didn't work???
         if (!hInst) {
@@ -521,10 +798,32 @@ bool Aircraft::CreateInstances ()
     }
     
     // Success!
+    pInstDrIdx = bDrSubset ? &pMdl->GetDrIdx() : nullptr;
     LOG_MSG(logDEBUG, DEBUG_INSTANCE_CREATED, modeS_id);
     return true;
 }
 
+// Called by a CSL model, for which we wait, when its loading sequence has ended
+void Aircraft::ModelLoaded (CSLModel* pMdl)
+{
+    // The model we create instances from: We can now try creating instances
+    if (pMdl == GetInstModel())
+        bWaitMdlLoad = false;
+    // The better model of a progressive match: Switch to it by matching again,
+    // which now finds the best model loaded
+    else if (pMdl == pCSLMdlUpgrade) {
+        pCSLMdlUpgrade = nullptr;
+        const int q = upgradeQuality;
+        upgradeQuality = 0;
+        if (pMdl->IsReady() && IsValid()) {
+            if (q > 0)                  // found by UpgradeModel(): switch to exactly that model
+                UseModel(pMdl, q, nullptr);
+            else
+                ReMatchModel();
+        }
+    }
+}
+
 // Destroy all instances
 void Aircraft::DestroyInstances ()
 {
@@ -539,6 +838,7 @@ void Aircraft::DestroyInstances ()
         XPLMDestroyInstance(listInst.back());
         listInst.pop_back();
     }
+    pInstDrIdx = nullptr;
     bDestroyInst = false;
     LOG_MSG(logDEBUG, DEBUG_INSTANCE_DESTRYD, modeS_id);
 }
@@ -761,7 +1061,8 @@ void XPCAircraft::UpdatePosition(float, int)
         drawInfo.roll       = acPos.roll;
         drawInfo.heading    = acPos.heading;
         // Update the other values from acPos
-        label               = acPos.label;
+        if (label != acPos.label)       // avoid re-assigning in every frame
+            label           = acPos.label;
         vertOfsRatio        = acPos.offsetScale;
         bClampToGround      = acPos.clampToGround;
         aiPrio              = acPos.aiPrio;
@@ -861,6 +1162,18 @@ void AcInit ()
         // because the last string must be nullptr
         LOG_ASSERT(ahDataRefs.size() == DR_NAMES.size()-1);
     }
+    
+    // Create and schedule the flight loop callback, which executes queued commands
+    if (!gCmdFlightLoopID) {
+        XPLMCreateFlightLoop_t cfl = {
+            sizeof(XPLMCreateFlightLoop_t),                 // size
+            xplm_FlightLoop_Phase_BeforeFlightModel,        // phase
+            AcCmdFlightLoopCB,                              // callback function
+            nullptr                                         // refcon
+        };
+        gCmdFlightLoopID = XPLMCreateFlightLoop(&cfl);
+        XPLMScheduleFlightLoop(gCmdFlightLoopID, -1.0f, 0);
+    }
 }
 
 // Grace cleanup
@@ -873,11 +1186,22 @@ void AcCleanup ()
         glob.mapAc.clear();
     }
     
-    // Destroy flight loop
+    // Destroy flight loops
     if (gFlightLoopID) {
         XPLMDestroyFlightLoop(gFlightLoopID);
         gFlightLoopID = nullptr;
     }
+    if (gCmdFlightLoopID) {
+        XPLMDestroyFlightLoop(gCmdFlightLoopID);
+        gCmdFlightLoopID = nullptr;
+    }
+    
+    // Remove any commands not yet executed (their futures report a broken promise)
+    {
+        std::lock_guard<std::mutex> lock(gMutexCmds);
+        gListCmds.clear();
+        gbCmdQueued = false;
+    }
     
     // Unregister dataRefs
     for (XPLMDataRef dr: ahDataRefs)
@@ -899,12 +1223,146 @@ Aircraft* AcFindByID (XPMPPlaneID _id)
     }
 }
 
+//
+// MARK: Command Queue
+//
+
+/// Adds a function to the command queue and returns the future for its result
+template<class R>
+std::future<R> AcCmdEnqueue (std::function<R()> _f)
+{
+    // packaged_task isn't copyable, so we pass on a shared pointer to it
+    auto pTask = std::make_shared<std::packaged_task<R()> >(std::move(_f));
+    std::future<R> fut = pTask->get_future();
+    {
+        std::lock_guard<std::mutex> lock(gMutexCmds);
+        gListCmds.emplace_back([pTask](){ (*pTask)(); });
+        gbCmdQueued = true;
+    }
+    // In the main thread we can wake up the command flight loop right away,
+    // otherwise the aircraft flight loop does so in the next frame
+    if (gCmdFlightLoopID && glob.IsXPThread())
+        XPLMScheduleFlightLoop(gCmdFlightLoopID, -1.0f, 0);
+    return fut;
+}
+
+/// @brief Flight loop callback executing queued commands within a time budget
+/// @details Unschedules itself when idle, as long as the aircraft flight loop
+///          is running to wake it up again. Without aircraft it checks every now and then.
+static float AcCmdFlightLoopCB (float, float, int, void*)
+{
+    // Quick exit if there's nothing to do
+    if (!gbCmdQueued)
+        return glob.mapAc.empty() ? CMD_QUEUE_IDLE_PERIOD : 0.0f;
+    
+    const auto tEnd = std::chrono::steady_clock::now() + CMD_QUEUE_BUDGET;
+    size_t nDone = 0;
+    for (;;) {
+        // Take the next command from the queue (executed outside the lock)
+        std::function<void()> cmd;
+        {
+            std::lock_guard<std::mutex> lock(gMutexCmds);
+            if (gListCmds.empty()) {
+                gbCmdQueued = false;
+                break;
+            }
+            cmd = std::move(gListCmds.front());
+            gListCmds.pop_front();
+        }
+        // Execute it, exceptions are caught by the packaged_task
+        cmd();
+        ++nDone;
+        // Used up this frame's budget?
+        if (std::chrono::steady_clock::now() >= tEnd)
+            break;
+    }
+    
+    if (glob.logLvl <= logDEBUG) {
+        std::lock_guard<std::mutex> lock(gMutexCmds);
+        LOG_MSG(logDEBUG, DEBUG_CMD_QUEUE_DONE,
+                (unsigned long)nDone, (unsigned long)gListCmds.size());
+    }
+    // More to do in the next frame?
+    if (gbCmdQueued)
+        return -1.0f;
+    return glob.mapAc.empty() ? CMD_QUEUE_IDLE_PERIOD : 0.0f;
+}
+
+// Queue the creation of an aircraft
+std::future<XPMPPlaneID> AcQueueCreate (std::function<Aircraft*()> _fCreate)
+{
+    return AcCmdEnqueue<XPMPPlaneID>([_fCreate]()
+    {
+        Aircraft* pAc = _fCreate();
+        return pAc ? pAc->GetModeS_ID() : 0;
+    });
+}
+
+// Queue the destruction of an aircraft, taking over ownership
+std::future<bool> AcQueueDestroy (std::unique_ptr<Aircraft> _pAc)
+{
+    // std::function needs to be copyable, so we pass on a shared pointer to the owner
+    auto pOwner = std::make_shared<std::unique_ptr<Aircraft> >(std::move(_pAc));
+    return AcCmdEnqueue<bool>([pOwner]()
+    {
+        if (!*pOwner) return false;
+        pOwner->reset();
+        return true;
+    });
+}
+
+// Queue a model change
+std::future<int> AcQueueChangeModel (XPMPPlaneID _id,
+                                     const std::string& _icaoType,
+                                     const std::string& _icaoAirline,
+                                     const std::string& _livery)
+{
+    return AcCmdEnqueue<int>([_id,_icaoType,_icaoAirline,_livery]()
+    {
+        Aircraft* pAc = AcFindByID(_id);
+        return pAc ? pAc->ChangeModel(_icaoType, _icaoAirline, _livery) : -1;
+    });
+}
+
+// Queue a visibility change
+std::future<bool> AcQueueSetVisible (XPMPPlaneID _id, bool _bVisible)
+{
+    return AcCmdEnqueue<bool>([_id,_bVisible]()
+    {
+        Aircraft* pAc = AcFindByID(_id);
+        if (!pAc) return false;
+        pAc->SetVisible(_bVisible);
+        return true;
+    });
+}
+
 }   // namespace XPMP2
 
 //
 // MARK: Global functions outside XPMP2 namespace
 //
 
+// Reports the memory footprint of all aircraft
+size_t XPMPReportAircraftFootprint ()
+{
+    size_t total = 0, nHeap = 0, szV = 0;
+    for (const mapAcTy::value_type& pair: glob.mapAc) {
+        const Aircraft& ac = *pair.second;
+        const size_t sz = ac.GetMemFootprint();
+        const size_t szAcV = ac.v.capacity() * sizeof(float);
+        total += sz;
+        szV += szAcV;
+        if (sz > sizeof(Aircraft) + szAcV) ++nHeap;
+    }
+    const size_t n = glob.mapAc.size();
+    LOG_MSG(logINFO, INFO_FOOTPRINT,
+            (unsigned long)n, (unsigned long)total,
+            (unsigned long)(n ? total / n : 0),
+            (unsigned long)sizeof(Aircraft),
+            (unsigned long)nHeap, (unsigned long)szV);
+    return total;
+}
+
 // Add a new dataRef
 size_t XPMPAddModelDataRef (const std::string& dataRef)
 {
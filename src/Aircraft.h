@@ -56,6 +56,10 @@ public:
 ///         Plugin (the one using this library) is expected to own and destroy the object
 typedef std::map<XPMPPlaneID,Aircraft*> mapAcTy;
 
+/// @brief The list of dataRefs we support to be read by the CSL Model (for gear, flaps, lights etc.)
+/// @details The last element is always `nullptr`
+extern std::vector<const char*> DR_NAMES;
+
 //
 // MARK: Global Functions
 //
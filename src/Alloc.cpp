@@ -0,0 +1,167 @@
+/// @file       Alloc.cpp
+/// @brief      Opt-in audit of heap allocations in the flight loop and drawing callbacks
+/// @details    Replaces the global `operator new`/`operator delete` if built with `XPMP2_ALLOC_AUDIT`.
+///             Allocations are counted only while an XPMP2::AllocScope is active
+///             on the current thread, which are placed into the flight loop
+///             and into the drawing callbacks.\n
+///             Every 10 seconds, the number of allocations per frame is written to `Log.txt`.
+///             If each single frame of that period allocated then something
+///             allocates in steady state, which is reported as a warning.
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#include "XPMP2.h"
+
+#ifdef XPMP2_ALLOC_AUDIT
+
+#include <new>
+#include <cstdlib>
+
+#define DEBUG_ALLOC_REPORT      "Allocations in flight loop and drawing callbacks: %lu frames, min %lu, avg %.1f, max %lu per frame"
+#define WARN_ALLOC_STEADY       "Each of the last %lu frames allocated memory (min %lu, max %lu per frame) - something allocates in steady state!"
+
+//
+// MARK: Counting
+//
+
+/// Depth of nested AllocScope objects on this thread, counting if > 0
+static thread_local int gAllocScopeDepth = 0;
+/// Allocations counted on this thread since the last frame start
+static thread_local unsigned long gAllocCnt = 0;
+
+/// Count an allocation if in scope
+inline void AllocCount ()
+{
+    if (gAllocScopeDepth > 0)
+        ++gAllocCnt;
+}
+
+/// The actual allocation
+inline void* AllocMem (std::size_t sz) noexcept
+{
+    return std::malloc(sz ? sz : 1);
+}
+
+//
+// MARK: Replacement operators
+//       (Aligned versions are left to the standard library,
+//        they use their own allocation functions consistently.)
+//
+
+void* operator new (std::size_t sz)
+{
+    AllocCount();
+    if (void* p = AllocMem(sz))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[] (std::size_t sz)
+{
+    AllocCount();
+    if (void* p = AllocMem(sz))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new (std::size_t sz, const std::nothrow_t&) noexcept
+{
+    AllocCount();
+    return AllocMem(sz);
+}
+
+void* operator new[] (std::size_t sz, const std::nothrow_t&) noexcept
+{
+    AllocCount();
+    return AllocMem(sz);
+}
+
+void operator delete (void* p) noexcept                                 { std::free(p); }
+void operator delete[] (void* p) noexcept                               { std::free(p); }
+void operator delete (void* p, std::size_t) noexcept                    { std::free(p); }
+void operator delete[] (void* p, std::size_t) noexcept                  { std::free(p); }
+void operator delete (void* p, const std::nothrow_t&) noexcept          { std::free(p); }
+void operator delete[] (void* p, const std::nothrow_t&) noexcept        { std::free(p); }
+
+namespace XPMP2 {
+
+/// How often to report allocations per frame? [s]
+constexpr float ALLOC_REPORT_PERIOD = 10.0f;
+
+/// Statistics of a reporting period
+struct AllocStatTy {
+    unsigned long nFrames = 0;          ///< number of frames
+    unsigned long nMin = 0;             ///< minimum allocations in a single frame
+    unsigned long nMax = 0;             ///< maximum allocations in a single frame
+    unsigned long nTotal = 0;           ///< total allocations
+};
+
+/// Statistics of the current reporting period
+static AllocStatTy gAllocStat;
+
+/// Last time a report was written to the log
+static float gTsAllocReport = 0.0f;
+
+// Begin counting
+AllocScope::AllocScope ()
+{
+    ++gAllocScopeDepth;
+}
+
+// End counting
+AllocScope::~AllocScope ()
+{
+    --gAllocScopeDepth;
+}
+
+// Closes the previous frame's count, regularly reports
+void AllocFrameStart ()
+{
+    // Add the previous frame's count to the statistics
+    const unsigned long n = gAllocCnt;
+    gAllocCnt = 0;
+    if (gAllocStat.nFrames == 0 || n < gAllocStat.nMin)
+        gAllocStat.nMin = n;
+    if (n > gAllocStat.nMax)
+        gAllocStat.nMax = n;
+    gAllocStat.nTotal += n;
+    gAllocStat.nFrames++;
+
+    // Time for a report?
+    if (!CheckEverySoOften(gTsAllocReport, ALLOC_REPORT_PERIOD))
+        return;
+    LOG_MSG(logDEBUG, DEBUG_ALLOC_REPORT, gAllocStat.nFrames,
+            gAllocStat.nMin, double(gAllocStat.nTotal) / double(gAllocStat.nFrames),
+            gAllocStat.nMax);
+    // Transient allocations (model loading, instance creation) are OK,
+    // but if each single frame allocated then the steady state allocates
+    if (gAllocStat.nMin > 0)
+        LOG_MSG(logWARN, WARN_ALLOC_STEADY, gAllocStat.nFrames,
+                gAllocStat.nMin, gAllocStat.nMax);
+    gAllocStat = AllocStatTy();
+}
+
+// Allocations counted on this thread since the last frame start
+unsigned long AllocFrameCount ()
+{
+    return gAllocCnt;
+}
+
+}       // namespace XPMP2
+
+#endif
@@ -0,0 +1,71 @@
+/// @file       Alloc.h
+/// @brief      Opt-in audit of heap allocations in the flight loop and drawing callbacks
+/// @details    In steady state, ie. with all models loaded and all instances created,
+///             the per-frame path is not supposed to allocate memory.
+///             Allocator contention (esp. on Windows) otherwise costs frame time.\n
+///             If built with `XPMP2_ALLOC_AUDIT` defined (CMake option `XPMP2_ALLOC_AUDIT`, default off),
+///             global `operator new` is replaced by a counting version,
+///             counting only while an XPMP2::AllocScope is active on the current thread.
+///             Don't enable it if your plugin replaces `operator new` itself.
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#ifndef _Alloc_h_
+#define _Alloc_h_
+
+namespace XPMP2 {
+
+#ifdef XPMP2_ALLOC_AUDIT
+
+/// @brief Counts allocations on this thread while in scope
+/// @details Put at the beginning of the flight loop and each drawing callback
+class AllocScope {
+public:
+    AllocScope ();                      ///< begin counting
+    ~AllocScope ();                     ///< end counting
+    AllocScope (const AllocScope&) = delete;
+    AllocScope& operator = (const AllocScope&) = delete;
+};
+
+/// @brief Called at the beginning of the flight loop, before the AllocScope: closes the previous frame's count
+/// @details Regularly reports allocations per frame to the log,
+///          with a warning if each single frame allocated
+void AllocFrameStart ();
+
+/// Allocations counted on this thread since the last call to AllocFrameStart()
+unsigned long AllocFrameCount ();
+
+#else
+
+/// Does nothing without `XPMP2_ALLOC_AUDIT`
+class AllocScope {
+public:
+    AllocScope () {}
+};
+
+/// Does nothing without `XPMP2_ALLOC_AUDIT`
+inline void AllocFrameStart () {}
+
+/// Nothing is counted without `XPMP2_ALLOC_AUDIT`
+inline unsigned long AllocFrameCount () { return 0; }
+
+#endif
+
+}       // namespace XPMP2
+
+#endif
@@ -0,0 +1,558 @@
+/// @file       CSLCache.cpp
+/// @brief      CSL catalog shared between XPMP2 plugins via a memory-mapped cache file
+/// @details    Active only if config item `models/shared_catalog` is set.\n
+///             When running several XPMP2-based plugins, each would parse the
+///             same CSL folders. Instead, the first plugin writes what it has parsed
+///             into a catalog file in `Output/caches/XPMP2`, one file per CSL folder.
+///             Other plugins map that file read-only and take over the models
+///             without reading any `xsb_aircraft.txt` file.\n
+///             The catalog is valid as long as the modification times of all
+///             `xsb_aircraft.txt` files and of all searched folders are unchanged,
+///             and as long as the `.obj`-copy-relevant configuration is the same.
+///             While a plugin builds the catalog it holds an exclusive lock,
+///             so other plugins wait and then read the result.
+///             The file is written under a temporary name and then renamed,
+///             so that readers never see a half-written file.
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#include "XPMP2.h"
+
+#if IBM
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define INFO_CACHE_READ         "Read %lu models of %lu packages from shared catalog %s"
+#define INFO_CACHE_WRITTEN      "Wrote %lu models of %lu packages to shared catalog %s"
+#define DEBUG_CACHE_OUTDATED    "Shared catalog %s is outdated: %s"
+#define WARN_CACHE_DAMAGED      "Shared catalog %s is damaged, ignored"
+#define WARN_CACHE_WRITE        "Could not write shared catalog %s"
+#define WARN_CACHE_LOCK         "Could not lock shared catalog %s, CSL folder is read but not shared"
+
+namespace XPMP2 {
+
+/// Identifies a catalog file
+constexpr char CACHE_MAGIC[8] = {'X','P','M','P','2','C','A','T'};
+/// Version of the file format, to be increased with every change
+constexpr uint32_t CACHE_VERSION = 1;
+
+//
+// MARK: Helpers
+//
+
+/// Configuration, which influences parsing, as flags
+static uint32_t CacheCfgFlags ()
+{
+    return (glob.bObjReplDataRefs ? 1u : 0u) | (glob.bObjReplTextures ? 2u : 0u);
+}
+
+/// Folder holding the catalog files, created if necessary
+static std::string CacheDir (bool bCreate)
+{
+    const char sep = XPLMGetDirectorySeparator()[0];
+    char s[512];
+    XPLMGetSystemPath(s);
+    std::string dir (s);
+    for (const char* sub: {"Output", "caches", "XPMP2"}) {
+        dir += sub;
+        if (bCreate)
+            CreateDir(TOPOSIX(dir));
+        dir += sep;
+    }
+    return dir;
+}
+
+/// @brief Normalized CSL folder path: absolute, with native separators, without trailing separator
+/// @details Different spellings of the same folder, like the absolute paths used by XPMP2-CSLIndex
+///          and a relative path with trailing separator passed by a plugin, so share one catalog.
+static std::string CachePathNorm (const std::string& _path)
+{
+#if IBM
+    constexpr char SEP = '\\';
+    std::string p (_path);
+    std::replace(p.begin(), p.end(), '/', SEP);
+    const bool bAbs = (p.size() >= 2 && p[1] == ':') || (!p.empty() && p[0] == SEP);
+    const size_t minLen = p.size() >= 2 && p[1] == ':' ? 3 : 1;     // keep the root folder, like "C:\"
+#else
+    constexpr char SEP = '/';
+    std::string p (TOPOSIX(_path));
+    const bool bAbs = !p.empty() && p[0] == SEP;
+    const size_t minLen = 1;                                        // keep the root folder "/"
+#endif
+    if (!bAbs) {
+        char cwd[1024] = "";
+#if IBM
+        if (GetCurrentDirectoryA(sizeof(cwd), cwd) > 0)
+#else
+        if (getcwd(cwd, sizeof(cwd)))
+#endif
+        {
+            std::string dir (cwd);
+            if (!dir.empty() && dir.back() != SEP)
+                dir += SEP;
+            p = dir + p;
+        }
+    }
+    while (p.size() > minLen && p.back() == SEP)
+        p.pop_back();
+    return p;
+}
+
+/// File name of a CSL folder's catalog file, based on a hash of the normalized folder and the search depth
+static std::string CacheFileName (const std::string& _path, int _maxDepth,
+                                  const char* _ext, bool bCreateDir = false)
+{
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    for (const char c: CachePathNorm(_path)) {
+        h ^= uint8_t(c);
+        h *= 16777619u;
+    }
+    h ^= uint32_t(_maxDepth);
+    h *= 16777619u;
+    char name[32];
+    snprintf(name, sizeof(name), "csl_%08x.%s", h, _ext);
+    return CacheDir(bCreateDir) + name;
+}
+
+/// Path of a package's `xsb_aircraft.txt` file
+static std::string CacheAcTxt (const std::string& pkgPath)
+{
+    return TOPOSIX(pkgPath + XPLMGetDirectorySeparator()[0] + "xsb_aircraft.txt");
+}
+
+/// Read-only memory mapping of a whole file
+class CacheMapTy
+{
+protected:
+    const char* pData = nullptr;        ///< mapped file content
+    size_t      len = 0;                ///< file length
+#if IBM
+    HANDLE      hFile = INVALID_HANDLE_VALUE;   ///< the opened file
+    HANDLE      hMap  = NULL;                   ///< the file mapping
+#endif
+public:
+    /// Opens and maps the file, check data() for success
+    CacheMapTy (const std::string& fileName);
+    /// Unmaps the file
+    ~CacheMapTy ();
+    /// File content, `nullptr` if file could not be mapped
+    const char* data () const   { return pData; }
+    /// File length
+    size_t size () const        { return len; }
+};
+
+// Opens and maps the file
+CacheMapTy::CacheMapTy (const std::string& fileName)
+{
+#if IBM
+    hFile = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                        NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return;
+    LARGE_INTEGER sz;
+    if (!GetFileSizeEx(hFile, &sz) || sz.QuadPart <= 0)
+        return;
+    hMap = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!hMap)
+        return;
+    pData = static_cast<const char*>(MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, 0));
+    if (pData)
+        len = size_t(sz.QuadPart);
+#else
+    const int fd = open(TOPOSIX(fileName).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            pData = static_cast<const char*>(p);
+            len = size_t(st.st_size);
+        }
+    }
+    close(fd);                          // the mapping stays valid without the descriptor
+#endif
+}
+
+// Unmaps the file
+CacheMapTy::~CacheMapTy ()
+{
+#if IBM
+    if (pData) UnmapViewOfFile(pData);
+    if (hMap) CloseHandle(hMap);
+    if (hFile != INVALID_HANDLE_VALUE) CloseHandle(hFile);
+#else
+    if (pData) munmap(const_cast<char*>(pData), len);
+#endif
+}
+
+/// Reads values from the mapped catalog file, bounds-checked
+class CacheReaderTy
+{
+protected:
+    const char* p;                      ///< current read position
+    const char* end;                    ///< end of data
+public:
+    bool bOk = true;                    ///< turns `false` when reading beyond the end
+public:
+    /// Constructor takes the data to read from
+    CacheReaderTy (const char* _p, size_t _len) : p(_p), end(_p + _len) {}
+    /// Number of bytes not yet read
+    size_t Remaining () const           { return size_t(end - p); }
+    /// Read a value of fixed size
+    template <class T> T Get ()
+    {
+        T v = T();
+        if (Remaining() < sizeof(T)) { bOk = false; return v; }
+        memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+        return v;
+    }
+    /// Read a count, which cannot sensibly exceed the remaining bytes
+    uint32_t GetCnt ()
+    {
+        const uint32_t n = Get<uint32_t>();
+        if (n > Remaining()) { bOk = false; return 0; }
+        return n;
+    }
+    /// Read a string, stored as length plus characters
+    std::string GetStr ()
+    {
+        const uint32_t n = GetCnt();
+        if (!bOk) return std::string();
+        std::string s (p, n);
+        p += n;
+        return s;
+    }
+};
+
+/// Collects the content of a catalog file
+class CacheWriterTy
+{
+public:
+    std::string buf;                    ///< file content
+public:
+    /// Add a value of fixed size
+    template <class T> void Put (T v)   { buf.append(reinterpret_cast<const char*>(&v), sizeof(T)); }
+    /// Add a string as length plus characters
+    void PutStr (const std::string& s)  { Put(uint32_t(s.size())); buf.append(s); }
+};
+
+//
+// MARK: Lock
+//
+
+// Acquires the lock, blocks until available
+CSLCacheLock::CSLCacheLock (const std::string& _path, int _maxDepth)
+{
+    const std::string lockName = CacheFileName(_path, _maxDepth, "lock", true);
+#if IBM
+    HANDLE h = CreateFileA(lockName.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                           NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h != INVALID_HANDLE_VALUE) {
+        OVERLAPPED ov = {};
+        if (LockFileEx(h, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &ov))
+            hFile = h;
+        else
+            CloseHandle(h);
+    }
+#else
+    fd = open(TOPOSIX(lockName).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0664);
+    if (fd >= 0 && flock(fd, LOCK_EX) != 0) {
+        close(fd);
+        fd = -1;
+    }
+#endif
+    if (!IsLocked())
+        LOG_MSG(logWARN, WARN_CACHE_LOCK, StripXPSysDir(lockName).c_str());
+}
+
+// Releases the lock
+CSLCacheLock::~CSLCacheLock ()
+{
+#if IBM
+    if (hFile) {
+        OVERLAPPED ov = {};
+        UnlockFileEx(hFile, 0, 1, 0, &ov);
+        CloseHandle(hFile);
+    }
+#else
+    if (fd >= 0) {
+        flock(fd, LOCK_UN);
+        close(fd);
+    }
+#endif
+}
+
+// Have we got the lock?
+bool CSLCacheLock::IsLocked () const
+{
+#if IBM
+    return hFile != nullptr;
+#else
+    return fd >= 0;
+#endif
+}
+
+//
+// MARK: Global Functions
+//
+
+// Read the models of a CSL folder from the shared catalog, if it is up to date
+bool CSLCacheRead (const std::string& _path, int _maxDepth,
+                   std::vector<std::string>& paths)
+{
+    ProfilePhase prof("CSLCacheRead", _path);
+    const std::string fileName = CacheFileName(_path, _maxDepth, "cat");
+    CacheMapTy map (fileName);
+    if (!map.data())                    // no catalog yet
+        return false;
+    CacheReaderTy rd (map.data(), map.size());
+    const std::string shortName = StripXPSysDir(fileName);
+    
+    // Same format, same configuration, same folder?
+    if (map.size() < sizeof(CACHE_MAGIC) ||
+        memcmp(map.data(), CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0) {
+        LOG_MSG(logWARN, WARN_CACHE_DAMAGED, shortName.c_str());
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(CACHE_MAGIC); ++i)
+        rd.Get<char>();
+    if (rd.Get<uint32_t>() != CACHE_VERSION) {
+        LOG_MSG(logDEBUG, DEBUG_CACHE_OUTDATED, shortName.c_str(), "other version");
+        return false;
+    }
+    if (rd.Get<uint32_t>() != CacheCfgFlags() ||
+        rd.Get<int32_t>()  != int32_t(_maxDepth) ||
+        rd.GetStr()        != CachePathNorm(_path)) {
+        LOG_MSG(logDEBUG, DEBUG_CACHE_OUTDATED, shortName.c_str(), "other configuration");
+        return false;
+    }
+    
+    // Has any searched folder changed? Then packages might have been added or removed
+    for (uint32_t n = rd.GetCnt(); n > 0 && rd.bOk; --n) {
+        const std::string dir = rd.GetStr();
+        if (GetFileModTime(TOPOSIX(dir)) != time_t(rd.Get<int64_t>())) {
+            LOG_MSG(logDEBUG, DEBUG_CACHE_OUTDATED, shortName.c_str(), StripXPSysDir(dir).c_str());
+            return false;
+        }
+    }
+    // Has any package changed?
+    std::vector<std::string> vecPkg;
+    for (uint32_t n = rd.GetCnt(); n > 0 && rd.bOk; --n) {
+        vecPkg.push_back(rd.GetStr());
+        if (GetFileModTime(CacheAcTxt(vecPkg.back())) != time_t(rd.Get<int64_t>())) {
+            LOG_MSG(logDEBUG, DEBUG_CACHE_OUTDATED, shortName.c_str(), StripXPSysDir(vecPkg.back()).c_str());
+            return false;
+        }
+    }
+    
+    // Intern all texts once, models refer to them by index
+    std::vector<CSLStrTy> vecStr;
+    for (uint32_t n = rd.GetCnt(); n > 0 && rd.bOk; --n)
+        vecStr.push_back(glob.catCSLModels.Intern(rd.GetStr()));
+    auto Str = [&rd,&vecStr](uint32_t i) -> CSLStrTy
+    {
+        if (i < vecStr.size()) return vecStr[i];
+        rd.bOk = false;
+        return CSLStrTy();
+    };
+    
+    // Package names
+    std::vector<std::pair<std::string,std::string>> vecPkgName;
+    for (uint32_t n = rd.GetCnt(); n > 0 && rd.bOk; --n) {
+        std::string name = rd.GetStr();
+        const uint32_t i = rd.Get<uint32_t>();
+        if (i >= vecPkg.size()) { rd.bOk = false; break; }
+        vecPkgName.emplace_back(std::move(name), vecPkg[i] + XPLMGetDirectorySeparator()[0]);
+    }
+    
+    // Models
+    std::vector<CSLModel> vecMdl;
+    for (uint32_t n = rd.GetCnt(); n > 0 && rd.bOk; --n) {
+        CSLModel csl;
+        csl.cslId                   = Str(rd.Get<uint32_t>());
+        csl.modelName               = Str(rd.Get<uint32_t>());
+        const CSLStrTy icaoType     = Str(rd.Get<uint32_t>());
+        csl.xsbAircraftPath         = Str(rd.Get<uint32_t>());
+        csl.xsbAircraftLn           = rd.Get<int32_t>();
+        csl.vertOfs                 = rd.Get<float>();
+        csl.bVertOfsReadFromFile    = rd.Get<uint8_t>() != 0;
+        CSLModel::MatchCritVecTy vecCrit;
+        for (uint32_t m = rd.GetCnt(); m > 0 && rd.bOk; --m) {
+            CSLModel::MatchCritTy mc;
+            mc.icaoAirline  = Str(rd.Get<uint32_t>());
+            mc.livery       = Str(rd.Get<uint32_t>());
+            vecCrit.push_back(mc);
+        }
+        for (uint32_t m = rd.GetCnt(); m > 0 && rd.bOk; --m) {
+            CSLObj obj (csl.cslId, Str(rd.Get<uint32_t>()));
+            obj.pathOrig    = Str(rd.Get<uint32_t>());
+            obj.texture     = Str(rd.Get<uint32_t>());
+            obj.text_lit    = Str(rd.Get<uint32_t>());
+            // A copy made meanwhile doesn't need to be made again
+            if (obj.NeedsObjCopy() && ExistsFile(TOPOSIX(obj.path)))
+                obj.pathOrig = CSLStrTy();
+            csl.listObj.push_back(std::move(obj));
+        }
+        if (!rd.bOk || vecCrit.empty())
+            break;
+        // sets type and type-derived values, then take over the criteria as they were
+        csl.AddMatchCriteria(icaoType, vecCrit.front(), csl.xsbAircraftLn);
+        csl.vecMatchCrit = std::move(vecCrit);
+        vecMdl.push_back(std::move(csl));
+    }
+    if (!rd.bOk || rd.Remaining() > 0) {
+        LOG_MSG(logWARN, WARN_CACHE_DAMAGED, shortName.c_str());
+        return false;
+    }
+    
+    // All good, take it over
+    for (auto& pn: vecPkgName)
+        glob.mapCSLPkgs.insert(std::move(pn));
+    for (CSLModel& csl: vecMdl)
+        CSLModelsAdd(csl);
+    paths = std::move(vecPkg);
+    LOG_MSG(logINFO, INFO_CACHE_READ, (unsigned long)vecMdl.size(),
+            (unsigned long)paths.size(), shortName.c_str());
+    return true;
+}
+
+// Write the models just read from a CSL folder into the shared catalog
+void CSLCacheWrite (const std::string& _path, int _maxDepth,
+                    const std::vector<std::string>& paths,
+                    const std::vector<std::string>& dirs)
+{
+    ProfilePhase prof("CSLCacheWrite", _path);
+    CacheWriterTy wr;
+    
+    // Header
+    wr.buf.append(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    wr.Put(CACHE_VERSION);
+    wr.Put(CacheCfgFlags());
+    wr.Put(int32_t(_maxDepth));
+    wr.PutStr(CachePathNorm(_path));
+    
+    // Searched folders and packages with their modification times
+    wr.Put(uint32_t(dirs.size()));
+    for (const std::string& dir: dirs) {
+        wr.PutStr(dir);
+        wr.Put(int64_t(GetFileModTime(TOPOSIX(dir))));
+    }
+    wr.Put(uint32_t(paths.size()));
+    std::unordered_map<const std::string*,uint32_t> mapPkgIdx;     // interned package path -> index
+    std::map<std::string,uint32_t> mapPkgNameIdx;                   // package path as in glob.mapCSLPkgs -> index
+    for (uint32_t i = 0; i < paths.size(); ++i) {
+        wr.PutStr(paths[i]);
+        wr.Put(int64_t(GetFileModTime(CacheAcTxt(paths[i]))));
+        const std::string* pPath = glob.catCSLModels.FindStr(paths[i]);
+        if (pPath)
+            mapPkgIdx.emplace(pPath, i);
+        mapPkgNameIdx.emplace(paths[i] + XPLMGetDirectorySeparator()[0], i);
+    }
+    
+    // Models of these packages, collecting the texts they use on the way
+    CacheWriterTy wrMdl;
+    std::unordered_map<const std::string*,uint32_t> mapStr;
+    std::vector<const std::string*> vecStr;
+    auto Idx = [&mapStr,&vecStr](const CSLStrTy& s) -> uint32_t
+    {
+        auto r = mapStr.emplace(&s.str(), uint32_t(vecStr.size()));
+        if (r.second)
+            vecStr.push_back(&s.str());
+        return r.first->second;
+    };
+    uint32_t nMdl = 0;
+    for (const CSLModel* pMdl: glob.catCSLModels) {
+        if (!mapPkgIdx.count(&pMdl->xsbAircraftPath.str()) || pMdl->vecMatchCrit.empty())
+            continue;
+        ++nMdl;
+        wrMdl.Put(Idx(pMdl->cslId));
+        wrMdl.Put(Idx(pMdl->modelName));
+        wrMdl.Put(Idx(glob.catCSLModels.Intern(pMdl->GetIcaoType())));
+        wrMdl.Put(Idx(pMdl->xsbAircraftPath));
+        wrMdl.Put(int32_t(pMdl->xsbAircraftLn));
+        wrMdl.Put(pMdl->vertOfs);
+        wrMdl.Put(uint8_t(pMdl->bVertOfsReadFromFile));
+        wrMdl.Put(uint32_t(pMdl->vecMatchCrit.size()));
+        for (const CSLModel::MatchCritTy& mc: pMdl->vecMatchCrit) {
+            wrMdl.Put(Idx(mc.icaoAirline));
+            wrMdl.Put(Idx(mc.livery));
+        }
+        wrMdl.Put(uint32_t(pMdl->listObj.size()));
+        for (const CSLObj& obj: pMdl->listObj) {
+            wrMdl.Put(Idx(obj.path));
+            wrMdl.Put(Idx(obj.pathOrig));
+            wrMdl.Put(Idx(obj.texture));
+            wrMdl.Put(Idx(obj.text_lit));
+        }
+    }
+    
+    // Texts
+    wr.Put(uint32_t(vecStr.size()));
+    for (const std::string* pStr: vecStr)
+        wr.PutStr(*pStr);
+    
+    // Package names
+    CacheWriterTy wrPkgName;
+    uint32_t nPkgName = 0;
+    for (const auto& pn: glob.mapCSLPkgs) {
+        auto iter = mapPkgNameIdx.find(pn.second);
+        if (iter == mapPkgNameIdx.end())
+            continue;
+        ++nPkgName;
+        wrPkgName.PutStr(pn.first);
+        wrPkgName.Put(iter->second);
+    }
+    wr.Put(nPkgName);
+    wr.buf += wrPkgName.buf;
+    
+    // Models
+    wr.Put(nMdl);
+    wr.buf += wrMdl.buf;
+    
+    // Write under a temporary name, then rename, so that readers never see a half-written file
+    const std::string fileName = CacheFileName(_path, _maxDepth, "cat", true);
+    const std::string tmpName  = CacheFileName(_path, _maxDepth, "tmp");
+    std::ofstream f (TOPOSIX(tmpName), std::ios::binary | std::ios::trunc);
+    f.write(wr.buf.data(), std::streamsize(wr.buf.size()));
+    f.close();
+    bool bOk = !f.fail();
+#if IBM
+    bOk = bOk && MoveFileExA(tmpName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+    bOk = bOk && std::rename(TOPOSIX(tmpName).c_str(), TOPOSIX(fileName).c_str()) == 0;
+#endif
+    if (bOk) {
+        LOG_MSG(logINFO, INFO_CACHE_WRITTEN, (unsigned long)nMdl,
+                (unsigned long)paths.size(), StripXPSysDir(fileName).c_str());
+    } else {
+        LOG_MSG(logWARN, WARN_CACHE_WRITE, StripXPSysDir(fileName).c_str());
+        std::remove(TOPOSIX(tmpName).c_str());
+    }
+}
+
+}       // namespace XPMP2
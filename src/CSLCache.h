@@ -0,0 +1,65 @@
+/// @file       CSLCache.h
+/// @brief      CSL catalog shared between XPMP2 plugins via a memory-mapped cache file
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#ifndef _CSLCache_h_
+#define _CSLCache_h_
+
+namespace XPMP2 {
+
+/// @brief Exclusive lock on the shared catalog of one CSL folder, blocks until acquired
+/// @details Held while parsing the CSL folder and writing the catalog,
+///          so that other plugins wait and then read our result instead of parsing, too.
+class CSLCacheLock
+{
+protected:
+#if IBM
+    void*   hFile = nullptr;    ///< handle of the lock file
+#else
+    int     fd = -1;            ///< file descriptor of the lock file
+#endif
+public:
+    /// Acquires the lock, blocks until available
+    CSLCacheLock (const std::string& _path, int _maxDepth);
+    /// Releases the lock
+    ~CSLCacheLock ();
+    /// Have we got the lock? (Not if the lock file could not be created)
+    bool IsLocked () const;
+};
+
+/// @brief Read the models of a CSL folder from the shared catalog, if it is up to date
+/// @param _path The folder as passed to CSLModelsLoad()
+/// @param _maxDepth Search depth as passed to CSLModelsLoad()
+/// @param[out] paths Package folders found in `_path`
+/// @return `true` if the catalog was valid and all its models have been added
+bool CSLCacheRead (const std::string& _path, int _maxDepth,
+                   std::vector<std::string>& paths);
+
+/// @brief Write the models just read from a CSL folder into the shared catalog
+/// @param _path The folder as passed to CSLModelsLoad()
+/// @param _maxDepth Search depth as passed to CSLModelsLoad()
+/// @param paths Package folders found in `_path`
+/// @param dirs All other folders searched, their modification time tells if packages were added or removed
+void CSLCacheWrite (const std::string& _path, int _maxDepth,
+                    const std::vector<std::string>& paths,
+                    const std::vector<std::string>& dirs);
+
+}       // namespace XPMP2
+
+#endif
@@ -90,9 +90,9 @@ bool CSLObj::CopyAndReplace ()
     gErrTxt.clear();
     try {
         // open input and output files
-        std::ifstream fIn (pathOrig);
+        std::ifstream fIn (pathOrig.str());
         if (!fIn) { gErrTxt = "Couldn't open input/original file"; return false; }
-        std::ofstream fOut (path, std::ios_base::out | std::ios_base::trunc);
+        std::ofstream fOut (path.str(), std::ios_base::out | std::ios_base::trunc);
         if (!fOut) { gErrTxt = "Couldn't open output file for (over)writing"; return false; }
         
         // Process each line
@@ -120,13 +120,13 @@ bool CSLObj::CopyAndReplace ()
                     // Process TEXTURE, possibly replace the valie of one is given
                     if (tok[0] == "TEXTURE") {
                         if (!texture.empty()) {
-                            fOut << "TEXTURE " << texture << '\n';
+                            fOut << "TEXTURE " << texture.str() << '\n';
                             bOutWritten = true;
                         }
                         doneTexture = true;
                     } else if (tok[0] == "TEXTURE_LIT") {
                         if (!text_lit.empty()) {
-                            fOut << "TEXTURE_LIT " << text_lit << '\n';
+                            fOut << "TEXTURE_LIT " << text_lit.str() << '\n';
                             bOutWritten = true;
                         }
                         doneTextureLit = true;
@@ -193,12 +193,13 @@ void CSLObj::SetCopyResult (bool bResult)
 {
     if (bResult) {                      // success
         LOG_MSG(logINFO, INFO_CPY_SUCCEED, StripXPSysDir(path).c_str());
-        pathOrig.clear();               // need no copy any longer
+        pathOrig = CSLStrTy();          // need no copy any longer
     } else {
         // Copying failed!
         LOG_MSG(logERR, ERR_CPY_FAILED, StripXPSysDir(path).c_str(), StripXPSysDir(pathOrig).c_str());
         LOG_MSG(logERR, "%s", gErrTxt.c_str());
-        path = std::move(pathOrig);     // fall back to original
+        path = pathOrig;                // fall back to original
+        pathOrig = CSLStrTy();
         xpObjState = OLS_UNAVAIL;
     }
 }
@@ -207,14 +208,13 @@ void CSLObj::SetCopyResult (bool bResult)
 void CSLObj::SetOtherObjCopyResult (bool bResult)
 {
     // Look for the CSLObj using the stored CSLId and path
-    mapCSLModelTy::iterator cslIter;
     CSLModel* pCsl = CSLModelByName(gThreadCSLId);
     if (pCsl) {
         // find the object by path
         listCSLObjTy::iterator iter = std::find_if(pCsl->listObj.begin(),
                                                    pCsl->listObj.end(),
                                                    [](const CSLObj& o)
-                                                   { return o.path == gThreadPath; });
+                                                   { return o.path.str() == gThreadPath; });
         if (iter != pCsl->listObj.end())
             // Did find the CSL object!
             iter->SetCopyResult(bResult);
@@ -230,6 +230,17 @@ void CSLObj::SetOtherObjCopyResult (bool bResult)
     }
 }
 
+// If the copy thread is currently working for this object, wait for it and take over the result
+void CSLObj::WaitForCopy ()
+{
+    if (GetObjState() != OLS_COPYING || !gFutCpy.valid() ||
+        cslId.str() != gThreadCSLId || path.str() != gThreadPath)
+        return;
+    SetCopyResult(gFutCpy.get());       // waits for the thread, then gFutCpy becomes invalid
+    gThreadCSLId.clear();
+    gThreadPath.clear();
+}
+
 // Trigger a separate thread to copy the .obj file if needed
 bool CSLObj::TriggerCopyAndReplace ()
 {
@@ -256,7 +267,7 @@ bool CSLObj::TriggerCopyAndReplace ()
             // This is very possible for .obj files which are shared across models of different livery (like fans, engines, glass elements...)
             if (ExistsFile(path)) {
                 // It does exist, so no new copy is needed, just load it
-                pathOrig.clear();
+                pathOrig = CSLStrTy();
                 return true;
             }
             
@@ -264,8 +275,8 @@ bool CSLObj::TriggerCopyAndReplace ()
             if (bFutValid) return false;
 
             // Start a new thread to copy my .obj file
-            gThreadCSLId = cslId;
-            gThreadPath  = path;
+            gThreadCSLId = cslId.str();
+            gThreadPath  = path.str();
             LOG_MSG(logDEBUG, DEBUG_CPY_STARTING,
                     StripXPSysDir(path).c_str(),
                     StripXPSysDir(pathOrig).c_str(),
@@ -281,7 +292,8 @@ bool CSLObj::TriggerCopyAndReplace ()
             LOG_MSG(logERR, ERR_CPY_THRDNOTRUN,
                     path.c_str());
             // emergency procedure: revert back to original and load that
-            path = std::move(pathOrig);     // fall back to original
+            path = pathOrig;                // fall back to original
+            pathOrig = CSLStrTy();
             xpObjState = OLS_UNAVAIL;
             return true;
             
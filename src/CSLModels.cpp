@@ -28,16 +28,18 @@ namespace XPMP2 {
 #define DEBUG_OBJ_LOADING       "Async load starting  for %s from %s"
 #define DEBUG_OBJ_LOADED        "Async load succeeded for %s from %s"
 #define DEBUG_OBJ_UNLOADED      "Object %s / %s unloaded"
-#define ERR_OBJ_OBJ_NOT_FOUND   "Async load for %s: CSLObj in CSLModel object not found!"
+#define DEBUG_OBJ_DISCARDED     "Async load for %s: Object no longer awaited, released"
 #define ERR_OBJ_NOT_FOUND       "Async load for %s: CSLModel object not found!"
 #define ERR_OBJ_NOT_LOADED      "Async load FAILED for %s from %s"
+#define DEBUG_MDL_RECLAIMED     "Storage of %lu retired models reclaimed"
+#define DEBUG_OBJ_DR_SUBSET     "%s uses %lu of %lu dataRefs"
 
 /// The file holding package information
 #define XSB_AIRCRAFT_TXT        "xsb_aircraft.txt"
 #define DEBUG_XSBACTXT_READ     "Processing %s"
 #define INFO_XSBACTXT_DONE      "Read %3d aircraft %s from %s"
 #define WARN_XSBACTXT_IGNORED   "Ignored %d aircraft %s due to outdated format (OBJECT or AIRCRAFT) from %s"
-#define INFO_TOTAL_NUM_MODELS   "Total number of known models now is %lu"
+#define INFO_TOTAL_NUM_MODELS   "Total number of known models now is %lu (%lu distinct texts)"
 #define WARN_NO_XSBACTXT_FOUND  "No xsb_aircraft.txt found"
 #define WARN_DUP_PKG_NAME       "Package name (EXPORT_NAME) '%s' in folder '%s' is already in use by '%s'"
 #define WARN_DUP_MODEL          "Duplicate model '%s', additional definitions ignored, originally defined in line %d of %s"
@@ -51,11 +53,13 @@ namespace XPMP2 {
 #define ERR_COULD_NOT_OPEN      "Could not open '%s' for reading!"
 #define WARN_IGNORED_COMMANDS   "Following commands ignored: "
 #define WARN_OBJ8_ONLY_VERTOFS  "Version is '%s', unsupported for reading vertical offset, file %s"
+#define INFO_PKG_RELOADED       "Reloaded %s: %d added, %d changed, %d removed, %d unchanged models"
 
 #define ERR_MATCH_NO_MODELS     "MATCH ABORTED - There is not any single CSL model available!"
 #define DEBUG_MATCH_INPUT       "MATCH INPUT: Type=%s (WTC=%s,Class=%s,Related=%d), Airline=%s, Livery=%s"
 #define DEBUG_MATCH_FOUND       "MATCH FOUND: Type=%s (WTC=%s,Class=%s,Related=%d), Airline=%s, Livery=%s / Quality = %d -> %s"
 #define DEBUG_MATCH_NOTFOUND    "MATCH ERROR: Using a RANDOM model: %s %s %s - model %s"
+#define DEBUG_MATCH_UPGRADE     "MATCH PROGRESSIVE: Best match %s not yet loaded, using a loaded model meanwhile"
 
 /// The ids of our garbage collection flight loop callback
 XPLMFlightLoopID gGarbageCollectionID = nullptr;
@@ -67,21 +71,268 @@ constexpr float GARBAGE_COLLECTION_TIMEOUT = 180.0f;
 /// a map of a text and a counter
 typedef std::map<std::string, int> mapStrIntTy;
 
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wexit-time-destructors"
+#pragma clang diagnostic ignored "-Wglobal-constructors"
+/// Models currently going through their loading sequence, advanced once per frame
+static std::vector<CSLModel*> gVecMdlLoading;
+#pragma clang diagnostic pop
+
+/// While reloading a package, CSLModelsAdd() collects the models here instead of adding them to the catalog
+static std::vector<CSLModel>* gpVecMdlCollect = nullptr;
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wexit-time-destructors"
+#pragma clang diagnostic ignored "-Wglobal-constructors"
+
+/// The empty string, which all empty string handles refer to
+const std::string gStrEmpty;
+
+#pragma clang diagnostic pop
+
 //
 // MARK: CSL Model Info implementation
 //       A small public structure to pass back CSL model information to the calling plugin
 //
 
 CSLModelInfo_t::CSLModelInfo_t(const CSLModel& csl) :
-    cslId(csl.cslId), modelName(csl.modelName),
-    xsbAircraftPath(csl.xsbAircraftPath), xsbAircraftLn(csl.xsbAircraftLn),
+    cslId(csl.cslId.str()), modelName(csl.modelName.str()),
+    xsbAircraftPath(csl.xsbAircraftPath.str()), xsbAircraftLn(csl.xsbAircraftLn),
     icaoType(csl.GetIcaoType()),
     doc8643Classification(csl.GetDoc8643().classification),
     doc8643WTC(csl.GetDoc8643().wtc)
 {
     // copy all match criteria
     for (const CSLModel::MatchCritTy& crit : csl.vecMatchCrit)
-        vecMatchCrit.emplace_back(CSLModelInfo_t::MatchCrit_t{crit.icaoAirline, crit.livery});
+        vecMatchCrit.emplace_back(CSLModelInfo_t::MatchCrit_t{crit.icaoAirline.str(), crit.livery.str()});
+}
+
+//
+// MARK: CSL Catalog implementation
+//
+
+/// Order of the catalog's index: related group, aircraft type, model id
+static bool CSLModelKeyLess (const CSLModel* a, const CSLModel* b)
+{
+    if (a->GetRelatedGrp() != b->GetRelatedGrp())
+        return a->GetRelatedGrp() < b->GetRelatedGrp();
+    if (a->GetIcaoType() != b->GetIcaoType())
+        return a->GetIcaoType() < b->GetIcaoType();
+    return a->GetId() < b->GetId();
+}
+
+/// Compares models by related group only, to search ranges in the catalog's index
+struct CSLModelRelatedLess {
+    bool operator() (const CSLModel* a, int r) const { return a->GetRelatedGrp() < r; }
+    bool operator() (int r, const CSLModel* b) const { return r < b->GetRelatedGrp(); }
+};
+
+// Default constructor refers to the empty string
+CSLStrTy::CSLStrTy () : p(&gStrEmpty)
+{}
+
+// Intern a string, ie. return the pool's handle, adding the text if it is new
+CSLStrTy CSLCatalogTy::Intern (const std::string& s)
+{
+    if (s.empty())
+        return CSLStrTy();
+    // Elements of an unordered_set never move, so the address is a stable handle
+    return CSLStrTy(&*setStr.insert(s).first);
+}
+
+// Find an already interned string
+const std::string* CSLCatalogTy::FindStr (const std::string& s) const
+{
+    if (s.empty())
+        return &gStrEmpty;
+    std::unordered_set<std::string>::const_iterator iter = setStr.find(s);
+    return iter == setStr.cend() ? nullptr : &*iter;
+}
+
+// Adds a model, taking over its content
+CSLModel* CSLCatalogTy::Add (CSLModel&& mdl)
+{
+    // Is the key already in use?
+    const std::pair<CSLStrTy,CSLStrTy> key (mdl.icaoType, mdl.cslId);
+    auto iter = mapKey.find(key);
+    if (iter != mapKey.end())
+        return iter->second;
+    
+    // Store the model, reusing the storage of a reclaimed model if possible,
+    // index it, and remember its key
+    CSLModel* pMdl = nullptr;
+    if (!vecFree.empty()) {
+        pMdl = vecFree.back();
+        vecFree.pop_back();
+        *pMdl = std::move(mdl);
+    } else {
+        dqMdl.emplace_back(std::move(mdl));
+        pMdl = &dqMdl.back();
+    }
+    if (bSorted && !vecIdx.empty() && CSLModelKeyLess(pMdl, vecIdx.back()))
+        bSorted = false;
+    vecIdx.push_back(pMdl);
+    mapKey.emplace(key, pMdl);
+    vecAdded.push_back(pMdl);
+    bIdxDirty = true;
+    return nullptr;
+}
+
+// Removes a model from the index, the object stays in storage
+void CSLCatalogTy::Remove (const CSLModel* pMdl)
+{
+    vecCSLModelPTy::iterator iter = std::find(vecIdx.begin(), vecIdx.end(), pMdl);
+    if (iter != vecIdx.end()) {
+        vecIdx.erase(iter);
+        mapKey.erase(std::make_pair(pMdl->icaoType, pMdl->cslId));
+        bIdxDirty = true;
+    }
+}
+
+// Remember a retired model, so that its storage can be reclaimed later
+void CSLCatalogTy::AddRetired (CSLModel* pMdl)
+{
+    if (std::find(vecRetired.begin(), vecRetired.end(), pMdl) == vecRetired.end())
+        vecRetired.push_back(pMdl);
+}
+
+// Makes the storage of retired models, which nothing refers to any longer, available for new models
+size_t CSLCatalogTy::Reclaim ()
+{
+    size_t n = 0;
+    for (auto iter = vecRetired.begin(); iter != vecRetired.end();) {
+        CSLModel* pMdl = *iter;
+        if (pMdl->IsReclaimable()) {
+            LODForgetModel(pMdl);
+            *pMdl = CSLModel();         // frees all the model's memory
+            vecFree.push_back(pMdl);
+            iter = vecRetired.erase(iter);
+            ++n;
+        } else
+            ++iter;
+    }
+    return n;
+}
+
+// (Re)Sort the index and rebuild the attribute indexes after models have been added or removed
+void CSLCatalogTy::Sort ()
+{
+    if (!bSorted) {
+        std::sort(vecIdx.begin(), vecIdx.end(), CSLModelKeyLess);
+        bSorted = true;
+    }
+    if (bIdxDirty)
+        UpdateIdx();
+}
+
+// Find a model by its unique key (aircraft type and id)
+CSLModel* CSLCatalogTy::Find (const std::string& _type, const std::string& _id) const
+{
+    const std::string* pType = FindStr(_type);
+    const std::string* pId   = FindStr(_id);
+    if (!pType || !pId)
+        return nullptr;
+    auto iter = mapKey.find(std::make_pair(CSLStrTy(pType), CSLStrTy(pId)));
+    return iter == mapKey.end() ? nullptr : iter->second;
+}
+
+// All models with the given type, airline, or package
+const CSLCatalogTy::vecCSLModelPTy* CSLCatalogTy::Query (CSLModelFilterTy _filter,
+                                                         const std::string& _value)
+{
+    Sort();                                 // makes sure indexes are up to date
+    const std::string* pVal = FindStr(_value);
+    if (!pVal)                              // text unknown -> no model can have it
+        return nullptr;
+    
+    const mapStrIdxTy* pMap = nullptr;
+    switch (_filter) {
+        case CSL_FILTER_TYPE:       pMap = &mapIdxType;     break;
+        case CSL_FILTER_AIRLINE:    pMap = &mapIdxAirline;  break;
+        case CSL_FILTER_PACKAGE:    pMap = &mapIdxPkg;      break;
+        case CSL_FILTER_RELATED:    return nullptr;
+    }
+    if (!pMap) return nullptr;
+    mapStrIdxTy::const_iterator iter = pMap->find(CSLStrTy(pVal));
+    return iter == pMap->cend() ? nullptr : &iter->second;
+}
+
+// Removes all models and strings
+void CSLCatalogTy::clear ()
+{
+    vecIdx.clear();
+    mapKey.clear();
+    mapIdxType.clear();
+    mapIdxAirline.clear();
+    mapIdxPkg.clear();
+    bIdxDirty = false;
+    vecAdded.clear();
+    vecRetired.clear();
+    vecFree.clear();
+    dqMdl.clear();              // destroys the models, which unloads all X-Plane objects
+    setStr.clear();             // only now that no model refers to any string any longer
+    bSorted = true;
+}
+
+// Range of models in the given related group
+std::pair<CSLCatalogTy::iterator,CSLCatalogTy::iterator> CSLCatalogTy::RangeRelated (int _related)
+{
+    return std::equal_range(vecIdx.begin(), vecIdx.end(), _related,
+                            CSLModelRelatedLess());
+}
+
+// Rebuild the attribute indexes from the main index
+void CSLCatalogTy::UpdateIdx ()
+{
+    mapIdxType.clear();
+    mapIdxAirline.clear();
+    mapIdxPkg.clear();
+    for (CSLModel* pMdl: vecIdx) {
+        mapIdxType[pMdl->icaoType].push_back(pMdl);
+        // each airline only once per model, even if defined with several liveries
+        for (const CSLModel::MatchCritTy& mc: pMdl->vecMatchCrit) {
+            if (mc.icaoAirline.empty()) continue;
+            vecCSLModelPTy& v = mapIdxAirline[mc.icaoAirline];
+            if (v.empty() || v.back() != pMdl)
+                v.push_back(pMdl);
+        }
+        // the package name is the part of the id before the slash
+        const std::string& id = pMdl->cslId;
+        mapIdxPkg[Intern(id.substr(0, id.rfind('/')))].push_back(pMdl);
+    }
+    bIdxDirty = false;
+}
+
+//
+// MARK: CSL Bounds
+//
+
+// Extend by a vertex
+void CSLBoundsTy::Add (float x, float y, float z)
+{
+    const float v[3] = {x, y, z};
+    for (int i = 0; i < 3; ++i) {
+        if (!bValid || v[i] < min[i]) min[i] = v[i];
+        if (!bValid || v[i] > max[i]) max[i] = v[i];
+    }
+    const float r = std::sqrt(x*x + y*y + z*z);
+    if (r > radius)
+        radius = r;
+    bValid = true;
+}
+
+// Extend by another bounding box
+void CSLBoundsTy::Add (const CSLBoundsTy& o)
+{
+    if (!o.bValid)
+        return;
+    for (int i = 0; i < 3; ++i) {
+        if (!bValid || o.min[i] < min[i]) min[i] = o.min[i];
+        if (!bValid || o.max[i] > max[i]) max[i] = o.max[i];
+    }
+    if (o.radius > radius)
+        radius = o.radius;
+    bValid = true;
 }
 
 //
@@ -94,14 +345,6 @@ CSLObj::~CSLObj ()
     Unload();
 }
 
-// Load and return the underlying X-Plane object.
-XPLMObjectRef CSLObj::GetAndLoadObj ()
-{
-    // (Try) Loading, then return what we have, even if it is NULL
-    Load();
-    return xpObj;
-}
-
 // Determine which file to load and if we need a copied .obj file
 /// @details 1. Determine if we need to access a copied file at all
 ///          2. Compute that copied file name
@@ -118,25 +361,37 @@ void CSLObj::DetermineWhichObjToLoad ()
     
     // 2. Compute that copied file name
     pathOrig = path;                // Save the original name
+    std::string cpyPath = path;
     // remove the current extension
-    RemoveExtension(path);
+    RemoveExtension(cpyPath);
     // if we need to replace texture then a texture id should become part of the file name
     if (bDoReplTextures) {
         std::string addTxt = texture.empty() ? text_lit : texture;
         RemoveExtension(addTxt);
-        path += '.';
-        path += addTxt;
+        cpyPath += '.';
+        cpyPath += addTxt;
     }
     // always add 'xpmp2.obj' as the final extension
-    path += ".xpmp2.obj";
+    cpyPath += ".xpmp2.obj";
+    path = glob.catCSLModels.Intern(cpyPath);
     
     // 3. Test if that copied file already exists
-    if (ExistsFile(path))
+    if (ExistsFileCached(path))
         // It does exist, so no new copy is needed
-        pathOrig.clear();
+        pathOrig = CSLStrTy();
+}
+
+// Which file to scan, and does the scan need to apply the dataRef replacements of the copy?
+ObjScanFileTy CSLObj::GetScanFile () const
+{
+    // Use pathOrig if defined because it could be that path doesn't exist yet
+    ObjScanFileTy file;
+    file.path  = pathOrig.empty() ? path.str() : pathOrig.str();
+    file.bDoDR = !pathOrig.empty() && glob.bObjReplDataRefs;
+    return file;
 }
 
-// Read the obj file to calculate its vertical offset
+// Read an obj file to calculate its vertical offset and bounds, and to find the dataRefs it uses
 /// @details The idea behind doing this is taken from the original libxplanemp
 ///          implementation, particularly
 ///          `XPMPMultiplayerCSLOffset.cpp: CslModelVertOffsetCalculator::findOffsetInObj8`:
@@ -148,12 +403,20 @@ void CSLObj::DetermineWhichObjToLoad ()
 /// @note I am not sure why the original code returns `-max` if `min > 0`,
 ///       my understanding would be to always return `-min` and don't need `max`.
 ///       But I just hope that the original author knows better and I stick to it.
-float CSLObj::FetchVertOfsFromObjFile () const
+/// @details DataRefs are only found in animation, attribute, and light commands,
+///          so only lines starting with `A` or `L` are searched for them.
+///          If the original file is read, which will be copied upon load,
+///          then the dataRef replacements of the copy operation are applied first.
+bool CSLObj::ScanObjFile (const ObjScanFileTy& file,
+                          const mapDrIdxTy& mapDr,
+                          std::vector<bool>& vecUsed,
+                          CSLBoundsTy& bounds,
+                          float& vertOfs)
 {
     float min = 0.0f, max = 0.0f;
-    
-    // Which file to read? Use pathOrig if defined because it could be that path doesn't exist yet
-    const std::string& _path = pathOrig.empty() ? path : pathOrig;
+    vertOfs = 0.0f;
+    const std::string& _path = file.path;
+    const bool bDoDR = file.bDoDR;
     
     // Try opening our `.obj` file...that should actually work,
     // CSLObj only exists if the `.obj` file exists,
@@ -162,7 +425,7 @@ float CSLObj::FetchVertOfsFromObjFile () const
     std::ifstream fIn (TOPOSIX(_path));
     if (!fIn.good()) {
         LOG_MSG(logERR, ERR_COULD_NOT_OPEN, StripXPSysDir(_path).c_str());
-        return 0.0f;
+        return false;
     }
     while (fIn)
     {
@@ -173,18 +436,49 @@ float CSLObj::FetchVertOfsFromObjFile () const
         // line number 2 must define the version
         if (lnNr == 2) {
             // we can only read OBJ8 files
-            if (std::stol(ln) < 800) {
+            if (std::atol(ln.c_str()) < 800) {
                 LOG_MSG(logWARN, WARN_OBJ8_ONLY_VERTOFS,
                         ln.c_str(), StripXPSysDir(_path).c_str());
-                return 0.0f;
+                return false;
+            }
+        }
+        
+        // Commands within animation blocks are usually indented
+        const std::string::size_type p0 = ln.find_first_not_of(" \t");
+        if (p0 == std::string::npos)
+            continue;
+        
+        // Animations, attributes, and lights might refer to dataRefs
+        if (ln.size() > p0 + 4 && (ln[p0] == 'A' || ln[p0] == 'L') &&
+            ln.find('/') != std::string::npos)  // any dataRef has a slash
+        {
+            // apply the same replacement as the copy operation will do
+            if (bDoDR) {
+                for (const Obj8DataRefs& drVal: glob.listObj8DataRefs) {
+                    const std::string::size_type p = ln.find(drVal.s);
+                    if (p != std::string::npos) {
+                        ln.replace(p, drVal.s.size(), drVal.r);
+                        break;
+                    }
+                }
+            }
+            // test all tokens for known dataRefs (without array index)
+            for (std::string& tok: str_tokenize(ln, " \t")) {
+                const std::string::size_type p = tok.find('[');
+                if (p != std::string::npos)
+                    tok.erase(p);
+                const mapDrIdxTy::const_iterator iter = mapDr.find(tok);
+                if (iter != mapDr.cend())
+                    vecUsed[iter->second] = true;
             }
+            continue;
         }
         
         // We try to decide really fast...obj files can be long
         // We are looking for "VT" and "VLINE", each will have at least 20 chars
         // and the first one must be 'V', the 2nd one either T or L
-        if (ln.size() < 20 || ln[0] != 'V' ||
-            (ln[1] != 'T' && ln[1] != 'L'))
+        if (ln.size() < p0 + 20 || ln[p0] != 'V' ||
+            (ln[p0+1] != 'T' && ln[p0+1] != 'L'))
             continue;
         
         // Chances are good we process it, so let's break it up into tokens
@@ -193,18 +487,19 @@ float CSLObj::FetchVertOfsFromObjFile () const
             (tokens[0] != "VT" && tokens[0] != "VLINE"))
             continue;
         
-        // Get and process the Y coordinate
+        // Get and process the coordinates, Y is the vertical one
         const float y = std::stof(tokens[2]);
         if (y < min)
             min = y;
         else if (y > max)
             max = y;
+        bounds.Add(std::stof(tokens[1]), y, std::stof(tokens[3]));
     }
     
     // return the proper VERT_OFFSET based on the Y coordinates we have read
-    const float vertOfs = min < 0.0f ? -min : -max;
+    vertOfs = min < 0.0f ? -min : -max;
     LOG_MSG(logDEBUG, "Fetched VERT_OFFSET=%.1f from %s", vertOfs, StripXPSysDir(_path).c_str());
-    return vertOfs;
+    return true;
 }
 
 // Starts loading the XP object asynchronously
@@ -259,9 +554,8 @@ void CSLObj::XPObjLoadedCB (XPLMObjectRef inObject,
         // the refcon is a pointer to a pair object created just for us
         pairOfStrTy* p = reinterpret_cast<pairOfStrTy*>(inRefcon);
     
-        // try finding the CSL model object in the global map
-        mapCSLModelTy::iterator cslIter;
-        CSLModel* pCsl = CSLModelByName(p->first, &cslIter);
+        // try finding the CSL model object in the global catalog
+        CSLModel* pCsl = CSLModelByName(p->first);
         if (!pCsl) {
             // CSL model not found in global map -> release the X-Plane object right away
             LOG_MSG(logERR, ERR_OBJ_NOT_FOUND, p->first.c_str());
@@ -274,26 +568,30 @@ void CSLObj::XPObjLoadedCB (XPLMObjectRef inObject,
             listCSLObjTy::iterator iter = std::find_if(pCsl->listObj.begin(),
                                                        pCsl->listObj.end(),
                                                        [p](const CSLObj& o)
-                                                       { return o.path == p->second; });
+                                                       { return o.path.str() == p->second; });
         
-            // found?
-            if (iter != pCsl->listObj.end()) {
+            // not found or not waiting for it? (The model might have been replaced by a reloaded one meanwhile)
+            if (iter == pCsl->listObj.end() || iter->GetObjState() != OLS_LOADING) {
+                LOG_MSG(logDEBUG, DEBUG_OBJ_DISCARDED, p->first.c_str());
+                if (inObject)
+                    XPLMUnloadObject(inObject);
+            }
+            else {
                 // Loading succeeded -> save the object and state
                 if (inObject) {
                     iter->xpObj      = inObject;
                     iter->xpObjState = OLS_AVAILABLE;
                     LOG_MSG(logDEBUG, DEBUG_OBJ_LOADED,
                             iter->cslId.c_str(), StripXPSysDir(iter->path).c_str());
+                    // this might have been the last missing piece of the model
+                    pCsl->AdvanceLoad();
                 }
                 // Loading of CSL object failed! -> remove the entire CSL model
                 // so we don't try again and don't use it in matching
                 else {
                     iter->Invalidate();
-                    glob.mapCSLModels.erase(cslIter);
+                    pCsl->Retire();
                 }
-            } else {
-                LOG_MSG(logERR, ERR_OBJ_OBJ_NOT_FOUND, p->first.c_str());
-                XPLMUnloadObject(inObject);
             }
         }
     
@@ -389,7 +687,7 @@ void CSLModel::AddMatchCriteria (const std::string& _type,
 {
     // We cannot overwrite with a _different_ a/c ICAO type!
     if (!icaoType.empty() &&            // already defined
-        icaoType != _type)              // but wanted something different now?
+        icaoType.str() != _type)        // but wanted something different now?
     {
         LOG_MSG(logWARN, WARN_DIFF_TYPE, lnNr,
                 _type.c_str(), icaoType.c_str(), 
@@ -397,7 +695,7 @@ void CSLModel::AddMatchCriteria (const std::string& _type,
     }
     // set the ICAO aircraft type once and forever
     else if (icaoType.empty()) {
-        icaoType = _type;
+        icaoType = glob.catCSLModels.Intern(_type);
         doc8643 = & Doc8643Get(_type);
         related = RelatedGet(_type);
     }
@@ -414,14 +712,16 @@ void CSLModel::AddMatchCriteria (const std::string& _type,
 }
 
 // Puts together the model name string from a path component and the model's id
-void CSLModel::CompModelName ()
+void CSLModel::CompModelName (const std::string& shortId)
 {
     // Find the last component of the path
-    size_t sep = xsbAircraftPath.find_last_of("\\/:");
-    modelName = sep == std::string::npos ? xsbAircraftPath : xsbAircraftPath.substr(sep+1);
+    const std::string& xsbPath = xsbAircraftPath;
+    size_t sep = xsbPath.find_last_of("\\/:");
+    std::string name = sep == std::string::npos ? xsbPath : xsbPath.substr(sep+1);
     // Add the id to it
-    modelName += ' ';
-    modelName += shortId;
+    name += ' ';
+    name += shortId;
+    modelName = glob.catCSLModels.Intern(name);
 }
 
 // compiles the string used as key in the CSL model map
@@ -444,39 +744,120 @@ ObjLoadStateTy CSLModel::GetObjState () const
     ->GetObjState();
 }
 
-// Try get ALL object handles, only returns anything if it is the complete list
-std::list<XPLMObjectRef> CSLModel::GetAllObjRefs ()
+// Request the model to be loaded
+/// @details The aircraft is not notified if the model is ready right away,
+///          the caller then creates instances immediately.
+bool CSLModel::RequestLoad (XPMPPlaneID _acId)
 {
-    // This loads the object, so we should make sure to have a VERT_OFFSET, too
-    if (bVertOfsReadFromFile) {
-        // span a job to read it from the object files
-        bVertOfsReadFromFile = false;
-        futVertOfs = std::async(std::launch::async,
-                                &CSLModel::FetchVertOfsFromObjFile, this);
+    switch (mdlLoadState) {
+        case MLS_READY:                         // ready to use
+            return true;
+        case MLS_FAILED:                        // will never become ready
+            return false;
+        case MLS_UNLOADED:                      // start the loading sequence
+            // Loading the objects requires a VERT_OFFSET
+            // and to know the dataRefs the objects use
+            if (!bObjScanStarted) {
+                // span a job to read it from the object files,
+                // passing a snapshot of the files and of the currently known dataRefs
+                // (the copy thread might change the objects' paths meanwhile)
+                bObjScanStarted = true;
+                std::vector<ObjScanFileTy> vecFiles;
+                vecFiles.reserve(listObj.size());
+                for (const CSLObj& obj: listObj)
+                    vecFiles.push_back(obj.GetScanFile());
+                mapDrIdxTy mapDr;
+                for (size_t i = 0; DR_NAMES[i]; ++i)
+                    mapDr.emplace(DR_NAMES[i], i);
+                futObjScan = std::async(std::launch::async, &CSLModel::ScanObjFiles,
+                                        std::move(vecFiles), std::move(mapDr));
+            }
+            mdlLoadState = MLS_LOADING;
+            gVecMdlLoading.push_back(this);
+            AdvanceLoad();                      // kick off copying/loading right away
+            if (mdlLoadState == MLS_READY)      // objects could still have been available
+                return true;
+            break;
+        case MLS_COPYING:
+        case MLS_LOADING:
+            break;
     }
     
-    bool bFullyLoaded = true;
-    std::list<XPLMObjectRef> l;
-    for (CSLObj& obj: listObj)                  // loop over all object
+    // Not ready: register the aircraft for notification
+    if (std::find(vecWaitingAc.cbegin(), vecWaitingAc.cend(), _acId) == vecWaitingAc.cend())
+        vecWaitingAc.push_back(_acId);
+    return false;
+}
+
+// Advance the loading sequence: copy, scan, async load
+/// @details Copying and scanning happen in separate threads, which we need to poll,
+///          but this is done once per model, not per waiting aircraft.
+///          Async object loading reports back via XPObjLoadedCB(), which calls us, too.
+void CSLModel::AdvanceLoad ()
+{
+    // only while loading is underway
+    if (mdlLoadState != MLS_COPYING && mdlLoadState != MLS_LOADING)
+        return;
+    
+    bool bAllAvail = true;
+    bool bCopying = false;
+    for (CSLObj& obj: listObj)
     {
-        if (obj.IsInvalid())                    // if any object is considered valid
-            return std::list<XPLMObjectRef>();  // return an empty list
+        // Loading of any object failed? Then the model has failed
+        if (obj.IsInvalid()) {
+            mdlLoadState = MLS_FAILED;
+            NotifyWaitingAc();
+            return;
+        }
         
-        l.push_back(obj.GetAndLoadObj());       // load and save the handle
-        if (l.back() == NULL)                   // not (yet) loaded?
-            bFullyLoaded = false;               // return an empty list in the end
+        obj.Load();                             // triggers copying or async loading as needed
+        switch (obj.GetObjState()) {
+            case OLS_AVAILABLE:
+                break;
+            case OLS_UNAVAIL:                   // waiting for the copy thread to become free
+            case OLS_COPYING:
+                bCopying = true;
+                bAllAvail = false;
+                break;
+            default:
+                bAllAvail = false;
+        }
     }
     
-    // Also check if our vertical offset is available now
-    if (futVertOfs.valid()) {                   // we are waiting for a result
-        if (futVertOfs.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
-            bFullyLoaded = false;               // not yet available
+    // Also check if the scan result is available now
+    if (futObjScan.valid()) {                   // we are waiting for a result
+        if (futObjScan.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            bAllAvail = false;                  // not yet available
         else
-            vertOfs = futVertOfs.get();         // avaiable, get it
+            ApplyObjScan(futObjScan.get());     // avaiable, get it
     }
     
-    // return the complete list of handles if all was successful
-    return bFullyLoaded ? l : std::list<XPLMObjectRef>();
+    // Complete? Then inform all waiting aircraft
+    if (bAllAvail) {
+        mdlLoadState = MLS_READY;
+        NotifyWaitingAc();
+    }
+    else
+        mdlLoadState = bCopying ? MLS_COPYING : MLS_LOADING;
+}
+
+// Inform all waiting aircraft that loading has ended
+void CSLModel::NotifyWaitingAc ()
+{
+    // (Aircraft might re-match and by that register with other models)
+    std::vector<XPMPPlaneID> vecAc;
+    vecAc.swap(vecWaitingAc);
+    for (XPMPPlaneID id: vecAc) {
+        Aircraft* pAc = AcFindByID(id);
+        if (pAc)
+            pAc->ModelLoaded(this);
+    }
+}
+
+// Is the dataRef subset available and still up to date?
+bool CSLModel::HasDrSubset () const
+{
+    return nDrKnown > 0 && nDrKnown == DR_NAMES.size()-1;
 }
 
 // Decrease the reference counter for Aircraft usage
@@ -498,50 +879,160 @@ float CSLModel::GarbageCollection (float, float, int, void*)
     UPDATE_CYCLE_NUM;               // DEBUG only: Store current cycle number in glob.xpCycleNum
     const float now = GetMiscNetwTime();
     // loop all models
-    for (auto& p: glob.mapCSLModels) {
-        CSLModel& mdl = p.second;
+    for (CSLModel* pMdl: glob.catCSLModels) {
+        CSLModel& mdl = *pMdl;
         // loaded, but reference counter zero, and timeout reached
-        if (mdl.GetObjState() == OLS_AVAILABLE &&
+        if (mdl.IsReady() &&
             mdl.GetRefCnt() == 0 &&
             now - mdl.refZeroTs > GARBAGE_COLLECTION_TIMEOUT)
             // unload the object
             mdl.Unload();
     }
     
+    // Reuse the storage of retired models
+    const size_t nReclaimed = glob.catCSLModels.Reclaim();
+    if (nReclaimed > 0) {
+        LOG_MSG(logDEBUG, DEBUG_MDL_RECLAIMED, (unsigned long)nReclaimed);
+    }
+    
     return GARBAGE_COLLECTION_PERIOD;
 }
 
+// Takes the model out of service after its objects failed to load
+void CSLModel::Retire ()
+{
+    // remove from the catalog's index first, so that re-matching won't find it again
+    glob.catCSLModels.Remove(this);
+    // All aircraft that still use me need a new model
+    for (auto& p: glob.mapAc)
+        if (p.second->GetModel() == this &&
+            p.second->IsValid())
+            p.second->ReMatchModel();
+    // Background tasks refer to our objects, wait for them before freeing them
+    if (futObjScan.valid())
+        futObjScan.wait();
+    futObjScan = std::future<ObjScanTy>();
+    for (CSLObj& obj: listObj)
+        obj.WaitForCopy();
+    // free the objects, the model is invalid from now on
+    Unload();
+    listObj.clear();
+    mdlLoadState = MLS_FAILED;
+    NotifyWaitingAc();
+    // our storage can be reused once nothing refers to us any longer
+    glob.catCSLModels.AddRetired(this);
+}
+
+// Can the storage of this retired model be reused?
+bool CSLModel::IsReclaimable () const
+{
+    if (mdlLoadState != MLS_FAILED || refCnt > 0 ||
+        !vecWaitingAc.empty() || futObjScan.valid())
+        return false;
+    if (std::find(gVecMdlLoading.cbegin(), gVecMdlLoading.cend(), this) != gVecMdlLoading.cend())
+        return false;
+    for (const auto& p: glob.mapAc) {
+        const Aircraft& ac = *p.second;
+        if (ac.pCSLMdl == this || ac.pCSLMdlUpgrade == this || ac.pLODMdl == this)
+            return false;
+    }
+    return true;
+}
+
+// Is this model defined exactly like the other one?
+bool CSLModel::SameDefinition (const CSLModel& o) const
+{
+    // Type and id must be the same, both are interned, so handles compare
+    if (icaoType != o.icaoType || cslId != o.cslId)
+        return false;
+    // Same objects, same textures
+    // (`pathOrig` is not compared: it is empty once the copy exists)
+    if (listObj.size() != o.listObj.size())
+        return false;
+    for (size_t i = 0; i < listObj.size(); ++i)
+        if (listObj[i].path     != o.listObj[i].path    ||
+            listObj[i].texture  != o.listObj[i].texture ||
+            listObj[i].text_lit != o.listObj[i].text_lit)
+            return false;
+    // Same match criteria
+    if (vecMatchCrit.size() != o.vecMatchCrit.size())
+        return false;
+    for (size_t i = 0; i < vecMatchCrit.size(); ++i)
+        if (vecMatchCrit[i].icaoAirline != o.vecMatchCrit[i].icaoAirline ||
+            vecMatchCrit[i].livery      != o.vecMatchCrit[i].livery)
+            return false;
+    // Same vertical offset (or both to be read from the `.obj` files)
+    if (bVertOfsReadFromFile != o.bVertOfsReadFromFile)
+        return false;
+    return bVertOfsReadFromFile || std::abs(vertOfs - o.vertOfs) < 0.001f;
+}
+
 // Unload all objects
 void CSLModel::Unload ()
 {
     for (CSLObj& o: listObj)
         o.Unload();
+    if (mdlLoadState == MLS_READY)
+        mdlLoadState = MLS_UNLOADED;
 }
 
-// Read the obj files to fill CSLModel::vertOfs
+// Scan the obj files for CSLModel::vertOfs and the dataRefs used
 /// @note Expected to be called in a separate thread via std::async
-float CSLModel::FetchVertOfsFromObjFile () const
+CSLModel::ObjScanTy CSLModel::ScanObjFiles (std::vector<ObjScanFileTy> vecFiles, mapDrIdxTy mapDr)
 {
     // This is a thread main function, set thread's name and try to catch all exceptions
-    SET_THREAD_NAME("XPMP2_VertOfs");
+    SET_THREAD_NAME("XPMP2_ObjScan");
 
-    float ret = 0.0f;
+    ObjScanTy ret;
+    ret.vecUsed.resize(mapDr.size(), false);
     try {
-        for (const CSLObj& obj: listObj) {
-            const float o = obj.FetchVertOfsFromObjFile();
-            if (o > ret)
-                ret = o;
+        bool bAllRead = true;
+        for (const ObjScanFileTy& file: vecFiles) {
+            CSLBoundsTy objBounds;
+            float o = 0.0f;
+            if (!CSLObj::ScanObjFile(file, mapDr, ret.vecUsed, objBounds, o))
+                bAllRead = false;
+            if (o > ret.vertOfs)
+                ret.vertOfs = o;
+            ret.bounds.Add(objBounds);
         }
+        // If any file couldn't be read we don't know all dataRefs used, so we use all
+        if (!bAllRead)
+            ret.vecUsed.clear();
     }
     catch(const std::system_error& e) {
-        LOG_MSG(logERR, "Reading vertical offsets failed: %s", e.what());
+        LOG_MSG(logERR, "Scanning object files failed: %s", e.what());
+        ret.vecUsed.clear();                // unreliable, use all dataRefs
     }
     catch (...) {
-        LOG_MSG(logERR, "Reading vertical offsets failed with an exception");
+        LOG_MSG(logERR, "Scanning object files failed with an exception");
+        ret.vecUsed.clear();
     }
     return ret;
 }
 
+// Take over the result of scanning the `.obj` files
+void CSLModel::ApplyObjScan (ObjScanTy&& scan)
+{
+    if (bVertOfsReadFromFile)
+        vertOfs = scan.vertOfs;
+    bounds = scan.bounds;
+    
+    // Build the dataRef subset and its gather index
+    vecDrNames.clear();
+    vecDrIdx.clear();
+    for (size_t i = 0; i < scan.vecUsed.size(); ++i) {
+        if (scan.vecUsed[i]) {
+            vecDrNames.push_back(DR_NAMES[i]);
+            vecDrIdx.push_back(uint16_t(i));
+        }
+    }
+    vecDrNames.push_back(nullptr);
+    nDrKnown = scan.vecUsed.size();
+    LOG_MSG(logDEBUG, DEBUG_OBJ_DR_SUBSET, cslId.c_str(),
+            (unsigned long)vecDrIdx.size(), (unsigned long)nDrKnown);
+}
+
 //
 // MARK: Internal Functions
 //
@@ -595,7 +1086,8 @@ std::string CSLModelsConvPackagePath (const std::string& pkgPath,
     std::string path = pkgIter->second + relFilePath;
     
     // We do check here already if that target really exists
-    if (!ExistsFile(TOPOSIX(path))) {
+    ProfilePhase prof("CSLModelsConvPackagePath");
+    if (!ExistsFileCached(TOPOSIX(path))) {
         LOG_MSG(logERR, ERR_OBJ_FILE_NOT_FOUND, lnNr,
                 StripXPSysDir(pkgPath).c_str(), StripXPSysDir(path).c_str());
         return "";
@@ -609,12 +1101,19 @@ std::string CSLModelsConvPackagePath (const std::string& pkgPath,
 /// Adds a readily defined CSL model to all the necessary maps, resets passed-in reference
 void CSLModelsAdd (CSLModel& _csl)
 {
-    // the main map, which actually "owns" the object, indexed by key
-    auto p = glob.mapCSLModels.emplace(_csl.GetKeyString(), std::move(_csl));
-    if (!p.second) {                    // not inserted, ie. not a new entry!
-        LOG_MSG(logWARN, WARN_DUP_MODEL, p.first->second.GetModelName().c_str(),
-                p.first->second.xsbAircraftLn,
-                StripXPSysDir(p.first->second.xsbAircraftPath).c_str());
+    // Reloading a package? Then only collect the model, the caller decides
+    if (gpVecMdlCollect) {
+        gpVecMdlCollect->push_back(std::move(_csl));
+        _csl = CSLModel();
+        return;
+    }
+    
+    // the catalog, which actually "owns" the object
+    const CSLModel* pExisting = glob.catCSLModels.Add(std::move(_csl));
+    if (pExisting) {                    // not inserted, ie. not a new entry!
+        LOG_MSG(logWARN, WARN_DUP_MODEL, pExisting->GetModelName().c_str(),
+                pExisting->xsbAircraftLn,
+                StripXPSysDir(pExisting->xsbAircraftPath).c_str());
     }
 
     // in all cases properly reset the passed-in reference
@@ -630,6 +1129,7 @@ const char* CSLModelsReadPkgId (const std::string& path)
     std::ifstream fAc (TOPOSIX(xsbName));
     if (!fAc || !fAc.is_open())
         return WARN_NO_XSBACTXT_FOUND;
+    ProfileFile(fAc);
     
     // read the file line by line
 //    LOG_MSG(logINFO, INFO_XSBACTXT_READ, xsbName.c_str());
@@ -652,6 +1152,8 @@ const char* CSLModelsReadPkgId (const std::string& path)
             // Found a package id -> save an entry for a package
             auto p = glob.mapCSLPkgs.insert(std::make_pair(tokens[1], path + XPLMGetDirectorySeparator()[0]));
             if (!p.second) {                // not inserted, ie. package name existed already?
+                if (p.first->second == path + XPLMGetDirectorySeparator()[0])
+                    continue;               // same folder read again, e.g. when reloading the package
                 LOG_MSG(logWARN, WARN_DUP_PKG_NAME,
                         tokens[1].c_str(), StripXPSysDir(path).c_str(),
                         p.first->second.c_str());
@@ -669,22 +1171,24 @@ const char* CSLModelsReadPkgId (const std::string& path)
     return "";
 }
 
-/// @brief Recursively scans folders to find `xsb_aircraft.txt` files of CSL packages
-/// @param _path The path to start the search in
-/// @param[out] paths List of paths in which an xsb_aircraft.txt file has actually been found
-/// @param _maxDepth How deep into the folder hierarchy shall we search? (defaults to 5)
+// Recursively scans folders to find `xsb_aircraft.txt` files of CSL packages
 const char* CSLModelsFindPkgs (const std::string& _path,
                                std::vector<std::string>& paths,
-                               int _maxDepth = 5)
+                               int _maxDepth,
+                               std::vector<std::string>* pDirs)
 {
     // Search the current given path for an xsb_aircraft.txt file
     std::list<std::string> files = GetDirContents(_path);
+    ProfileFile();
+    DirCacheAdd(_path, files);
     if (std::find(files.cbegin(), files.cend(), XSB_AIRCRAFT_TXT) != files.cend())
     {
         // Found a "xsb_aircraft.txt"! Let's process this path then!
         paths.push_back(_path);
         return CSLModelsReadPkgId(_path);
     }
+    if (pDirs)
+        pDirs->push_back(_path);
     
     // Are we still allowed to dig deeper into the folder hierarchy?
     bool bFoundAnything = false;
@@ -694,7 +1198,7 @@ const char* CSLModelsFindPkgs (const std::string& _path,
             const std::string nextPath(_path + XPLMGetDirectorySeparator()[0] + f);
             if (IsDir(TOPOSIX(nextPath))) {
                 // recuresively call myself, allow one level of hierarchy less
-                const char* res = CSLModelsFindPkgs(nextPath, paths, _maxDepth-1);
+                const char* res = CSLModelsFindPkgs(nextPath, paths, _maxDepth-1, pDirs);
                 // Not the message "nothing found"?
                 if (strcmp(res, WARN_NO_XSBACTXT_FOUND) != 0) {
                     // if any other error: stop here and return that error
@@ -742,23 +1246,23 @@ void AcTxtLine_OBJ8_AIRCRAFT (CSLModel& csl,
         CSLModelsAdd(csl);
     
     // Properly set the xsb_aircraft.txt location
-    csl.xsbAircraftPath = xsbAircraftPath;
+    csl.xsbAircraftPath = glob.catCSLModels.Intern(xsbAircraftPath);
     csl.xsbAircraftLn   = lnNr;
     
     // Second parameter (actually we take all the rest of the line) is the short id:
     if (ln.length() >= 15) {
-        csl.shortId = ln.substr(14);
-        trim(csl.shortId);
+        std::string shortId = ln.substr(14);
+        trim(shortId);
         
         // sometimes (e.g. X-CSL) the name already contains a package name, that's superflous, take the last part only as short id
-        std::string::size_type sepPos = csl.shortId.find_last_of(":/\\");
+        std::string::size_type sepPos = shortId.find_last_of(":/\\");
         if (sepPos != std::string::npos)
-            csl.shortId.erase(0,sepPos+1);
+            shortId.erase(0,sepPos+1);
         
         // full id is package name (EXPORT) plus the short id
-        csl.cslId = exportName + '/' + csl.shortId;
+        csl.cslId = glob.catCSLModels.Intern(exportName + '/' + shortId);
         // human readable model name is last part of path plus short id
-        csl.CompModelName();
+        csl.CompModelName(shortId);
     }
     else LOG_MSG(logERR, ERR_TOO_FEW_PARAM, lnNr, "OBJ8_AIRCRAFT", 1);
 }
@@ -788,14 +1292,14 @@ void AcTxtLine_OBJ8 (CSLModel& csl,
         if (!path.empty()) {
             // save the path as an additional object to the model
             // (Paths  to .obj are always stored in POSIX format)
-            csl.listObj.emplace_back(csl.GetId(), TOPOSIX(path));
+            csl.listObj.emplace_back(csl.cslId, glob.catCSLModels.Intern(TOPOSIX(path)));
             CSLObj& obj = csl.listObj.back();
 
             // we can already read the TEXTURE and TEXTURE_LIT paths
             if (tokens.size() >= 5) {
-                obj.texture = CSLModelsConvPackagePath(tokens[4], lnNr, true);
+                obj.texture = glob.catCSLModels.Intern(CSLModelsConvPackagePath(tokens[4], lnNr, true));
                 if (tokens.size() >= 6)
-                    obj.text_lit = CSLModelsConvPackagePath(tokens[5], lnNr, true);
+                    obj.text_lit = glob.catCSLModels.Intern(CSLModelsConvPackagePath(tokens[5], lnNr, true));
             } // TEXTURE available
             
             // Determine which file to load and if we need a copied .obj file
@@ -844,9 +1348,9 @@ void AcTxtLine_MATCHES (CSLModel& csl,
         // Add match criteria to the CSL model
         CSLModel::MatchCritTy mc;
         if (tokens.size() >= 3 && tokens[2] != "-")     // if given: airline
-            mc.icaoAirline = tokens[2];
+            mc.icaoAirline = glob.catCSLModels.Intern(tokens[2]);
         if (tokens.size() >= 4 && tokens[3] != "-")     // if given: livery
-            mc.livery = tokens[3];
+            mc.livery = glob.catCSLModels.Intern(tokens[3]);
         // Set/Add all match criteria
         csl.AddMatchCriteria(tokens[1], mc, lnNr);
     }
@@ -907,6 +1411,7 @@ const char* CSLModelsProcessAcFile (const std::string& path)
     std::ifstream fAc (TOPOSIX(xsbName));
     if (!fAc || !fAc.is_open())
         return WARN_NO_XSBACTXT_FOUND;
+    ProfileFile(fAc);
     
     // read the file line by line
     LOG_MSG(logDEBUG, DEBUG_XSBACTXT_READ, StripXPSysDir(xsbName).c_str());
@@ -995,6 +1500,7 @@ const char* CSLModelsProcessAcFile (const std::string& path)
     if (!acRead.empty()) {
         std::string acList;
         int totAcRead = StrCntString(acRead, acList);
+        ProfileModels((unsigned long)totAcRead);
         LOG_MSG(logINFO, INFO_XSBACTXT_DONE, totAcRead, acList.c_str(),
                 StripXPSysDir(xsbName).c_str());
     }
@@ -1059,8 +1565,10 @@ void CSLModelsCleanup ()
         gGarbageCollectionID = nullptr;
     }
     
+    // Nothing is being loaded any longer
+    gVecMdlLoading.clear();
     // Clear out all model objects, will in turn unload all X-Plane objects
-    glob.mapCSLModels.clear();
+    glob.catCSLModels.clear();
     // Clear out all packages
     glob.mapCSLPkgs.clear();
 }
@@ -1075,47 +1583,194 @@ const char* CSLModelsLoad (const std::string& _path,
     // (This might rarely be used as OBJ8 only consists of one file,
     //  but the original xsb_aircraft.txt syntax requires it.)
     std::vector<std::string> paths;
-    const char* res = CSLModelsFindPkgs(_path, paths, _maxDepth);
+    const char* res = "";
     
-    // Now we can process each folder and read in the CSL models there
-    for (const std::string& p: paths)
-    {
-        const char* r = CSLModelsProcessAcFile(p);
-        if (r[0]) {                     // error?
-            res = r;                    // keep it as function result (but continue with next path anyway)
-            LOG_MSG(logWARN, "%s", res);// also report it to the log
+    // An up-to-date shared catalog saves all the parsing.
+    // If it isn't up to date we hold its lock while parsing,
+    // so that other plugins wait and then use our result.
+    std::unique_ptr<CSLCacheLock> pCacheLock;
+    bool bFromCache = false;
+    if (glob.bSharedCatalog) {
+        bFromCache = CSLCacheRead(_path, _maxDepth, paths);
+        if (!bFromCache) {
+            pCacheLock.reset(new CSLCacheLock(_path, _maxDepth));
+            // someone else might just have finished building it
+            bFromCache = CSLCacheRead(_path, _maxDepth, paths);
+        }
+    }
+    
+    if (!bFromCache) {
+        std::vector<std::string> dirs;
+        DirCacheBegin();                // answer file existence checks from directory listings
+        {
+            ProfilePhase prof("CSLModelsFindPkgs", _path);
+            res = CSLModelsFindPkgs(_path, paths, _maxDepth, &dirs);
         }
+        
+        // Now we can process each folder and read in the CSL models there
+        for (const std::string& p: paths)
+        {
+            ProfilePhase prof("CSLModelsProcessAcFile", p);
+            const char* r = CSLModelsProcessAcFile(p);
+            if (r[0]) {                 // error?
+                res = r;                // keep it as function result (but continue with next path anyway)
+                LOG_MSG(logWARN, "%s", res);// also report it to the log
+            }
+        }
+        
+        DirCacheEnd();
+        
+        // Share what we have read
+        if (pCacheLock && pCacheLock->IsLocked() && !paths.empty())
+            CSLCacheWrite(_path, _maxDepth, paths, dirs);
     }
+    pCacheLock.reset();
+    
+    // Let the folder watcher know about the packages
+    WatchAddRoot(_path, _maxDepth, paths);
+    
+    // Sort the catalog's index and build the attribute indexes once, after all models are added
+    glob.catCSLModels.Sort();
     
     // How many models do we now have in total?
-    LOG_MSG(logINFO, INFO_TOTAL_NUM_MODELS, (unsigned long)glob.mapCSLModels.size())
+    LOG_MSG(logINFO, INFO_TOTAL_NUM_MODELS, (unsigned long)glob.catCSLModels.size(),
+            (unsigned long)glob.catCSLModels.NumStr())
+    
+    // Existing aircraft might find better matches among the new models
+    RematchQueue(glob.catCSLModels.TakeAdded());
     
     // return the final result
     return res;
 }
 
 
+// Re-read one package and update the catalog with what has changed
+const char* CSLModelsReloadPkg (const std::string& path)
+{
+    ProfilePhase prof("CSLModelsReloadPkg", path);
+    
+    // The models currently known from this package
+    std::vector<CSLModel*> vecOld;
+    const std::string* pPath = glob.catCSLModels.FindStr(path);
+    if (pPath)
+        for (CSLModel* pMdl: glob.catCSLModels)
+            if (&pMdl->xsbAircraftPath.str() == pPath)
+                vecOld.push_back(pMdl);
+    
+    // Re-register the package names, then read the models into a separate list
+    std::vector<CSLModel> vecNew;
+    const char* res = CSLModelsReadPkgId(path);
+    if (!res[0]) {
+        gpVecMdlCollect = &vecNew;
+        res = CSLModelsProcessAcFile(path);
+        gpVecMdlCollect = nullptr;
+    }
+    // Package is gone? Then also forget its package names
+    if (!strcmp(res, WARN_NO_XSBACTXT_FOUND)) {
+        const std::string pkgPath = path + XPLMGetDirectorySeparator()[0];
+        for (auto iter = glob.mapCSLPkgs.begin(); iter != glob.mapCSLPkgs.end();)
+            if (iter->second == pkgPath)
+                iter = glob.mapCSLPkgs.erase(iter);
+            else
+                ++iter;
+    }
+    
+    // Find the new definition of each old model
+    typedef std::pair<const std::string*, const std::string*> keyTy;
+    std::map<keyTy, size_t> mapNew;
+    std::vector<bool> vecSkip (vecNew.size(), false);
+    for (size_t i = 0; i < vecNew.size(); ++i)
+        // duplicate definitions are ignored, as when loading the package
+        if (!mapNew.emplace(keyTy(&vecNew[i].GetIcaoType(), &vecNew[i].GetId()), i).second)
+            vecSkip[i] = true;
+    std::vector<CSLModel*> vecRetire;
+    int nAdded = 0, nChanged = 0, nRemoved = 0, nUnchanged = 0;
+    for (CSLModel* pOld: vecOld) {
+        auto iter = mapNew.find(keyTy(&pOld->GetIcaoType(), &pOld->GetId()));
+        if (iter == mapNew.end()) {
+            ++nRemoved;
+            vecRetire.push_back(pOld);
+        }
+        else if (!pOld->SameDefinition(vecNew[iter->second])) {
+            ++nChanged;
+            vecRetire.push_back(pOld);
+        }
+        else {
+            ++nUnchanged;               // keep the old model, it might be in use or loaded
+            pOld->xsbAircraftLn = vecNew[iter->second].xsbAircraftLn;
+            vecSkip[iter->second] = true;
+        }
+    }
+    
+    // Replace changed and removed models in the catalog by the new ones
+    for (CSLModel* pOld: vecRetire)
+        glob.catCSLModels.Remove(pOld);
+    for (size_t i = 0; i < vecNew.size(); ++i)
+        if (!vecSkip[i])
+            CSLModelsAdd(vecNew[i]);
+    nAdded = int(vecNew.size() - size_t(std::count(vecSkip.begin(), vecSkip.end(), true))) - nChanged;
+    glob.catCSLModels.Sort();
+    
+    // Only now take the old models out of service, which re-matches the aircraft using them
+    for (CSLModel* pOld: vecRetire)
+        pOld->Retire();
+    
+    LOG_MSG(logINFO, INFO_PKG_RELOADED, StripXPSysDir(path).c_str(),
+            nAdded, nChanged, nRemoved, nUnchanged);
+    RematchQueue(glob.catCSLModels.TakeAdded());
+    return res;
+}
+
+// Advance the loading sequence of all models currently being loaded
+void CSLModelsProcessLoads ()
+{
+    if (gVecMdlLoading.empty())
+        return;
+    
+    // Advance each model, then remove those, which are done
+    for (size_t i = 0; i < gVecMdlLoading.size(); ++i)
+        gVecMdlLoading[i]->AdvanceLoad();
+    gVecMdlLoading.erase(std::remove_if(gVecMdlLoading.begin(), gVecMdlLoading.end(),
+                                        [](const CSLModel* pMdl)
+                                        { return pMdl->GetLoadState() != MLS_COPYING &&
+                                                 pMdl->GetLoadState() != MLS_LOADING; }),
+                         gVecMdlLoading.end());
+}
+
 // Find a model by name
-CSLModel* CSLModelByName (const std::string& _mdlName,
-                          mapCSLModelTy::iterator* _pOutIter)
+CSLModel* CSLModelByName (const std::string& _mdlName)
 {
-    // try finding the model by name
-    mapCSLModelTy::iterator iter =
-    std::find_if(glob.mapCSLModels.begin(),
-                 glob.mapCSLModels.end(),
-                 [_mdlName](const mapCSLModelTy::value_type& csl)
-                 { return csl.second.GetId() == _mdlName; });
+    // If the name isn't even in the string pool then there is no such model
+    const std::string* pName = glob.catCSLModels.FindStr(_mdlName);
+    if (!pName)
+        return nullptr;
     
-    // If requested, also return the iterator itself
-    if (_pOutIter)
-        *_pOutIter = iter;
+    // try finding the model by name, comparing string handles only
+    const CSLStrTy name(pName);
+    CSLCatalogTy::iterator iter =
+    std::find_if(glob.catCSLModels.begin(),
+                 glob.catCSLModels.end(),
+                 [name](const CSLModel* pCsl)
+                 { return pCsl->cslId == name; });
     
     // not found, or invalid?
-    if (iter == glob.mapCSLModels.end() || iter->second.IsObjInvalid())
+    if (iter == glob.catCSLModels.end() || (*iter)->IsObjInvalid())
         return nullptr;
     
     // Success
-    return &iter->second;
+    return *iter;
+}
+
+// Find a model by the key string as returned by CSLModel::GetKeyString()
+CSLModel* CSLModelByKey (const std::string& _key)
+{
+    // The key has the format "rrrr|type|id", see CSLModelGetKeyStr()
+    const std::string::size_type sep1 = _key.find('|');
+    if (sep1 == std::string::npos) return nullptr;
+    const std::string::size_type sep2 = _key.find('|', sep1+1);
+    if (sep2 == std::string::npos) return nullptr;
+    return glob.catCSLModels.Find(_key.substr(sep1+1, sep2-sep1-1),
+                                  _key.substr(sep2+1));
 }
 
 //
@@ -1143,106 +1798,147 @@ IteratorT iterRnd (IteratorT lower, IteratorT upper)
     return lower;
 }
 
+/// How many parameters will we compare?
+constexpr unsigned DOC8643_MATCH_PARAMS = 10;
+/// Quality worse than any actual match
+constexpr unsigned DOC8643_MATCH_WORST_QUAL = 2 << DOC8643_MATCH_PARAMS;
+/// Bit mask of matching parameters, bit is set if parameter does _not_ match
+typedef std::bitset<DOC8643_MATCH_PARAMS> MatchQualTy;
+
+/// The wanted aircraft's attributes, prepared once for comparing them with many models
+struct CSLMatchInputTy {
+    const std::string& type;            ///< wanted ICAO aircraft type
+    const std::string& airline;         ///< wanted ICAO airline code
+    const std::string& livery;          ///< wanted livery
+    const Doc8643& doc8643;             ///< the Doc8643 definition for the wanted aircraft type
+    const bool bDocEmpty;               ///< no Doc8643 definition?
+    const int related;                  ///< related group, zero if not part of any
+    const std::string wtc;              ///< a string copy makes comparisons easier
+    // All texts of all models are interned, so we compare string handles only.
+    // If a text isn't in the pool then no model can match it (nullptr never equals a handle)
+    const std::string* pType;           ///< interned wanted type
+    const std::string* pAirline;        ///< interned wanted airline
+    const std::string* pLivery;         ///< interned wanted livery
+
+    /// Constructor prepares all attributes
+    CSLMatchInputTy (const std::string& _type,
+                     const std::string& _airline,
+                     const std::string& _livery) :
+    type(_type), airline(_airline), livery(_livery),
+    doc8643(Doc8643Get(_type)), bDocEmpty(doc8643.empty()),
+    related(RelatedGet(_type)), wtc(doc8643.wtc),
+    pType(glob.catCSLModels.FindStr(_type)),
+    pAirline(glob.catCSLModels.FindStr(_airline)),
+    pLivery(glob.catCSLModels.FindStr(_livery))
+    {}
+
+    /// Match quality of one match criteria of a model
+    MatchQualTy Qual (const CSLModel& mdl, const CSLModel::MatchCritTy& mc) const
+    {
+        // Consider each of the following
+        // comparisions to represent a bit in the final quality,
+        // with lowest priority (livery) in the lowest bit and
+        // highest (has rotor) in the highest  (most significant) bit.
+        // Bit is zero if matches, non-zero if not => lowest number is best quality
+        MatchQualTy matchQual;
+        // Lower part matches on very detailed parameters
+        matchQual.set(0, livery.empty()     || &mc.livery.str()         != pLivery);
+        matchQual.set(1, airline.empty()    || &mc.icaoAirline.str()    != pAirline);
+        matchQual.set(2, type.empty()       || &mdl.GetIcaoType()       != pType);
+        matchQual.set(3,                    // this matches if airline _and_ related group match (so we value a matching livery in a "related" model higher than an exact model with improper livery)
+                      airline.empty() || related == 0 ||
+                      &mc.icaoAirline.str() != pAirline || mdl.GetRelatedGrp()  != related);
+        matchQual.set(4, related == 0       || mdl.GetRelatedGrp()  != related);
+        // Upper part matches on generic "size/type of aircraft" parameters,
+        // which are expected to match anyway if the above (like group/ICAO type) match
+        matchQual.set(5, bDocEmpty          || mdl.GetClassEngType()!= doc8643.GetClassEngType());
+        matchQual.set(6, bDocEmpty          || mdl.GetClassNumEng() != doc8643.GetClassNumEng());
+        matchQual.set(7, bDocEmpty          || mdl.GetWTC()         != wtc);
+        matchQual.set(8, bDocEmpty          || mdl.GetClassType()   != doc8643.GetClassType());
+        matchQual.set(9, bDocEmpty          || mdl.HasRotor()       != doc8643.HasRotor());
+        return matchQual;
+    }
+};
+
 /// @brief      Tries finding a match using both aircraft and Doc8643 attributes
 /// @details    Each attribute is represented by a bit in a bit mask.
 ///             Lower priority attributes are represented by low value bits,
 ///             and vice versa high prio match criteria by high value bits.
 ///             The bit is 0 if the attribute matches and 1 if not.
 ///             The resulting numeric value of the bitmask is considered
-///             the match quality: The lower the number the better the quality.
+///             the match quality: The lower the number the better the quality.\n
+///             Among models of the best quality, loaded models can be preferred
+///             (GlobVars::bMatchPreferLoaded).
+///             With progressive matching (GlobVars::bMatchProgressive) the best
+///             loaded model is returned if none of the best quality is loaded,
+///             and the selected best match is returned in `ppUpgrade`.\n
+///             If `pCandidates` is given it receives all models of the best quality,
+///             among which the random choice is made.
 bool CSLFindMatch (const std::string& _type,
                    const std::string& _airline,
                    const std::string& _livery,
                    bool bIgnoreNoMatch,
                    int& quality,
-                   CSLModel* &pModel)
+                   CSLModel* &pModel,
+                   CSLModel** ppUpgrade,
+                   std::vector<CSLModel*>* pCandidates)
 {
-    // How many parameters will we compare?
-    constexpr unsigned DOC8643_MATCH_PARAMS = 10;
-    constexpr unsigned DOC8643_MATCH_WORST_QUAL = 2 << DOC8643_MATCH_PARAMS;
-    
     // if there aren't any models we won't find any either
-    if (glob.mapCSLModels.empty()) {
+    if (glob.catCSLModels.empty()) {
         quality += DOC8643_MATCH_WORST_QUAL;
         return false;
     }
 
-    // The Doc8643 definition for the wanted aircraft type
-    const Doc8643& doc8643 = Doc8643Get(_type);
-    const bool bDocEmpty = doc8643.empty();
-    
-    // The related group depends on the ICAO aircraft type and can be zero
-    // (zero = not part of any related-group)
-    const int related = RelatedGet(_type);
+    // Prepare the wanted attributes, incl. Doc8643 definition and related group
+    const CSLMatchInputTy in (_type, _airline, _livery);
+    const int related = in.related;
     
     LOG_MATCHING(logINFO, DEBUG_MATCH_INPUT,
                  _type.c_str(),
-                 doc8643.wtc, doc8643.classification, related,
+                 in.doc8643.wtc, in.doc8643.classification, related,
                  _airline.c_str(),
                  _livery.c_str());
     
-    // A string copy makes comparisons easier later on
-    const std::string wtc = doc8643.wtc;
-    
     // We can do a full scan of the complete set of all models
     // and save models that match per pass.
     // The folloing multimap stores potential models, with matching pass as the key
     mmapCSLModelPTy mm;
     unsigned long bestMatchYet = DOC8643_MATCH_WORST_QUAL;
+    // For progressive matching we also keep the best models that are loaded already
+    const bool bProgressive = ppUpgrade && glob.bMatchProgressive;
+    mmapCSLModelPTy mmLoaded;
+    unsigned long bestLoadedYet = DOC8643_MATCH_WORST_QUAL;
 
     // Which models to test?
-    mapCSLModelTy::iterator mStart = glob.mapCSLModels.begin();
-    mapCSLModelTy::iterator mEnd   = glob.mapCSLModels.end();
+    CSLCatalogTy::iterator mStart = glob.catCSLModels.begin();
+    CSLCatalogTy::iterator mEnd   = glob.catCSLModels.end();
 
     // However, most matches are done with ICAO aircraft type given,
     // which implies a "related" group.
     // We can narrow down the set of models to scan if we find one with
     // matching "related" group.
     if (related > 0) {
-        std::string key = CSLModelGetKeyStr(related, "", "");
-        mStart = glob.mapCSLModels.lower_bound(key);
-        key = CSLModelGetKeyStr(related, "~~~~", "~~~~");
-        mEnd = glob.mapCSLModels.upper_bound(key);
+        std::tie(mStart, mEnd) = glob.catCSLModels.RangeRelated(related);
         
         // No models found matching the related group?
         if (mStart == mEnd) {
             // well, then search all models
-            mStart = glob.mapCSLModels.begin();
-            mEnd   = glob.mapCSLModels.end();
+            mStart = glob.catCSLModels.begin();
+            mEnd   = glob.catCSLModels.end();
         }
     }
 
     // Now scan all CSL models in the defined range
-    for (mapCSLModelTy::iterator mIter = mStart;
+    for (CSLCatalogTy::iterator mIter = mStart;
          mIter != mEnd;
          ++mIter)
     {
-        CSLModel& mdl = mIter->second;
+        CSLModel& mdl = **mIter;
 
         // Now we calculate match quality for each possible match criteria
         for (const CSLModel::MatchCritTy& mc: mdl.vecMatchCrit)
         {
-            // Consider each of the following
-            // comparisions to represent a bit in the final quality,
-            // with lowest priority (livery) in the lowest bit and
-            // highest (has rotor) in the highest  (most significant) bit.
-            // Bit is zero if matches, non-zero if not => lowest number is best quality
-            std::bitset<DOC8643_MATCH_PARAMS> matchQual;
-            // Lower part matches on very detailed parameters
-            matchQual.set(0, _livery.empty()    || mc.livery         != _livery);
-            matchQual.set(1, _airline.empty()   || mc.icaoAirline    != _airline);
-            matchQual.set(2, _type.empty()      || mdl.GetIcaoType() != _type);
-            matchQual.set(3,                    // this matches if airline _and_ related group match (so we value a matching livery in a "related" model higher than an exact model with improper livery)
-                          _airline.empty() || related == 0 ||
-                          mc.icaoAirline != _airline || mdl.GetRelatedGrp()  != related);
-            matchQual.set(4, related == 0       || mdl.GetRelatedGrp()  != related);
-            // Upper part matches on generic "size/type of aircraft" parameters,
-            // which are expected to match anyway if the above (like group/ICAO type) match
-            matchQual.set(5, bDocEmpty          || mdl.GetClassEngType()!= doc8643.GetClassEngType());
-            matchQual.set(6, bDocEmpty          || mdl.GetClassNumEng() != doc8643.GetClassNumEng());
-            matchQual.set(7, bDocEmpty          || mdl.GetWTC()         != wtc);
-            matchQual.set(8, bDocEmpty          || mdl.GetClassType()   != doc8643.GetClassType());
-            matchQual.set(9, bDocEmpty          || mdl.HasRotor()       != doc8643.HasRotor());
+            const MatchQualTy matchQual = in.Qual(mdl, mc);
             
             // If we are to ignore the doc8643 matches (in case of no doc8643 found)
             // then we completely ignore models which don't match at all
@@ -1256,6 +1952,13 @@ bool CSLFindMatch (const std::string& _type,
                     mm.emplace(bestMatchYet,
                                std::make_pair<CSLModel*,const CSLModel::MatchCritTy*>(&mdl,&mc));
                 }
+                // same for loaded models if doing progressive matching
+                if (bProgressive && mdl.IsReady() &&
+                    matchQual.to_ulong() <= bestLoadedYet) {
+                    bestLoadedYet = matchQual.to_ulong();
+                    mmLoaded.emplace(bestLoadedYet,
+                                     std::make_pair<CSLModel*,const CSLModel::MatchCritTy*>(&mdl,&mc));
+                }
             }
         }
     }
@@ -1274,9 +1977,37 @@ bool CSLFindMatch (const std::string& _type,
     // Of those relevant (having the best possible match quality)
     // we return any more or less randomly chosen model out of that list of possible models
     auto pairIter = mm.equal_range(bestMatchYet);
-    const auto& selected = iterRnd(pairIter.first, pairIter.second)->second;
+    if (pCandidates) {
+        pCandidates->clear();
+        for (auto i = pairIter.first; i != pairIter.second; ++i)
+            pCandidates->push_back(i->second.first);
+    }
+    // If wanted, restrict that choice to models already loaded, if there are any
+    if (glob.bMatchPreferLoaded || bProgressive) {
+        mmapCSLModelPTy mmReady;
+        for (auto i = pairIter.first; i != pairIter.second; ++i)
+            if (i->second.first->IsReady())
+                mmReady.insert(*i);
+        if (!mmReady.empty()) {
+            mm.swap(mmReady);
+            pairIter = mm.equal_range(bestMatchYet);
+        }
+    }
+    auto selected = iterRnd(pairIter.first, pairIter.second)->second;
     pModel = selected.first;
     
+    // Progressive matching: If the best match isn't loaded yet,
+    // then show the best loaded model meanwhile and have the best match loaded
+    if (bProgressive && !pModel->IsReady() && !mmLoaded.empty()) {
+        *ppUpgrade = pModel;
+        auto pairLoaded = mmLoaded.equal_range(bestLoadedYet);
+        selected = iterRnd(pairLoaded.first, pairLoaded.second)->second;
+        pModel = selected.first;
+        quality += int(bestLoadedYet - bestMatchYet);
+        LOG_MATCHING(logINFO, DEBUG_MATCH_UPGRADE,
+                     (*ppUpgrade)->GetModelName().c_str());
+    }
+    
     LOG_MATCHING(logINFO, DEBUG_MATCH_FOUND,
                  pModel->GetIcaoType().c_str(),
                  pModel->GetWTC(),
@@ -1300,17 +2031,21 @@ bool CSLFindMatch (const std::string& _type,
 int CSLModelMatching (const std::string& _type,
                       const std::string& _airline,
                       const std::string& _livery,
-                      CSLModel* &pModel)
+                      CSLModel* &pModel,
+                      CSLModel** ppUpgrade,
+                      std::vector<CSLModel*>* pCandidates)
 {
     // the number of matches applied, ie. the higher the worse
     int quality = 0;
     
     // Let's start...
     pModel = nullptr;
+    if (ppUpgrade)
+        *ppUpgrade = nullptr;
     
     // ...and let's stop right away if there is _absolutely no model_
     // (otherwise we will return one, no matter of how bad the matching quality is)
-    if (glob.mapCSLModels.empty()) {
+    if (glob.catCSLModels.empty()) {
         LOG_MSG(logERR, ERR_MATCH_NO_MODELS);
         return -1;
     }
@@ -1322,7 +2057,7 @@ int CSLModelMatching (const std::string& _type,
         if (CSLFindMatch(type, _airline, _livery,
                          // First pass not using Doc8643 matching?
                          type != glob.defaultICAO && !Doc8643IsTypeValid(type),
-                         quality, pModel))
+                         quality, pModel, ppUpgrade, pCandidates))
             return quality;
         
         // Can we do another loop, now with the default ICAO?
@@ -1338,8 +2073,8 @@ int CSLModelMatching (const std::string& _type,
     // second round.
 
     // ...as a last resort we just use _any random_ model
-    pModel = &(iterRnd(glob.mapCSLModels.begin(),
-                       glob.mapCSLModels.end())->second);
+    pModel = *iterRnd(glob.catCSLModels.begin(),
+                      glob.catCSLModels.end());
     LOG_MATCHING(logWARN, DEBUG_MATCH_NOTFOUND,
                  pModel->GetIcaoType().c_str(),
                  pModel->GetIcaoAirline().c_str(),
@@ -1348,4 +2083,81 @@ int CSLModelMatching (const std::string& _type,
     return quality+1;
 }
 
+// Best match quality the given models alone would achieve
+int CSLModelsMatchQuality (const std::string& _type,
+                           const std::string& _airline,
+                           const std::string& _livery,
+                           const std::vector<CSLModel*>& vecMdl)
+{
+    // Same passes as CSLModelMatching: the given type, occasionally also the default type
+    int quality = 0;
+    for (std::string type = _type.empty() ? glob.defaultICAO : _type;;)
+    {
+        const bool bIgnoreNoMatch = type != glob.defaultICAO && !Doc8643IsTypeValid(type);
+        const CSLMatchInputTy in (type, _airline, _livery);
+        unsigned long bestMatch = DOC8643_MATCH_WORST_QUAL;
+        for (const CSLModel* pMdl: vecMdl)
+            for (const CSLModel::MatchCritTy& mc: pMdl->vecMatchCrit) {
+                const MatchQualTy matchQual = in.Qual(*pMdl, mc);
+                if ((!bIgnoreNoMatch || !matchQual.all()) &&
+                    matchQual.to_ulong() < bestMatch)
+                    bestMatch = matchQual.to_ulong();
+            }
+        if (bestMatch < DOC8643_MATCH_WORST_QUAL)
+            return quality + int(bestMatch) + 1;
+        
+        // Can we do another loop, now with the default ICAO?
+        if (type == glob.defaultICAO)
+            break;
+        quality += DOC8643_MATCH_WORST_QUAL;
+        type = glob.defaultICAO;
+    }
+    return std::numeric_limits<int>::max();
+}
+
+//
+// MARK: Public catalog access
+//
+
+// Number of CSL models in the catalog
+size_t CSLModelsCount ()
+{
+    return glob.catCSLModels.size();
+}
+
+// Information on the `_idx`-th CSL model in constant time
+CSLModelInfo_t CSLModelsGetInfo (size_t _idx)
+{
+    if (_idx >= glob.catCSLModels.size())
+        throw std::out_of_range("CSL model index out of range");
+    return CSLModelInfo_t(glob.catCSLModels[_idx]);
+}
+
+// Returns all CSL models meeting the filter criterion
+std::vector<CSLModelInfo_t> CSLModelsQuery (CSLModelFilterTy _filter,
+                                            const std::string& _value)
+{
+    std::vector<CSLModelInfo_t> ret;
+    if (_filter == CSL_FILTER_RELATED) {
+        // Related group is served by the main index, which is sorted by related group first
+        const int related = RelatedGet(_value);
+        if (related <= 0)
+            return ret;
+        glob.catCSLModels.Sort();
+        auto range = glob.catCSLModels.RangeRelated(related);
+        ret.reserve(size_t(std::distance(range.first, range.second)));
+        for (auto iter = range.first; iter != range.second; ++iter)
+            ret.emplace_back(**iter);
+    } else {
+        // All others have their own index
+        const CSLCatalogTy::vecCSLModelPTy* pVec = glob.catCSLModels.Query(_filter, _value);
+        if (pVec) {
+            ret.reserve(pVec->size());
+            for (const CSLModel* pMdl: *pVec)
+                ret.emplace_back(*pMdl);
+        }
+    }
+    return ret;
+}
+
 }       // namespace XPMP2
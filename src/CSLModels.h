@@ -26,6 +26,55 @@ namespace XPMP2 {
 /// Map of CSLPackages: Maps an id to the base path (path ends on forward slash)
 typedef std::map<std::string,std::string> mapCSLPackageTy;
 
+/// @brief Handle to a string interned in the CSL catalog's string pool
+/// @details Each distinct text (aircraft type, airline, livery, path...) is stored
+///          only once in the pool, every model just keeps this pointer-sized handle.
+///          Two handles are equal if and only if they refer to the same text.
+///          Handles stay valid until the catalog is cleared.
+class CSLStrTy
+{
+protected:
+    const std::string* p;   ///< the interned string
+public:
+    /// Default constructor refers to the empty string
+    CSLStrTy ();
+    /// Constructor for a string already stored in the pool
+    explicit CSLStrTy (const std::string* _p) : p(_p) {}
+
+    const std::string& str () const             { return *p; }
+    operator const std::string& () const        { return *p; }
+    const char* c_str () const                  { return p->c_str(); }
+    bool empty () const                         { return p->empty(); }
+    size_t hash () const                        { return std::hash<const std::string*>()(p); }
+
+    bool operator == (const CSLStrTy& o) const  { return p == o.p; }
+    bool operator != (const CSLStrTy& o) const  { return p != o.p; }
+    /// Compares the texts, not the handles
+    bool operator < (const CSLStrTy& o) const   { return p != o.p && *p < *o.p; }
+};
+
+/// Map of dataRef names to their index in XPMP2::Aircraft::v
+typedef std::unordered_map<std::string,size_t> mapDrIdxTy;
+
+/// A `.obj` file to be scanned in a separate thread, a snapshot taken from XPMP2::CSLObj
+struct ObjScanFileTy {
+    std::string path;                   ///< file to read
+    bool bDoDR = false;                 ///< apply the dataRef replacements the copy operation will do?
+};
+
+/// Axis-aligned bounding box and bounding-sphere radius in the model's local coordinates [m]
+struct CSLBoundsTy {
+    float min[3] = {0.0f, 0.0f, 0.0f};  ///< minimum x, y, z
+    float max[3] = {0.0f, 0.0f, 0.0f};  ///< maximum x, y, z
+    float radius = 0.0f;                ///< radius of a sphere around the model's origin, which encloses all vertices
+    bool  bValid = false;               ///< processed any vertex at all?
+
+    /// Extend by a vertex
+    void Add (float x, float y, float z);
+    /// Extend by another bounding box
+    void Add (const CSLBoundsTy& o);
+};
+
 /// State of the X-Plane object: Is it being loaded or available?
 enum ObjLoadStateTy {
     OLS_INVALID = -1,       ///< loading once failed -> invalid!
@@ -35,15 +84,24 @@ enum ObjLoadStateTy {
     OLS_AVAILABLE,          ///< X-Plane object available in `xpObj`
 };
 
+/// State of a CSL model's loading sequence (copy, scan, async load of all its objects)
+enum MdlLoadStateTy {
+    MLS_UNLOADED = 0,       ///< Nothing requested (or unloaded again by garbage collection)
+    MLS_COPYING,            ///< at least one `.obj` file still waits for its copy
+    MLS_LOADING,            ///< scan of `.obj` files and/or async object load underway
+    MLS_READY,              ///< all objects available, scan results applied
+    MLS_FAILED,             ///< loading failed, model is retired
+};
+
 /// One `.obj` file of a CSL model (of which it can have multiple)
 class CSLObj
 {
 public:
-    std::string cslId;      ///< id of the CSL model this belongs to
-    std::string path;       ///< full path to the (potentially copied) `.obj` file
-    std::string pathOrig;   ///< full path to the original `.obj` file IF there is the need to create a copy upon load
-    std::string texture;    ///< texture file if defined, to be used in the TEXTURE line of the .obj file
-    std::string text_lit;   ///< texture_lit file if defined, to be used in the TEXTURE_LIT line of the .obj file
+    CSLStrTy cslId;         ///< id of the CSL model this belongs to
+    CSLStrTy path;          ///< full path to the (potentially copied) `.obj` file
+    CSLStrTy pathOrig;      ///< full path to the original `.obj` file IF there is the need to create a copy upon load
+    CSLStrTy texture;       ///< texture file if defined, to be used in the TEXTURE line of the .obj file
+    CSLStrTy text_lit;      ///< texture_lit file if defined, to be used in the TEXTURE_LIT line of the .obj file
 
 protected:
     /// The X-Plane object reference to the loaded model as requested with XPLMLoadObjectAsync
@@ -53,8 +111,8 @@ protected:
 
 public:
     /// Constructor doesn't do much
-    CSLObj (const std::string& _id,
-            const std::string& _path) : cslId(_id), path(_path) {}
+    CSLObj (CSLStrTy _id,
+            CSLStrTy _path) : cslId(_id), path(_path) {}
     /// Generate standard move constructor
     CSLObj (CSLObj&& o) = default;
     CSLObj& operator = (CSLObj&& o) = default;
@@ -69,12 +127,25 @@ public:
     /// Determine which file to load and if we need a copied .obj file
     void DetermineWhichObjToLoad ();
 
-    /// Read the obj file to calculate its vertical offset
-    float FetchVertOfsFromObjFile () const;
+    /// Which file to scan, and does the scan need to apply the dataRef replacements of the copy?
+    ObjScanFileTy GetScanFile () const;
+    /// @brief Read an obj file to calculate its vertical offset and bounds, and to find the dataRefs it uses
+    /// @details Static and working on a copy of the path only, as it runs in a separate thread
+    ///          while the main thread might update the object
+    /// @param file The file to read, see GetScanFile()
+    /// @param mapDr Known dataRefs and their index
+    /// @param[in,out] vecUsed Flag per known dataRef, set if used by this object
+    /// @param[out] bounds Bounding box and radius of this object
+    /// @param[out] vertOfs Vertical offset
+    /// @return Could the file be read as an OBJ8 file? If not, `vecUsed` is incomplete
+    static bool ScanObjFile (const ObjScanFileTy& file,
+                             const mapDrIdxTy& mapDr,
+                             std::vector<bool>& vecUsed,
+                             CSLBoundsTy& bounds,
+                             float& vertOfs);
     
-    /// @brief Load and return the underlying X-Plane objects.
-    /// @note Can return NULL while async load is underway!
-    XPLMObjectRef GetAndLoadObj ();
+    /// The underlying X-Plane object, NULL unless loaded
+    XPLMObjectRef GetObjRef () const            { return xpObj; }
     /// Starts loading the XP object
     void Load ();
     /// Free up the object
@@ -82,6 +153,9 @@ public:
     
     /// Will this object require copying the `.obj` file upon load?
     bool NeedsObjCopy () const { return !pathOrig.empty(); }
+    /// @brief If the copy thread is currently working for this object, wait for it and take over the result
+    /// @details Needed before the object is destroyed, as the thread refers to it
+    void WaitForCopy ();
 
 protected:
     
@@ -103,8 +177,8 @@ protected:
     void Invalidate ();
 };
 
-/// List of objects
-typedef std::list<CSLObj> listCSLObjTy;
+/// List of objects (a vector, as it is only filled while reading `xsb_aircraft.txt`)
+typedef std::vector<CSLObj> listCSLObjTy;
 
 typedef std::pair<std::string,std::string> pairOfStrTy;
 
@@ -115,9 +189,9 @@ public:
     /// Combines match-relevant fields (beside ICAO a/c type)
     struct MatchCritTy {
         /// ICAO Airline code this model represents: `xsb_aircraft.txt::AIRLINE`
-        std::string         icaoAirline;
+        CSLStrTy            icaoAirline;
         /// Livery code this model represents: `xsb_aircraft.txt::LIVERY`
-        std::string         livery;
+        CSLStrTy            livery;
         
         /// @brief Decide which criteria is better and keep that
         /// @return Did we cover o in some way? (false: needs to be treated separately)
@@ -126,12 +200,10 @@ public:
     /// Vector of match-relevant fields
     typedef std::vector<MatchCritTy> MatchCritVecTy;
 public:
-    /// short id, just an arbitrary label read from `xsb_aircraft.txt::OBJ8_AIRCRAFT`
-    std::string         shortId;
-    /// full id: package name / shortId, expected to be unique
-    std::string         cslId;
-    /// name, formed by last part of path plus id
-    std::string         modelName;
+    /// full id: package name / short id (as read from `xsb_aircraft.txt::OBJ8_AIRCRAFT`), expected to be unique
+    CSLStrTy            cslId;
+    /// name, formed by last part of path plus short id
+    CSLStrTy            modelName;
     /// further match-relevant fields like airline and livery can be a list
     MatchCritVecTy      vecMatchCrit;
     /// list of objects representing this model
@@ -142,13 +214,13 @@ public:
     bool                bVertOfsReadFromFile = true;
     
     /// Path to the xsb_aircraft.txt file from where this model is loaded
-    std::string         xsbAircraftPath;
+    CSLStrTy            xsbAircraftPath;
     /// Line number in the xsb_aircraft.txt file where the model definition starts
     int                 xsbAircraftLn = 0;
 
 protected:
     /// ICAO aircraft type this model represents: `xsb_aircraft.txt::ICAO`
-    std::string         icaoType;
+    CSLStrTy            icaoType;
     /// Proper Doc8643 entry for this model
     const Doc8643*      doc8643 = nullptr;
     /// "related" group for this model (a group of alike plane models), or 0
@@ -157,10 +229,31 @@ protected:
     unsigned            refCnt = 0;
     /// Time point when refCnt reached 0 (used in garbage collection, in terms of XP's total running time)
     float               refZeroTs = 0.0f;
-    /// future for asynchronously reading vertOfs
-    std::future<float>  futVertOfs;
+    /// Result of scanning the `.obj` files
+    struct ObjScanTy {
+        float vertOfs = 0.0f;           ///< vertical offset as read from the files
+        CSLBoundsTy bounds;             ///< bounds of all files combined
+        std::vector<bool> vecUsed;      ///< per known dataRef: is it used by any of the files?
+    };
+    /// Bounding box and radius, valid once the `.obj` files are scanned
+    CSLBoundsTy         bounds;
+    /// Has the scan of the `.obj` files been started?
+    bool                bObjScanStarted = false;
+    /// future for asynchronously scanning the `.obj` files for vertOfs and dataRefs
+    std::future<ObjScanTy> futObjScan;
+    /// Number of dataRefs known when the `.obj` files were scanned, 0 if not yet scanned
+    size_t              nDrKnown = 0;
+    /// dataRef subset actually used by the model, `nullptr`-terminated, passed to `XPLMCreateInstance`
+    std::vector<const char*> vecDrNames;
+    /// Gather index: for each entry in `vecDrNames` the index into XPMP2::Aircraft::v
+    std::vector<uint16_t> vecDrIdx;
+    /// State of the loading sequence of the model as a whole
+    MdlLoadStateTy      mdlLoadState = MLS_UNLOADED;
+    /// Aircraft waiting for the model to become ready, notified once loading ends
+    std::vector<XPMPPlaneID> vecWaitingAc;
     
 public:
+    friend class CSLCatalogTy;
     /// Constructor
     CSLModel () {}
     /// Generate standard move constructor
@@ -178,8 +271,8 @@ public:
     void AddMatchCriteria (const std::string& _type,
                            const MatchCritTy& _matchCrit,
                            int lnNr);
-    /// Puts together the model name string from a path component and `shortId`
-    void CompModelName ();
+    /// Puts together the model name string from a path component and the short id
+    void CompModelName (const std::string& shortId);
     
     /// Minimum requirement for using this object is: id, type, path
     bool IsValid () const { return !cslId.empty() && !icaoType.empty() && !listObj.empty(); }
@@ -202,16 +295,53 @@ public:
 
     /// Vertical Offset to be applied to aircraft model
     float GetVertOfs () const                   { return vertOfs; }
+    /// Bounding box and radius as read from the `.obj` files, check CSLBoundsTy::bValid before use
+    const CSLBoundsTy& GetBounds () const       { return bounds; }
         
     /// (Minimum) )State of the X-Plane objects: Is it being loaded or available?
     ObjLoadStateTy GetObjState () const;
     /// (Minimum) )State of the X-Plane object: Is it invalid?
     bool IsObjInvalid () const                  { return GetObjState() == OLS_INVALID; }
     
-    /// @brief Try get ALL object handles, only returns anything if it is the complete list
-    /// @details This starts async loading of all objects.
-    std::list<XPLMObjectRef> GetAllObjRefs ();
+    /// State of the loading sequence of the model as a whole
+    MdlLoadStateTy GetLoadState () const        { return mdlLoadState; }
+    /// Are all objects loaded and is the scan of the `.obj` files applied?
+    bool IsReady () const                       { return mdlLoadState == MLS_READY; }
+    
+    /// @brief Request the model to be loaded
+    /// @details Starts the loading sequence if not yet underway.
+    ///          If not yet ready, the aircraft is registered and notified once loading ends.
+    /// @param _acId Aircraft waiting for the model
+    /// @return Is the model ready, ie. can instances be created right away?
+    bool RequestLoad (XPMPPlaneID _acId);
+    /// @brief Advance the loading sequence: copy, scan, async load
+    /// @details Called once per frame for models being loaded, and when an object finished loading.
+    ///          Notifies waiting aircraft when complete.
+    void AdvanceLoad ();
     
+    /// @brief Is the dataRef subset available and still up to date?
+    /// @details Not anymore if more dataRefs have been added since the `.obj` files were scanned
+    bool HasDrSubset () const;
+    /// `nullptr`-terminated list of dataRefs used by the model, only valid if HasDrSubset()
+    const char** GetDrNames ()                  { return vecDrNames.data(); }
+    /// Gather index into XPMP2::Aircraft::v, only valid if HasDrSubset()
+    const std::vector<uint16_t>& GetDrIdx () const { return vecDrIdx; }
+    
+    /// @brief Takes the model out of service after its objects failed to load
+    /// @details Aircraft using it are re-matched, objects are freed
+    ///          after background tasks referring to them have finished.
+    ///          The model object itself stays in the catalog's storage
+    ///          until the garbage collection reclaims it, see CSLCatalogTy::Reclaim().
+    void Retire ();
+    
+    /// @brief Can the storage of this retired model be reused?
+    /// @details Only if no aircraft uses, waits for, or refers to it, and no background task is pending
+    bool IsReclaimable () const;
+    
+    /// @brief Is this model defined exactly like the other one?
+    /// @details Compares what is read from `xsb_aircraft.txt`: type, id, objects, textures, match criteria, vertical offset
+    bool SameDefinition (const CSLModel& o) const;
+
     /// Increase the reference counter for Aircraft usage
     void IncRefCnt () { ++refCnt; }
     /// Decrease the reference counter for Aircraft usage
@@ -228,12 +358,112 @@ public:
 protected:
     /// Unload all objects
     void Unload ();
-    /// Read the obj files to fill CSLModel::vertOfs
-    float FetchVertOfsFromObjFile () const;
+    /// Scan the obj files for CSLModel::vertOfs and the dataRefs used
+    static ObjScanTy ScanObjFiles (std::vector<ObjScanFileTy> vecFiles, mapDrIdxTy mapDr);
+    /// Take over the result of scanning the `.obj` files
+    void ApplyObjScan (ObjScanTy&& scan);
+    /// Inform all waiting aircraft that loading has ended
+    void NotifyWaitingAc ();
 };
 
-/// Map of CSLModels (owning the object), ordered by related group / type
-typedef std::map<std::string,CSLModel> mapCSLModelTy;
+/// @brief The catalog of all CSL models
+/// @details The models themselves are stored in a deque, ie. in large contiguous blocks,
+///          and never move once added. The storage of retired models is reused for new ones. All texts are interned in a string pool.
+///          Iteration and random access go via an index of valid models,
+///          sorted by related group, aircraft type, and model id.
+class CSLCatalogTy
+{
+public:
+    /// Index of models, sorted by related group, type, and id
+    typedef std::vector<CSLModel*> vecCSLModelPTy;
+    typedef vecCSLModelPTy::iterator iterator;
+    typedef vecCSLModelPTy::const_iterator const_iterator;
+
+protected:
+    /// Hash function of a string handle
+    struct CSLStrHash {
+        size_t operator() (const CSLStrTy& s) const { return s.hash(); }
+    };
+    /// Hash function of the unique key of a model: aircraft type and id
+    struct CSLKeyHash {
+        size_t operator() (const std::pair<CSLStrTy,CSLStrTy>& k) const
+        { return k.first.hash() ^ (k.second.hash() << 1); }
+    };
+
+    /// String pool, each distinct text is stored exactly once
+    std::unordered_set<std::string> setStr;
+    /// Storage of all model objects ever added (including retired ones)
+    std::deque<CSLModel> dqMdl;
+    /// Sorted index of all valid models
+    vecCSLModelPTy vecIdx;
+    /// Is `vecIdx` sorted?
+    bool bSorted = true;
+    /// Unique key (aircraft type, model id) of each valid model
+    std::unordered_map<std::pair<CSLStrTy,CSLStrTy>,CSLModel*,CSLKeyHash> mapKey;
+
+    /// Type of an index from a text to all models having that text
+    typedef std::unordered_map<CSLStrTy,vecCSLModelPTy,CSLStrHash> mapStrIdxTy;
+    mapStrIdxTy mapIdxType;         ///< Index by ICAO aircraft type
+    mapStrIdxTy mapIdxAirline;      ///< Index by ICAO airline code
+    mapStrIdxTy mapIdxPkg;          ///< Index by package name
+    /// Are the above indexes outdated?
+    bool bIdxDirty = false;
+    /// Models added since TakeAdded() was last called
+    vecCSLModelPTy vecAdded;
+    /// Retired models, whose storage is reused once nothing refers to them any longer
+    vecCSLModelPTy vecRetired;
+    /// Storage of reclaimed models, available for new models
+    vecCSLModelPTy vecFree;
+
+public:
+    /// @brief Intern a string, ie. return the pool's handle, adding the text if it is new
+    /// @note Not thread-safe, to be called from the main thread only
+    CSLStrTy Intern (const std::string& s);
+    /// @brief Find an already interned string
+    /// @return Pool's handle, or `nullptr` if the text is unknown (then no model can refer to it)
+    const std::string* FindStr (const std::string& s) const;
+    /// Number of distinct strings in the pool
+    size_t NumStr () const                      { return setStr.size(); }
+
+    /// @brief Adds a model, taking over its content
+    /// @return `nullptr` if added, otherwise the existing model with the same key
+    CSLModel* Add (CSLModel&& mdl);
+    /// Removes a model from the index, the object stays in storage
+    void Remove (const CSLModel* pMdl);
+    /// Remember a retired model, so that its storage can be reclaimed later
+    void AddRetired (CSLModel* pMdl);
+    /// @brief Makes the storage of retired models, which nothing refers to any longer, available for new models
+    /// @return Number of models reclaimed
+    size_t Reclaim ();
+    /// Hands out the models added since the last call, which then starts a new list
+    vecCSLModelPTy TakeAdded ()                 { vecCSLModelPTy v; v.swap(vecAdded); return v; }
+    /// (Re)Sort the index and rebuild the attribute indexes after models have been added or removed
+    void Sort ();
+    /// Find a model by its unique key (aircraft type and id)
+    CSLModel* Find (const std::string& _type, const std::string& _id) const;
+    /// @brief All models with the given type, airline, or package, sorted like the main index
+    /// @note CSL_FILTER_RELATED is served by RangeRelated()
+    /// @return `nullptr` if there are none
+    const vecCSLModelPTy* Query (CSLModelFilterTy _filter, const std::string& _value);
+
+    /// Removes all models and strings
+    void clear ();
+
+    // index access
+    size_t size () const                        { return vecIdx.size(); }
+    bool empty () const                         { return vecIdx.empty(); }
+    CSLModel& operator[] (size_t i) const       { return *vecIdx[i]; }
+    iterator begin ()                           { return vecIdx.begin(); }
+    iterator end ()                             { return vecIdx.end(); }
+    const_iterator begin () const               { return vecIdx.cbegin(); }
+    const_iterator end () const                 { return vecIdx.cend(); }
+    /// Range of models in the given related group
+    std::pair<iterator,iterator> RangeRelated (int _related);
+
+protected:
+    /// Rebuild the attribute indexes from the main index
+    void UpdateIdx ();
+};
 
 /// Multimap of references to CSLModels and match criteria for matching purposes
 typedef std::multimap<unsigned long,std::pair<CSLModel*,const CSLModel::MatchCritTy*> > mmapCSLModelPTy;
@@ -255,23 +485,66 @@ void CSLModelsCleanup ();
 const char* CSLModelsLoad (const std::string& _path,
                            int _maxDepth = 5);
 
+/// @brief Recursively scans folders to find `xsb_aircraft.txt` files of CSL packages
+/// @param _path The path to start the search in
+/// @param[out] paths List of paths in which an xsb_aircraft.txt file has actually been found
+/// @param _maxDepth How deep into the folder hierarchy shall we search? (defaults to 5)
+/// @param[out] pDirs (optional) Receives all searched folders, which are not packages themselves
+const char* CSLModelsFindPkgs (const std::string& _path,
+                               std::vector<std::string>& paths,
+                               int _maxDepth = 5,
+                               std::vector<std::string>* pDirs = nullptr);
+
+/// @brief Re-read one package and update the catalog with what has changed
+/// @details New models are added, changed models are replaced, removed models are taken out of service.
+///          Unchanged models stay as they are, including their loaded objects.
+///          Only aircraft using a replaced or removed model are re-matched.
+///          If the package isn't known yet it is simply loaded.
+/// @param path Folder of the package, ie. the one containing the `xsb_aircraft.txt` file
+/// @return An empty string on success, otherwise a human-readable error message
+const char* CSLModelsReloadPkg (const std::string& path);
+
+/// Adds a readily defined CSL model to all the necessary maps, resets passed-in reference
+void CSLModelsAdd (CSLModel& _csl);
+
+/// @brief Advance the loading sequence of all models currently being loaded
+/// @details Called once per frame from the aircraft flight loop,
+///          notifies waiting aircraft of models that are ready
+void CSLModelsProcessLoads ();
+
 /// @brief Find a model by name
 /// @param _mdlName The model's name (aka id) to search for
-/// @param[out] _pOutIter Optional pointer to an iterator variable, receiving the iterator position of the found model
-CSLModel* CSLModelByName (const std::string& _mdlName,
-                          mapCSLModelTy::iterator* _pOutIter = nullptr);
+CSLModel* CSLModelByName (const std::string& _mdlName);
+
+/// Find a model by the key string as returned by CSLModel::GetKeyString()
+CSLModel* CSLModelByKey (const std::string& _key);
 
 /// @brief Find a matching model
 /// @param _type ICAO aircraft type like "A319"
 /// @param _airline ICAO airline code like "DLH"
 /// @param _livery Any specific livery code, in LiveTraffic e.g. the tail number
 /// @param[out] pModel Receives the pointer to the matching CSL model, or NULL if nothing found
+/// @param[out] ppUpgrade (optional) With progressive matching configured, receives the best match
+///             if that is not yet loaded and `pModel` is a loaded lesser match to be shown meanwhile, otherwise NULL
+/// @param[out] pCandidates (optional) Receives all models of the best match quality, among which `pModel` was chosen
 /// @return The number of passes needed to find a match, the lower the better the quality,
 ///         negative is error.
 int CSLModelMatching (const std::string& _type,
                       const std::string& _airline,
                       const std::string& _livery,
-                      CSLModel* &pModel);
+                      CSLModel* &pModel,
+                      CSLModel** ppUpgrade = nullptr,
+                      std::vector<CSLModel*>* pCandidates = nullptr);
+
+/// @brief Best match quality the given models alone would achieve, without actually selecting one
+/// @details Follows the same rules as CSLModelMatching(), so that the result can be compared
+///          to Aircraft::GetMatchQuality(). Serves deciding if models added to the catalog
+///          can improve an existing match.
+/// @return The best quality, `std::numeric_limits<int>::max()` if none of the models matches
+int CSLModelsMatchQuality (const std::string& _type,
+                           const std::string& _airline,
+                           const std::string& _livery,
+                           const std::vector<CSLModel*>& vecMdl);
 
 }       // namespace XPMP2
 
@@ -0,0 +1,397 @@
+/// @file       CSLWatch.cpp
+/// @brief      Watches loaded CSL folders and reloads changed packages while running
+/// @details    Active only if config item `models/watch_csl` is set.\n
+///             Each package folder's `xsb_aircraft.txt` is watched for changes,
+///             each loaded CSL folder and its direct subfolders for new or removed packages.
+///             On Linux, `inotify` reports changes, elsewhere (or if `inotify` is not available)
+///             the modification times are polled.\n
+///             A changed package is reloaded only after changes have settled,
+///             so that an editor's save or a copy in progress is not read half-way.
+///             Reloading only touches models of that package, see CSLModelsReloadPkg().
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#include "XPMP2.h"
+
+#if LIN
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+#define DEBUG_WATCH_START       "Watching %lu CSL packages in %lu folders for changes %s"
+#define DEBUG_WATCH_STOP        "Stopped watching CSL folders"
+#define WARN_WATCH_INOTIFY      "inotify not available (%s), polling CSL folders instead"
+#define INFO_WATCH_PKG_CHANGED  "CSL package changed: %s"
+#define INFO_WATCH_PKG_NEW      "CSL package added: %s"
+
+namespace XPMP2 {
+
+/// How often to check for changes [s]
+constexpr float WATCH_PERIOD = 2.0f;
+/// How long must a package be unchanged before it is reloaded [s]
+constexpr float WATCH_SETTLE = 1.5f;
+
+/// A watched package folder
+struct WatchPkgTy {
+    time_t      mtime = 0;          ///< last known modification time of `xsb_aircraft.txt`, `0` if missing
+    float       tsChanged = NAN;    ///< when a change was last seen, `NAN` if no change pending
+};
+
+/// A watched CSL folder as passed to CSLModelsLoad()
+struct WatchRootTy {
+    std::string path;               ///< the folder
+    int         maxDepth = 5;       ///< search depth for packages
+    std::map<std::string,time_t> mapDirTime;    ///< modification times of the folder and its direct subfolders
+    float       tsChanged = NAN;    ///< when a change was last seen, `NAN` if no change pending
+};
+
+/// Flight loop that checks for changes, only exists while watching
+static XPLMFlightLoopID gWatchFlightLoopID = nullptr;
+/// Are we currently watching? (Follows `glob.bWatchCSL`)
+static bool gbWatching = false;
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wexit-time-destructors"
+#pragma clang diagnostic ignored "-Wglobal-constructors"
+/// All watched packages, key is the package folder
+static std::map<std::string,WatchPkgTy> gMapWatchPkg;
+/// All watched CSL folders
+static std::vector<WatchRootTy> gVecWatchRoot;
+#if LIN
+/// inotify watch descriptors and the folder they watch
+static std::map<int,std::string> gMapWatchWd;
+#endif
+#pragma clang diagnostic pop
+
+#if LIN
+/// inotify file descriptor, `-1` if not used
+static int gInotifyFd = -1;
+#endif
+
+//
+// MARK: Helpers
+//
+
+/// Path of a package's `xsb_aircraft.txt` file
+static std::string WatchAcTxt (const std::string& pkgPath)
+{
+    return TOPOSIX(pkgPath + XPLMGetDirectorySeparator()[0] + "xsb_aircraft.txt");
+}
+
+/// Determine modification times of a CSL folder and its direct subfolders
+static void WatchReadDirTimes (WatchRootTy& root)
+{
+    root.mapDirTime.clear();
+    root.mapDirTime[root.path] = GetFileModTime(TOPOSIX(root.path));
+    if (root.maxDepth <= 0)
+        return;
+    for (const std::string& f: GetDirContents(root.path)) {
+        const std::string sub (root.path + XPLMGetDirectorySeparator()[0] + f);
+        if (IsDir(TOPOSIX(sub)))
+            root.mapDirTime[sub] = GetFileModTime(TOPOSIX(sub));
+    }
+}
+
+/// Is the folder one of the watched packages?
+static bool WatchIsPkg (const std::string& path)
+{
+    return gMapWatchPkg.count(path) > 0;
+}
+
+#if LIN
+/// Add an inotify watch for a folder, if inotify is in use
+static void WatchInotifyAdd (const std::string& path, bool bPkg)
+{
+    if (gInotifyFd < 0)
+        return;
+    const uint32_t mask = bPkg ?
+    // packages: changes to files (filtered for `xsb_aircraft.txt` later) and removal of the folder itself
+    IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF :
+    // CSL folders: folders being added or removed
+    IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM | IN_ONLYDIR;
+    const int wd = inotify_add_watch(gInotifyFd, TOPOSIX(path).c_str(), mask);
+    if (wd >= 0)
+        gMapWatchWd[wd] = path;
+}
+
+/// Read all pending inotify events and mark affected packages and folders as changed
+static void WatchInotifyRead (float now)
+{
+    alignas(inotify_event) char buf[4096];
+    for (;;) {
+        const ssize_t len = read(gInotifyFd, buf, sizeof(buf));
+        if (len <= 0)                   // EAGAIN: nothing more to read
+            break;
+        for (ssize_t i = 0; i < len; ) {
+            const inotify_event* ev = reinterpret_cast<const inotify_event*>(buf + i);
+            i += ssize_t(sizeof(inotify_event) + ev->len);
+            
+            auto iterWd = gMapWatchWd.find(ev->wd);
+            if (iterWd == gMapWatchWd.end())
+                continue;
+            const std::string path = iterWd->second;
+            if (ev->mask & IN_IGNORED)  // watch is gone, e.g. because the folder was removed
+                gMapWatchWd.erase(iterWd);
+            
+            auto iterPkg = gMapWatchPkg.find(path);
+            if (iterPkg != gMapWatchPkg.end()) {
+                // Package: only interested in `xsb_aircraft.txt` or the folder itself
+                if ((ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) ||
+                    (ev->len > 0 && !strcmp(ev->name, "xsb_aircraft.txt")))
+                    iterPkg->second.tsChanged = now;
+            }
+            else if (ev->mask & IN_ISDIR) {
+                // CSL folder or one of its subfolders: a folder came or went
+                for (WatchRootTy& root: gVecWatchRoot)
+                    if (root.mapDirTime.count(path))
+                        root.tsChanged = now;
+            }
+        }
+    }
+}
+#endif
+
+/// Poll modification times and mark affected packages and folders as changed
+static void WatchPoll (float now)
+{
+    for (auto& p: gMapWatchPkg) {
+        const time_t t = GetFileModTime(WatchAcTxt(p.first));
+        if (t != p.second.mtime) {
+            p.second.mtime = t;
+            p.second.tsChanged = now;
+        }
+    }
+    for (WatchRootTy& root: gVecWatchRoot) {
+        for (const auto& d: root.mapDirTime) {
+            if (GetFileModTime(TOPOSIX(d.first)) != d.second) {
+                root.tsChanged = now;
+                break;
+            }
+        }
+    }
+}
+
+/// Start watching a package: determine its modification time, add an inotify watch
+static void WatchPkgStart (const std::string& pkgPath, WatchPkgTy& pkg)
+{
+    pkg.mtime = GetFileModTime(WatchAcTxt(pkgPath));
+    pkg.tsChanged = NAN;
+#if LIN
+    WatchInotifyAdd(pkgPath, true);
+#endif
+}
+
+/// Start watching a CSL folder: determine modification times of its folders, add inotify watches
+static void WatchRootStart (WatchRootTy& root)
+{
+    root.tsChanged = NAN;
+    WatchReadDirTimes(root);
+#if LIN
+    for (const auto& d: root.mapDirTime)
+        if (!WatchIsPkg(d.first))
+            WatchInotifyAdd(d.first, false);
+#endif
+}
+
+/// Add a package to the watch list, start watching it if we are watching
+static void WatchPkgAdd (const std::string& pkgPath)
+{
+    WatchPkgTy& pkg = gMapWatchPkg[pkgPath];
+    if (gbWatching)
+        WatchPkgStart(pkgPath, pkg);
+}
+
+/// Start watching: set up inotify (if available), determine modification times of all watched folders
+static void WatchStart ()
+{
+#if LIN
+    gInotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (gInotifyFd < 0) {
+        LOG_MSG(logWARN, WARN_WATCH_INOTIFY, std::strerror(errno));
+    }
+#endif
+    for (auto& p: gMapWatchPkg)
+        WatchPkgStart(p.first, p.second);
+    for (WatchRootTy& root: gVecWatchRoot)
+        WatchRootStart(root);
+#if LIN
+    LOG_MSG(logDEBUG, DEBUG_WATCH_START,
+            (unsigned long)gMapWatchPkg.size(), (unsigned long)gVecWatchRoot.size(),
+            gInotifyFd >= 0 ? "via inotify" : "by polling");
+#else
+    LOG_MSG(logDEBUG, DEBUG_WATCH_START,
+            (unsigned long)gMapWatchPkg.size(), (unsigned long)gVecWatchRoot.size(),
+            "by polling");
+#endif
+    gbWatching = true;
+}
+
+/// Stop watching
+static void WatchStop ()
+{
+#if LIN
+    if (gInotifyFd >= 0) {
+        close(gInotifyFd);              // also removes all watches
+        gInotifyFd = -1;
+    }
+    gMapWatchWd.clear();
+#endif
+    if (gbWatching)
+        LOG_MSG(logDEBUG, DEBUG_WATCH_STOP);
+    gbWatching = false;
+}
+
+/// Look for new packages in a CSL folder and load them
+static void WatchRescanRoot (WatchRootTy& root)
+{
+    std::vector<std::string> paths;
+    DirCacheBegin();
+    CSLModelsFindPkgs(root.path, paths, root.maxDepth);
+    DirCacheEnd();
+    for (const std::string& p: paths) {
+        if (WatchIsPkg(p))              // known packages are watched individually
+            continue;
+        LOG_MSG(logINFO, INFO_WATCH_PKG_NEW, StripXPSysDir(p).c_str());
+        CSLModelsReloadPkg(p);
+        WatchPkgAdd(p);
+    }
+    
+    // New subfolders are to be watched, too
+    WatchRootStart(root);
+}
+
+/// Flight loop callback: checks for changes and reloads what has changed and settled
+static float WatchFlightLoopCB (float, float, int, void*)
+{
+    UPDATE_CYCLE_NUM;               // DEBUG only: Store current cycle number in glob.xpCycleNum
+    
+    // (WatchUpdate() removes this flight loop when watching is switched off)
+    if (!gbWatching)
+        return 0.0f;
+    
+    // Collect changes
+    const float now = GetMiscNetwTime();
+#if LIN
+    if (gInotifyFd >= 0)
+        WatchInotifyRead(now);
+    else
+#endif
+        WatchPoll(now);
+    
+    // Reload packages, which have settled
+    for (auto iter = gMapWatchPkg.begin(); iter != gMapWatchPkg.end();) {
+        WatchPkgTy& pkg = iter->second;
+        if (std::isnan(pkg.tsChanged) || now - pkg.tsChanged < WATCH_SETTLE) {
+            ++iter;
+            continue;
+        }
+        pkg.tsChanged = NAN;
+        pkg.mtime = GetFileModTime(WatchAcTxt(iter->first));
+        LOG_MSG(logINFO, INFO_WATCH_PKG_CHANGED, StripXPSysDir(iter->first).c_str());
+        CSLModelsReloadPkg(iter->first);
+        // Package is gone? Then stop watching it, a rescan of its CSL folder would find it again
+        if (!pkg.mtime)
+            iter = gMapWatchPkg.erase(iter);
+        else {
+#if LIN
+            WatchInotifyAdd(iter->first, true);     // might have been removed and re-created
+#endif
+            ++iter;
+        }
+    }
+    
+    // Rescan CSL folders, which have settled
+    for (WatchRootTy& root: gVecWatchRoot) {
+        if (std::isnan(root.tsChanged) || now - root.tsChanged < WATCH_SETTLE)
+            continue;
+        root.tsChanged = NAN;
+        WatchRescanRoot(root);
+    }
+    
+    return WATCH_PERIOD;
+}
+
+//
+// MARK: Global Functions
+//
+
+// Remember a loaded CSL folder and its packages for watching
+void WatchAddRoot (const std::string& _path, int _maxDepth,
+                   const std::vector<std::string>& paths)
+{
+    // Remember the folder
+    auto iter = std::find_if(gVecWatchRoot.begin(), gVecWatchRoot.end(),
+                             [&_path](const WatchRootTy& r){ return r.path == _path; });
+    if (iter == gVecWatchRoot.end()) {
+        gVecWatchRoot.emplace_back();
+        iter = std::prev(gVecWatchRoot.end());
+        iter->path = _path;
+    }
+    iter->maxDepth = _maxDepth;
+    
+    // Remember all its packages
+    for (const std::string& p: paths)
+        WatchPkgAdd(p);
+    
+    // Already watching? Then include the folder right away, otherwise start watching if configured
+    if (gbWatching)
+        WatchRootStart(*iter);
+    else
+        WatchUpdate();
+}
+
+// Start or stop watching according to `glob.bWatchCSL`
+void WatchUpdate ()
+{
+    if (glob.bWatchCSL && !gVecWatchRoot.empty()) {
+        if (gbWatching)
+            return;
+        WatchStart();
+        XPLMCreateFlightLoop_t cfl = {
+            sizeof(XPLMCreateFlightLoop_t),                 // size
+            xplm_FlightLoop_Phase_AfterFlightModel,         // phase
+            WatchFlightLoopCB,                              // callback function
+            nullptr                                         // refcon
+        };
+        gWatchFlightLoopID = XPLMCreateFlightLoop(&cfl);
+        XPLMScheduleFlightLoop(gWatchFlightLoopID, WATCH_PERIOD, 1);
+    }
+    else if (gbWatching) {
+        if (gWatchFlightLoopID) {
+            XPLMDestroyFlightLoop(gWatchFlightLoopID);
+            gWatchFlightLoopID = nullptr;
+        }
+        WatchStop();
+    }
+}
+
+// Grace cleanup, stops watching
+void WatchCleanup ()
+{
+    if (gWatchFlightLoopID) {
+        XPLMDestroyFlightLoop(gWatchFlightLoopID);
+        gWatchFlightLoopID = nullptr;
+    }
+    WatchStop();
+    gMapWatchPkg.clear();
+    gVecWatchRoot.clear();
+}
+
+}       // namespace XPMP2
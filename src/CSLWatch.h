@@ -0,0 +1,44 @@
+/// @file       CSLWatch.h
+/// @brief      Watches loaded CSL folders and reloads changed packages while running
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#ifndef _CSLWatch_h_
+#define _CSLWatch_h_
+
+namespace XPMP2 {
+
+/// @brief Remember a loaded CSL folder and its packages for watching
+/// @details Only records the paths. Modification times are determined
+///          once watching starts, see WatchUpdate().
+/// @param _path The folder as passed to CSLModelsLoad()
+/// @param _maxDepth Search depth as passed to CSLModelsLoad()
+/// @param paths Package folders found in `_path`
+void WatchAddRoot (const std::string& _path, int _maxDepth,
+                   const std::vector<std::string>& paths);
+
+/// @brief Start or stop watching according to `glob.bWatchCSL`
+/// @details The flight loop checking for changes only exists while watching.
+void WatchUpdate ();
+
+/// Grace cleanup, stops watching
+void WatchCleanup ();
+
+}       // namespace XPMP2
+
+#endif
@@ -0,0 +1,232 @@
+/// @file       Cost.cpp
+/// @brief      Sampling-based attribution of flight loop cost to aircraft, aircraft classes, and models
+/// @details    When a frame is slow it is of interest which aircraft's
+///             XPMP2::Aircraft::UpdatePosition() implementation was expensive,
+///             e.g. a legacy aircraft with its data callbacks or an interpolating subclass.
+///             With `debug/cost_attribution` configured, every 16th flight loop
+///             is sampled, measuring each aircraft's UpdatePosition() call.
+///             Time is attributed to the aircraft and to its dynamic type.
+///             Instance creation is measured per CSL model whenever it happens.\n
+///             Top offenders are available via XPMPGetCostTopN() and are
+///             written to `Log.txt` once a minute.
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#include "XPMP2.h"
+
+#include <typeindex>
+#if !IBM
+#include <cxxabi.h>
+#endif
+
+#define INFO_COST_HEADER        "Cost attribution (top %lu, sampled every %d frames): %s"
+#define INFO_COST_LINE          "  %-40.40s %8lu samples, avg %8.1fus, max %8.1fus, total %10.1fus"
+#define INFO_COST_NONE          "Cost attribution: No samples yet"
+
+namespace XPMP2 {
+
+/// Sample every how many flight loops?
+constexpr int COST_SAMPLE_EVERY = 16;
+/// How often to write a summary to the log? [s]
+constexpr float COST_REPORT_PERIOD = 60.0f;
+/// How many offenders per category to write to the log?
+constexpr size_t COST_REPORT_TOP_N = 5;
+
+/// Collected cost of one aircraft, type, or model
+struct CostRecTy {
+    std::string name;                   ///< human-readable name
+    unsigned long n = 0;                ///< number of samples
+    double sumUs = 0.0;                 ///< total time [us]
+    double maxUs = 0.0;                 ///< maximum time of a single sample [us]
+    
+    /// Add a sample
+    void Add (double us)
+    {
+        ++n;
+        sumUs += us;
+        if (us > maxUs) maxUs = us;
+    }
+};
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wexit-time-destructors"
+#pragma clang diagnostic ignored "-Wglobal-constructors"
+/// Cost per aircraft
+static std::map<XPMPPlaneID, CostRecTy> gMapCostAc;
+/// Cost per dynamic aircraft type
+static std::map<std::type_index, CostRecTy> gMapCostType;
+/// Cost per CSL model, by model name, as model objects are reused after a model is retired
+static std::map<std::string, CostRecTy> gMapCostMdl;
+#pragma clang diagnostic pop
+
+/// Last time a summary was written to the log
+static float gTsCostReport = 0.0f;
+
+/// Human-readable name of a type
+static std::string CostTypeName (const std::type_info& ti)
+{
+#if IBM
+    return ti.name();                   // MSVC returns readable names already
+#else
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(ti.name(), nullptr, nullptr, &status);
+    std::string ret = (status == 0 && demangled) ? demangled : ti.name();
+    std::free(demangled);
+    return ret;
+#endif
+}
+
+/// Human-readable name of an aircraft
+static std::string CostAcName (const Aircraft& ac)
+{
+    char buf[20];
+    snprintf(buf, sizeof(buf), "0x%06X ", ac.GetModeS_ID());
+    return buf + ac.GetModelName();
+}
+
+// Is this frame sampled for cost attribution?
+bool CostSampleFrame (int _flCounter)
+{
+    return glob.bCostAttribution && _flCounter % COST_SAMPLE_EVERY == 0;
+}
+
+// Start measuring for an aircraft
+CostTimer::CostTimer (const Aircraft* _pAc) : pAc(_pAc)
+{
+    if (pAc)
+        tStart = std::chrono::steady_clock::now();
+}
+
+// Start measuring for a model
+CostTimer::CostTimer (const CSLModel* _pMdl) :
+pMdl(glob.bCostAttribution ? _pMdl : nullptr)
+{
+    if (pMdl)
+        tStart = std::chrono::steady_clock::now();
+}
+
+// Stop measuring and attribute the time
+CostTimer::~CostTimer ()
+{
+    if (!pAc && !pMdl)
+        return;
+    const double us = std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now() - tStart).count();
+    if (pAc) {
+        CostRecTy& rAc = gMapCostAc[pAc->GetModeS_ID()];
+        if (rAc.name.empty())
+            rAc.name = CostAcName(*pAc);
+        rAc.Add(us);
+        CostRecTy& rType = gMapCostType[std::type_index(typeid(*pAc))];
+        if (rType.name.empty())
+            rType.name = CostTypeName(typeid(*pAc));
+        rType.Add(us);
+    }
+    if (pMdl) {
+        CostRecTy& rMdl = gMapCostMdl[pMdl->GetModelName()];
+        if (rMdl.name.empty())
+            rMdl.name = pMdl->GetModelName();
+        rMdl.Add(us);
+    }
+}
+
+// An aircraft is destroyed, remove its collected data
+void CostAircraftRemoved (XPMPPlaneID _id)
+{
+    gMapCostAc.erase(_id);
+}
+
+/// Returns the top N entries of a map, sorted by total time
+template <class MapT>
+static std::vector<XPMPCostInfo_t> CostTopN (const MapT& m, size_t n)
+{
+    std::vector<XPMPCostInfo_t> v;
+    v.reserve(m.size());
+    for (const auto& p: m) {
+        XPMPCostInfo_t ci;
+        ci.name     = p.second.name;
+        ci.samples  = p.second.n;
+        ci.totalUs  = p.second.sumUs;
+        ci.avgUs    = p.second.n ? p.second.sumUs / double(p.second.n) : 0.0;
+        ci.maxUs    = p.second.maxUs;
+        v.push_back(std::move(ci));
+    }
+    const size_t nRet = std::min(n, v.size());
+    std::partial_sort(v.begin(), v.begin() + long(nRet), v.end(),
+                      [](const XPMPCostInfo_t& a, const XPMPCostInfo_t& b)
+                      { return a.totalUs > b.totalUs; });
+    v.resize(nRet);
+    return v;
+}
+
+/// Writes one category's top offenders to the log
+static void CostLogTopN (const char* cat, const std::vector<XPMPCostInfo_t>& v)
+{
+    LOG_MSG(logINFO, INFO_COST_HEADER, (unsigned long)v.size(), COST_SAMPLE_EVERY, cat);
+    for (const XPMPCostInfo_t& ci: v) {
+        LOG_MSG(logINFO, INFO_COST_LINE, ci.name.c_str(), ci.samples,
+                ci.avgUs, ci.maxUs, ci.totalUs);
+    }
+}
+
+// Regularly writes a summary of top offenders to the log
+void CostPeriodicReport ()
+{
+    if (!glob.bCostAttribution ||
+        !CheckEverySoOften(gTsCostReport, COST_REPORT_PERIOD))
+        return;
+    if (gMapCostAc.empty() && gMapCostMdl.empty()) {
+        LOG_MSG(logINFO, INFO_COST_NONE);
+        return;
+    }
+    CostLogTopN("aircraft",  CostTopN(gMapCostAc,   COST_REPORT_TOP_N));
+    CostLogTopN("type",      CostTopN(gMapCostType, COST_REPORT_TOP_N));
+    CostLogTopN("model",     CostTopN(gMapCostMdl,  COST_REPORT_TOP_N));
+}
+
+// Grace cleanup, removes all collected data
+void CostCleanup ()
+{
+    gMapCostAc.clear();
+    gMapCostType.clear();
+    gMapCostMdl.clear();
+}
+
+}       // namespace XPMP2
+
+//
+// MARK: Public functions
+//
+
+using namespace XPMP2;
+
+// Returns the top offenders of a cost category
+std::vector<XPMPCostInfo_t> XPMPGetCostTopN (XPMPCostCategory_t inCat, size_t inN)
+{
+    switch (inCat) {
+        case xpmp_Cost_Aircraft:    return CostTopN(gMapCostAc,   inN);
+        case xpmp_Cost_Type:        return CostTopN(gMapCostType, inN);
+        case xpmp_Cost_Model:       return CostTopN(gMapCostMdl,  inN);
+    }
+    return std::vector<XPMPCostInfo_t>();
+}
+
+// Resets all collected cost data
+void XPMPResetCostStats ()
+{
+    CostCleanup();
+}
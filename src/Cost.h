@@ -0,0 +1,58 @@
+/// @file       Cost.h
+/// @brief      Sampling-based attribution of flight loop cost to aircraft, aircraft classes, and models
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#ifndef _Cost_h_
+#define _Cost_h_
+
+namespace XPMP2 {
+
+/// Is this frame sampled for cost attribution?
+bool CostSampleFrame (int _flCounter);
+
+/// @brief Measures the time until destruction and attributes it to an aircraft (and its class) or a model
+/// @details Does nothing if constructed with `nullptr`
+class CostTimer {
+protected:
+    const Aircraft* pAc = nullptr;      ///< aircraft to attribute to
+    const CSLModel* pMdl = nullptr;     ///< model to attribute to
+    std::chrono::steady_clock::time_point tStart;   ///< when measurement started
+public:
+    /// Start measuring for an aircraft, `nullptr` if not sampling
+    CostTimer (const Aircraft* _pAc);
+    /// Start measuring for a model, `nullptr` if not sampling
+    CostTimer (const CSLModel* _pMdl);
+    /// Stop measuring and attribute the time
+    ~CostTimer ();
+    CostTimer (const CostTimer&) = delete;
+    CostTimer& operator = (const CostTimer&) = delete;
+};
+
+/// An aircraft is destroyed, remove its collected data (the data of its class is kept)
+void CostAircraftRemoved (XPMPPlaneID _id);
+
+/// Regularly writes a summary of top offenders to the log
+void CostPeriodicReport ();
+
+/// Grace cleanup, removes all collected data
+void CostCleanup ();
+
+}       // namespace XPMP2
+
+#endif
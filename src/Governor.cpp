@@ -0,0 +1,210 @@
+/// @file       Governor.cpp
+/// @brief      Frame-time-adaptive quality governor
+/// @details    With a target frame time configured (`planes/frame_time_target`)
+///             the governor compares the averages of X-Plane's frame time
+///             and XPMP2's own time spent in the aircraft flight loop
+///             every 2 seconds against the target.
+///             If exceeded, quality is stepped down by one level,
+///             see GovLevelTy. Only after 10 seconds with sufficient headroom
+///             quality is restored again level by level, which avoids oscillation.
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#include "XPMP2.h"
+
+#define INFO_GOV_LEVEL          "Quality governor: level %d -> %d (frame time %.1fms, XPMP2 %.2fms, target %dms)"
+
+namespace XPMP2 {
+
+/// How often to evaluate frame times? [s]
+constexpr float GOV_EVAL_PERIOD = 2.0f;
+/// For how long must there be headroom before quality is restored? [s]
+constexpr float GOV_RESTORE_PERIOD = 10.0f;
+/// Headroom: frame time must be below this share of the target for restoring quality
+constexpr float GOV_HEADROOM = 0.8f;
+/// XPMP2's own cost must not exceed this share of the target frame time
+constexpr float GOV_OWN_SHARE = 0.1f;
+/// Reduced label distance factor
+constexpr float GOV_LABEL_FACTOR = 0.5f;
+/// Reduced number of rendered aircraft as share of the aircraft rendered when stepping down
+constexpr float GOV_RENDER_FACTOR = 0.75f;
+/// Aircraft further away than this (plus `aiPrio` weighted as for TCAS) are considered distant [m]
+constexpr float GOV_FAR_DIST = 10.0f * M_per_NM;
+/// In reduced levels, work is done only every this many frames
+constexpr int GOV_THIN_OUT = 4;
+
+/// Current level
+static GovLevelTy gGovLevel = GOV_FULL;
+/// Cap on rendered aircraft as computed when entering GOV_RENDER_CAP
+static size_t gGovRenderCap = 0;
+/// Current flight loop counter, used to stagger thinned-out work across aircraft
+static int gGovFlCounter = 0;
+/// X-Plane's frame time
+static XPLMDataRef drFramePeriod = nullptr;
+
+/// Start of current flight loop
+static std::chrono::steady_clock::time_point gGovTStart;
+/// Time of last evaluation (in terms of XP's network time)
+static float gGovTsEval = 0.0f;
+/// Since when is there headroom? (`0` = currently not)
+static float gGovTsHeadroom = 0.0f;
+/// Sums since last evaluation: X-Plane's frame time [s]
+static double gGovSumFrame = 0.0;
+/// Sums since last evaluation: XPMP2's own time [s]
+static double gGovSumOwn = 0.0;
+/// Number of frames since last evaluation
+static unsigned gGovNumFrames = 0;
+
+/// Switch to a new level
+static void GovSetLevel (GovLevelTy _lvl, double avgFrame, double avgOwn)
+{
+    LOG_MSG(logINFO, INFO_GOV_LEVEL, int(gGovLevel), int(_lvl),
+            avgFrame * 1000.0, avgOwn * 1000.0, glob.frameTimeTarget);
+    
+    // Entering the render cap level: Cap at a share of what is currently rendered
+    if (gGovLevel < GOV_RENDER_CAP && _lvl >= GOV_RENDER_CAP) {
+        size_t n = 0;
+        for (const auto& p: glob.mapAc)
+            if (p.second->IsVisible() && p.second->IsRenderAdmitted())
+                ++n;
+        gGovRenderCap = std::max<size_t>(size_t(float(n) * GOV_RENDER_FACTOR), 1);
+    }
+    else if (_lvl < GOV_RENDER_CAP)
+        gGovRenderCap = 0;
+    
+    gGovLevel = _lvl;
+}
+
+/// Evaluate collected frame times, step quality down or up
+static void GovEvaluate (float now)
+{
+    if (!gGovNumFrames)
+        return;
+    const double target   = double(glob.frameTimeTarget) / 1000.0;
+    const double avgFrame = gGovSumFrame / gGovNumFrames;
+    const double avgOwn   = gGovSumOwn / gGovNumFrames;
+    gGovSumFrame = gGovSumOwn = 0.0;
+    gGovNumFrames = 0;
+    
+    // Too slow? Step down
+    if (avgFrame > target || avgOwn > target * GOV_OWN_SHARE) {
+        gGovTsHeadroom = 0.0f;
+        if (gGovLevel < GOV_CLAMP_FREQ)
+            GovSetLevel(GovLevelTy(gGovLevel + 1), avgFrame, avgOwn);
+    }
+    // Enough headroom? Step up once it lasted long enough
+    else if (avgFrame < target * GOV_HEADROOM &&
+             avgOwn < target * GOV_OWN_SHARE * GOV_HEADROOM)
+    {
+        if (gGovLevel == GOV_FULL)
+            return;
+        if (gGovTsHeadroom <= 0.0f)
+            gGovTsHeadroom = now;
+        else if (now - gGovTsHeadroom >= GOV_RESTORE_PERIOD) {
+            gGovTsHeadroom = now;
+            GovSetLevel(GovLevelTy(gGovLevel - 1), avgFrame, avgOwn);
+        }
+    }
+    else
+        gGovTsHeadroom = 0.0f;
+}
+
+/// Is this aircraft's thinned-out work due in this frame? (staggered by plane id)
+static bool GovIsDue (const Aircraft& _ac)
+{
+    return (unsigned(gGovFlCounter) + _ac.GetModeS_ID()) % GOV_THIN_OUT == 0;
+}
+
+// Called at the beginning of the aircraft flight loop
+void GovFrameStart (int _flCounter)
+{
+    gGovFlCounter = _flCounter;
+    if (glob.frameTimeTarget > 0)
+        gGovTStart = std::chrono::steady_clock::now();
+}
+
+// Called at the end of the aircraft flight loop, evaluates frame times regularly
+void GovFrameEnd ()
+{
+    // Governor switched off? Then return to full quality
+    if (glob.frameTimeTarget <= 0) {
+        if (gGovLevel != GOV_FULL)
+            GovCleanup();
+        return;
+    }
+    
+    // Collect X-Plane's frame time and our own time spent
+    if (!drFramePeriod)
+        drFramePeriod = XPLMFindDataRef("sim/operation/misc/frame_rate_period");
+    if (drFramePeriod)
+        gGovSumFrame += double(XPLMGetDataf(drFramePeriod));
+    gGovSumOwn += std::chrono::duration<double>(std::chrono::steady_clock::now() - gGovTStart).count();
+    ++gGovNumFrames;
+    
+    // Evaluate every so often
+    const float now = GetMiscNetwTime();
+    if (CheckEverySoOften(gGovTsEval, GOV_EVAL_PERIOD, now))
+        GovEvaluate(now);
+}
+
+// Current quality level
+GovLevelTy GovLevel ()
+{
+    return gGovLevel;
+}
+
+// Factor to apply to the label distance
+float GovLabelDistFactor ()
+{
+    return gGovLevel >= GOV_LABELS ? GOV_LABEL_FACTOR : 1.0f;
+}
+
+// Maximum number of rendered aircraft, considering the configured cap
+size_t GovMaxRendered (size_t _configured)
+{
+    if (gGovLevel < GOV_RENDER_CAP || !gGovRenderCap)
+        return _configured;
+    return _configured ? std::min(_configured, gGovRenderCap) : gGovRenderCap;
+}
+
+// May the aircraft skip moving its instances in this frame?
+bool GovSkipMove (const Aircraft& _ac)
+{
+    return
+    gGovLevel >= GOV_FAR_UPDATE &&
+    _ac.GetCameraDist() + float(_ac.aiPrio * AI_PRIO_MULTIPLIER) > GOV_FAR_DIST &&
+    !GovIsDue(_ac);
+}
+
+// May the aircraft skip probing the terrain in this frame?
+bool GovSkipProbe (const Aircraft& _ac)
+{
+    return gGovLevel >= GOV_CLAMP_FREQ && !GovIsDue(_ac);
+}
+
+// Grace cleanup, returns to full quality
+void GovCleanup ()
+{
+    gGovLevel = GOV_FULL;
+    gGovRenderCap = 0;
+    gGovTsHeadroom = 0.0f;
+    gGovSumFrame = gGovSumOwn = 0.0;
+    gGovNumFrames = 0;
+}
+
+}       // namespace XPMP2
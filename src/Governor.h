@@ -0,0 +1,66 @@
+/// @file       Governor.h
+/// @brief      Frame-time-adaptive quality governor
+/// @details    Watches X-Plane's frame time and XPMP2's own cost per frame.
+///             If they exceed the configured target, quality is stepped down
+///             (label distance, number of rendered aircraft, update rate of
+///             distant aircraft, ground clamping frequency), and restored
+///             again when there is headroom.
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#ifndef _Governor_h_
+#define _Governor_h_
+
+namespace XPMP2 {
+
+/// Quality levels of the governor, each level includes the reductions of the previous ones
+enum GovLevelTy {
+    GOV_FULL = 0,           ///< full quality, no reductions
+    GOV_LABELS,             ///< reduced label distance, ie. fewer labels
+    GOV_RENDER_CAP,         ///< fewer rendered aircraft
+    GOV_FAR_UPDATE,         ///< instances of distant aircraft moved only every few frames
+    GOV_CLAMP_FREQ,         ///< ground clamping probes terrain only every few frames
+};
+
+/// Called at the beginning of the aircraft flight loop
+void GovFrameStart (int _flCounter);
+
+/// Called at the end of the aircraft flight loop, evaluates frame times regularly
+void GovFrameEnd ();
+
+/// Current quality level
+GovLevelTy GovLevel ();
+
+/// Factor to apply to the label distance
+float GovLabelDistFactor ();
+
+/// Maximum number of rendered aircraft, considering the configured cap (`0` = unlimited)
+size_t GovMaxRendered (size_t _configured);
+
+/// May the aircraft skip moving its instances in this frame? (distant aircraft in GOV_FAR_UPDATE)
+bool GovSkipMove (const Aircraft& _ac);
+
+/// May the aircraft skip probing the terrain in this frame? (in GOV_CLAMP_FREQ)
+bool GovSkipProbe (const Aircraft& _ac);
+
+/// Grace cleanup, returns to full quality
+void GovCleanup ();
+
+}       // namespace XPMP2
+
+#endif
@@ -0,0 +1,205 @@
+/// @file       LOD.cpp
+/// @brief      Distance-based level of detail: distant aircraft shown by generic low-detail models
+/// @details    A plane 60nm away covers a few pixels only. Showing it with its
+///             matched full-detail CSL model means loading that model and keeping it in memory.
+///             Instead, beyond a configurable distance, a generic low-detail model,
+///             defined per Doc8643 classification and WTC, is shown.\n
+///             The aircraft's reference counter moves to the model its instances
+///             are created from, so that garbage collection can unload full-detail
+///             models of distant aircraft.
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#include "XPMP2.h"
+
+#define INFO_LOD_MODEL          "Low-detail model for '%s/%s' is now %s"
+#define INFO_LOD_MODEL_REMOVED  "Low-detail model for '%s/%s' removed"
+#define ERR_LOD_MODEL_UNKNOWN   "Low-detail model not found"
+#define DEBUG_LOD_SWITCH        "Aircraft 0x%06X: Now shown by %s model %s"
+
+namespace XPMP2 {
+
+/// Return to the matched model only when closer than this share of the LOD distance (hysteresis)
+constexpr float LOD_HYSTERESIS = 0.9f;
+
+/// Distance beyond which aircraft are shown by low-detail models [m], `0` is off
+static float gLODDist = 0.0f;
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wexit-time-destructors"
+#pragma clang diagnostic ignored "-Wglobal-constructors"
+/// Low-detail models, key is "classification/WTC", either part can be empty, then matching any
+static std::map<std::string, CSLModel*> gMapLODMdl;
+#pragma clang diagnostic pop
+
+/// Compiles the key into gMapLODMdl
+static std::string LODKey (const std::string& _class, const std::string& _wtc)
+{
+    return _class + '/' + _wtc;
+}
+
+//
+// MARK: Internal functions
+//
+
+// Is distance-based level of detail active at all?
+bool LODEnabled ()
+{
+    return gLODDist > 0.0f && !gMapLODMdl.empty();
+}
+
+// Find the low-detail model to be shown instead of the given model
+/// @details Most specific definition first: classification and WTC, then
+///          classification only, then WTC only, then the catch-all definition
+CSLModel* LODModelFor (const CSLModel& _mdl)
+{
+    if (gMapLODMdl.empty())
+        return nullptr;
+    
+    const std::string cls = _mdl.GetDoc8643().classification;
+    const std::string wtc = _mdl.GetWTC();
+    for (const std::string& key: { LODKey(cls, wtc), LODKey(cls, ""),
+                                   LODKey("", wtc),  LODKey("", "") })
+    {
+        auto iter = gMapLODMdl.find(key);
+        if (iter != gMapLODMdl.end())
+            // a model, which failed to load, can't be used
+            return iter->second->GetLoadState() == MLS_FAILED ? nullptr : iter->second;
+    }
+    return nullptr;
+}
+
+// Forgets all low-detail definitions referring to the given model
+void LODForgetModel (const CSLModel* pMdl)
+{
+    for (auto iter = gMapLODMdl.begin(); iter != gMapLODMdl.end();)
+        if (iter->second == pMdl)
+            iter = gMapLODMdl.erase(iter);
+        else
+            ++iter;
+}
+
+// Grace cleanup, forgets all defined low-detail models
+void LODCleanup ()
+{
+    gMapLODMdl.clear();
+}
+
+//
+// MARK: Aircraft member functions
+//
+
+// Decide if a low-detail model is to be shown, based on camera distance
+void Aircraft::LODUpdate ()
+{
+    // A low-detail model we wait for failed to load? Then return to the matched model
+    if (bInstLOD && pLODMdl->GetLoadState() == MLS_FAILED)
+        LODReset();
+    
+    bool bWant = false;
+    if (LODEnabled() && pCSLMdl) {
+        // Once shown by the low-detail model stay so until clearly closer again
+        bWant = camDist > (bLODWanted ? gLODDist * LOD_HYSTERESIS : gLODDist);
+        // Find the low-detail model to use, unless already showing it
+        if (bWant && !bInstLOD) {
+            pLODMdl = LODModelFor(*pCSLMdl);
+            if (!pLODMdl || pLODMdl == pCSLMdl)
+                bWant = false;
+        }
+    }
+    bLODWanted = bWant;
+}
+
+// Switch instances between matched and low-detail model once the target model is loaded
+void Aircraft::LODSwap ()
+{
+    CSLModel* pTarget = bLODWanted ? pLODMdl : pCSLMdl;
+    LOG_ASSERT(pTarget);
+    
+    // As long as we show instances we keep them until the target model is loaded,
+    // so that the aircraft doesn't disappear meanwhile
+    if (!listInst.empty() && !pTarget->IsReady()) {
+        if (pTarget->GetLoadState() == MLS_UNLOADED)
+            pTarget->RequestLoad(modeS_id);
+        return;
+    }
+    
+    // Switch, the reference moves to the model instances are created from
+    DestroyInstances();
+    pTarget->IncRefCnt();
+    (bLODWanted ? pCSLMdl : pLODMdl)->DecRefCnt();
+    bInstLOD = bLODWanted;
+    bWaitMdlLoad = false;
+    LOG_MSG(logDEBUG, DEBUG_LOD_SWITCH, modeS_id,
+            bInstLOD ? "low-detail" : "matched",
+            pTarget->GetModelName().c_str());
+}
+
+// Return to the matched model, e.g. before the model changes
+void Aircraft::LODReset ()
+{
+    if (bInstLOD) {
+        DestroyInstances();
+        pCSLMdl->IncRefCnt();
+        pLODMdl->DecRefCnt();
+        bInstLOD = false;
+        bWaitMdlLoad = false;
+    }
+    bLODWanted = false;
+    pLODMdl = nullptr;
+}
+
+}       // namespace XPMP2
+
+//
+// MARK: Public functions
+//
+
+using namespace XPMP2;
+
+// Configure the distance beyond which aircraft are shown by a generic low-detail model
+void XPMPSetLODDistance (float _dist_nm)
+{
+    gLODDist = std::max(_dist_nm, 0.0f) * M_per_NM;     // store in meter
+}
+
+// Define a generic low-detail model
+const char* XPMPSetLODModel (const char* inClassification,
+                             const char* inWTC,
+                             const char* inModelName)
+{
+    const std::string cls = inClassification ? inClassification : "";
+    const std::string wtc = inWTC ? inWTC : "";
+    
+    // Remove a definition
+    if (!inModelName || !inModelName[0]) {
+        if (gMapLODMdl.erase(LODKey(cls, wtc)) > 0) {
+            LOG_MSG(logINFO, INFO_LOD_MODEL_REMOVED, cls.c_str(), wtc.c_str());
+        }
+        return "";
+    }
+    
+    // Add/replace a definition
+    CSLModel* pMdl = CSLModelByName(inModelName);
+    if (!pMdl)
+        return ERR_LOD_MODEL_UNKNOWN;
+    gMapLODMdl[LODKey(cls, wtc)] = pMdl;
+    LOG_MSG(logINFO, INFO_LOD_MODEL, cls.c_str(), wtc.c_str(),
+            pMdl->GetModelName().c_str());
+    return "";
+}
@@ -0,0 +1,44 @@
+/// @file       LOD.h
+/// @brief      Distance-based level of detail: distant aircraft shown by generic low-detail models
+/// @details    Beyond a configurable distance aircraft are rendered using a generic
+///             low-detail CSL model, defined per Doc8643 classification and wake turbulence category.
+///             Their matched full-detail model then need not be loaded or kept in memory.
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#ifndef _LOD_h_
+#define _LOD_h_
+
+namespace XPMP2 {
+
+/// Is distance-based level of detail active at all?
+bool LODEnabled ();
+
+/// @brief Find the low-detail model to be shown instead of the given model
+/// @return `nullptr` if no low-detail model is defined for the model's classification and WTC
+CSLModel* LODModelFor (const CSLModel& _mdl);
+
+/// Forgets all low-detail definitions referring to the given model, e.g. before its storage is reused
+void LODForgetModel (const CSLModel* pMdl);
+
+/// Grace cleanup, forgets all defined low-detail models
+void LODCleanup ();
+
+}       // namespace XPMP2
+
+#endif
@@ -164,12 +164,20 @@ void Aircraft::MapDrawLabel (XPLMMapLayerID inLayer, float yOfs)
 // Put together the map label, depends on tcasTargetIdx
 void Aircraft::ComputeMapLabel ()
 {
-    mapLabel =
-    IsCurrentlyShownAsAI() ?
-        (std::string("[") + label + ']') :
-    IsCurrentlyShownAsTcasTarget() ?
-        (std::string(">") + label + '<') :
-    label;
+    // Build in place, reusing mapLabel's capacity instead of creating temporaries
+    mapLabel.clear();
+    if (IsCurrentlyShownAsAI()) {
+        mapLabel += '[';
+        mapLabel += label;
+        mapLabel += ']';
+    }
+    else if (IsCurrentlyShownAsTcasTarget()) {
+        mapLabel += '>';
+        mapLabel += label;
+        mapLabel += '<';
+    }
+    else
+        mapLabel += label;
 }
 
 
@@ -202,6 +210,8 @@ void MapIconDrawingCB (XPLMMapLayerID       inLayer,
 {
     // This is a plugin entry function, so we try to catch all exceptions
     try {
+        AllocScope allocScope;          // XPMP2_ALLOC_AUDIT only: Count allocations
+
         // Have no reasonable map unit yet?
         if (std::isnan(gMtrPerMapUnit))
             MapPrepareCacheCB(inLayer, inMapBoundsLeftTopRightBottom, projection, refcon);
@@ -238,6 +248,8 @@ void MapLabelDrawingCB (XPLMMapLayerID       inLayer,
 {
     // This is a plugin entry function, so we try to catch all exceptions
     try {
+        AllocScope allocScope;          // XPMP2_ALLOC_AUDIT only: Count allocations
+
         // Return at once if label drawing is off
         if (!glob.bMapLabels) return;
 
@@ -0,0 +1,212 @@
+/// @file       Profile.cpp
+/// @brief      Opt-in profiling of startup phases and CSL package loading
+/// @details    Enabled by the config item `debug/profile_startup`.
+///             The report lists phases sorted by wall time, so that the
+///             most expensive CSL packages show up first.
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#include "XPMP2.h"
+
+#define INFO_PROFILE_HEAD       "Startup profile (sorted by time, time includes nested phases):"
+#define INFO_PROFILE_COLS       "     ms |  calls |  files |      bytes | models | phase"
+#define INFO_PROFILE_LINE       "%7.1f | %6lu | %6lu | %10llu | %6lu | %s%s%s"
+#define INFO_PROFILE_JSON       "Startup profile written to %s"
+#define ERR_PROFILE_JSON        "Could not write startup profile to %s"
+
+namespace XPMP2 {
+
+/// Accumulated measurements of one phase
+struct ProfileRecTy {
+    std::string         phase;          ///< name of the phase, usually the function
+    std::string         detail;         ///< details like the package path, or empty
+    unsigned long       calls = 0;      ///< how often was the phase entered?
+    std::chrono::steady_clock::duration dur = std::chrono::steady_clock::duration::zero(); ///< total wall time
+    unsigned long       files = 0;      ///< files touched
+    unsigned long long  bytes = 0;      ///< bytes read
+    unsigned long       models = 0;     ///< models produced
+};
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wexit-time-destructors"
+#pragma clang diagnostic ignored "-Wglobal-constructors"
+
+/// All records, keyed by phase and detail
+static std::map<std::pair<std::string,std::string>,ProfileRecTy> gMapProfile;
+/// Stack of currently active phases
+static std::vector<ProfileRecTy*> gStackProfile;
+
+#pragma clang diagnostic pop
+
+//
+// MARK: Profile Phase
+//
+
+// Starts measuring a phase
+ProfilePhase::ProfilePhase (const char* _phase, const std::string& _detail)
+{
+    if (!glob.bProfileStartup)
+        return;
+    pRec = &gMapProfile[std::make_pair(std::string(_phase), _detail)];
+    if (pRec->phase.empty()) {
+        pRec->phase  = _phase;
+        pRec->detail = _detail;
+    }
+    gStackProfile.push_back(pRec);
+    tStart = std::chrono::steady_clock::now();
+}
+
+// Stops measuring and adds the time to the phase's record
+ProfilePhase::~ProfilePhase ()
+{
+    if (!pRec)
+        return;
+    pRec->dur += std::chrono::steady_clock::now() - tStart;
+    pRec->calls++;
+    // Remove myself from the stack (which is normally the top element)
+    auto iter = std::find(gStackProfile.rbegin(), gStackProfile.rend(), pRec);
+    if (iter != gStackProfile.rend())
+        gStackProfile.erase(std::next(iter).base());
+}
+
+//
+// MARK: Global Functions
+//
+
+// Account a file touched, and optionally bytes read
+void ProfileFile (unsigned long long bytes)
+{
+    if (gStackProfile.empty())
+        return;
+    gStackProfile.back()->files++;
+    gStackProfile.back()->bytes += bytes;
+}
+
+// Account a file opened for reading, determining its size
+void ProfileFile (std::ifstream& f)
+{
+    if (gStackProfile.empty())
+        return;
+    unsigned long long bytes = 0;
+    if (f.good()) {
+        const std::streampos pos = f.tellg();
+        f.seekg(0, std::ios_base::end);
+        bytes = (unsigned long long)f.tellg();
+        f.seekg(pos);
+    }
+    ProfileFile(bytes);
+}
+
+// Account models produced
+void ProfileModels (unsigned long n)
+{
+    if (!gStackProfile.empty())
+        gStackProfile.back()->models += n;
+}
+
+/// Escape a string for output in JSON
+static std::string ProfileJsonStr (const std::string& s)
+{
+    std::string ret ("\"");
+    for (char c: s) {
+        if (c == '"' || c == '\\') ret += '\\';
+        if ((unsigned char)c < ' ') continue;   // control chars aren't expected in paths anyway
+        ret += c;
+    }
+    ret += '"';
+    return ret;
+}
+
+// Write the profile sorted by time to the log, and optionally to a JSON file
+const char* ProfileReport (const char* _jsonPath)
+{
+    if (gMapProfile.empty())
+        return "";
+    
+    // Sort all records by time, most expensive first
+    std::vector<const ProfileRecTy*> vecRec;
+    vecRec.reserve(gMapProfile.size());
+    for (const auto& p: gMapProfile)
+        vecRec.push_back(&p.second);
+    std::sort(vecRec.begin(), vecRec.end(),
+              [](const ProfileRecTy* a, const ProfileRecTy* b)
+              { return a->dur > b->dur; });
+    
+    // Report to the log
+    LOG_MSG(logINFO, INFO_PROFILE_HEAD);
+    LOG_MSG(logINFO, INFO_PROFILE_COLS);
+    for (const ProfileRecTy* pRec: vecRec) {
+        LOG_MSG(logINFO, INFO_PROFILE_LINE,
+                std::chrono::duration<double,std::milli>(pRec->dur).count(),
+                pRec->calls, pRec->files, pRec->bytes, pRec->models,
+                pRec->phase.c_str(),
+                pRec->detail.empty() ? "" : " ",
+                StripXPSysDir(pRec->detail).c_str());
+    }
+    
+    // Also write a JSON file?
+    if (!_jsonPath || !*_jsonPath)
+        return "";
+    std::ofstream fOut (TOPOSIX(_jsonPath), std::ios_base::out | std::ios_base::trunc);
+    if (!fOut) {
+        LOG_MSG(logERR, ERR_PROFILE_JSON, _jsonPath);
+        return ERR_PROFILE_JSON;
+    }
+    fOut << "[\n";
+    for (size_t i = 0; i < vecRec.size(); ++i) {
+        const ProfileRecTy& rec = *vecRec[i];
+        fOut << "  {\"phase\": "   << ProfileJsonStr(rec.phase)
+             << ", \"detail\": "   << ProfileJsonStr(rec.detail)
+             << ", \"ms\": "       << std::chrono::duration<double,std::milli>(rec.dur).count()
+             << ", \"calls\": "    << rec.calls
+             << ", \"files\": "    << rec.files
+             << ", \"bytes\": "    << rec.bytes
+             << ", \"models\": "   << rec.models
+             << (i+1 < vecRec.size() ? "},\n" : "}\n");
+    }
+    fOut << "]\n";
+    if (!fOut) {
+        LOG_MSG(logERR, ERR_PROFILE_JSON, _jsonPath);
+        return ERR_PROFILE_JSON;
+    }
+    LOG_MSG(logINFO, INFO_PROFILE_JSON, _jsonPath);
+    return "";
+}
+
+// Grace cleanup, removes all records
+void ProfileCleanup ()
+{
+    gStackProfile.clear();
+    gMapProfile.clear();
+}
+
+}       // namespace XPMP2
+
+//
+// MARK: Global functions outside XPMP2 namespace
+//
+
+using namespace XPMP2;
+
+// Write the startup profile to the log, and optionally to a JSON file
+const char* XPMPWriteStartupProfile (const char* inJsonPath)
+{
+    if (!glob.bProfileStartup)
+        return "Startup profiling not enabled (config item debug/profile_startup)";
+    return ProfileReport(inJsonPath);
+}
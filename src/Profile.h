@@ -0,0 +1,69 @@
+/// @file       Profile.h
+/// @brief      Opt-in profiling of startup phases and CSL package loading
+/// @details    Records wall time, files touched, bytes read, and models produced
+///             per phase and per CSL package, reported sorted by time.
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#ifndef _Profile_h_
+#define _Profile_h_
+
+namespace XPMP2 {
+
+/// Accumulated measurements of one phase (defined in Profile.cpp)
+struct ProfileRecTy;
+
+/// @brief Measures one startup phase while in scope
+/// @details Phases can nest. Files, bytes, and models are accounted
+///          to the innermost active phase only, time is inclusive.
+///          Does nothing if profiling isn't enabled.
+class ProfilePhase
+{
+protected:
+    /// Record of this phase, `nullptr` if not profiling
+    ProfileRecTy* pRec = nullptr;
+    /// When did the phase start?
+    std::chrono::steady_clock::time_point tStart;
+public:
+    /// Starts measuring a phase, `_detail` can e.g. be a package path
+    ProfilePhase (const char* _phase, const std::string& _detail = std::string());
+    /// Stops measuring and adds the time to the phase's record
+    ~ProfilePhase ();
+    ProfilePhase (const ProfilePhase&) = delete;
+    ProfilePhase& operator = (const ProfilePhase&) = delete;
+};
+
+/// Account a file touched (opened, listed, or checked for existence), and optionally bytes read
+void ProfileFile (unsigned long long bytes = 0);
+
+/// Account a file opened for reading, determining its size
+void ProfileFile (std::ifstream& f);
+
+/// Account models produced
+void ProfileModels (unsigned long n);
+
+/// Write the profile sorted by time to the log, and optionally to a JSON file
+/// @return Empty string on success, otherwise an error text
+const char* ProfileReport (const char* _jsonPath = nullptr);
+
+/// Grace cleanup, removes all records
+void ProfileCleanup ();
+
+}       // namespace XPMP2
+
+#endif
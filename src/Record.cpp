@@ -0,0 +1,541 @@
+/// @file       Record.cpp
+/// @brief      Recording of all aircraft input per frame into a binary file, and replaying it
+/// @details    Performance problems often depend on the actual traffic mix.
+///             XPMPStartRecording() captures every aircraft's create, model change,
+///             and destroy events as well as, per frame, the state the plugin
+///             has written into `drawInfo`, `v`, and `acRadar`.
+///             Informational texts and the label are recorded only when they change.\n
+///             The file starts with a magic string and a version number,
+///             followed by a sequence of records, each starting with a XPMP2::RecTypeTy byte.
+///             Frame records are stored column by column
+///             (all ids, then all x coordinates etc.) to be compact and quick to read.\n
+///             XPMPStartReplay() then drives aircraft objects from such a file,
+///             either in original timing or one recorded frame per flight loop.
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#include "XPMP2.h"
+
+#define REC_MAGIC               "XPMP2REC"
+#define INFO_REC_START          "Recording aircraft input to '%s'"
+#define INFO_REC_STOP           "Recording stopped, %lu frames recorded"
+#define INFO_REPLAY_START       "Replaying aircraft input from '%s' at %s speed"
+#define INFO_REPLAY_STOP        "Replay stopped after %lu frames"
+#define ERR_REC_OPEN            "Could not open '%s' for writing"
+#define ERR_REPLAY_OPEN         "Could not open '%s' for reading"
+#define ERR_REPLAY_FORMAT       "'%s' is not an XPMP2 recording of version %u"
+#define ERR_REPLAY_RECORD       "Unknown record type %u in recording, file corrupt?"
+#define ERR_REPLAY_NO_AC        "'%s' does not contain any recorded aircraft"
+#define ERR_REPLAY_FRAME_SIZE   "Frame of %u aircraft exceeds the rest of the recording, file corrupt?"
+#define ERR_REPLAY_EXCEPTION    "Replay stopped due to exception: %s"
+#define WARN_REPLAY_CREATE      "Could not create replayed aircraft 0x%06X: %s"
+
+namespace XPMP2 {
+
+/// Version of the file format
+constexpr uint32_t REC_VERSION = 1;
+
+/// Types of records in a recording
+enum RecTypeTy : uint8_t {
+    REC_FRAME = 1,          ///< state of all aircraft in a frame
+    REC_CREATE,             ///< aircraft created
+    REC_MODEL,              ///< aircraft changed model
+    REC_DESTROY,            ///< aircraft destroyed
+    REC_INFO,               ///< aircraft's informational texts or label changed
+};
+
+/// Bit in the frame's flags column: aircraft visible?
+constexpr uint8_t REC_FLAG_VISIBLE = 0x01;
+/// Minimum size of a frame record per aircraft: id, 6 floats, flags, code, mode, number of `v` values
+constexpr size_t REC_FRAME_MIN_PER_AC = sizeof(uint32_t) + 6 * sizeof(float) + sizeof(uint8_t) +
+                                        sizeof(int32_t) + sizeof(uint8_t) + sizeof(uint16_t);
+
+//
+// MARK: Recording
+//
+
+/// State of the recorder
+struct RecorderTy {
+    std::ofstream f;                    ///< recording file
+    std::vector<char> buf;              ///< buffer collecting the current frame's records
+    /// last recorded informational texts and label per aircraft
+    std::unordered_map<XPMPPlaneID, std::pair<XPMPInfoTexts_t,std::string> > mapInfo;
+    unsigned long nFrames = 0;          ///< number of frames recorded
+};
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wexit-time-destructors"
+#pragma clang diagnostic ignored "-Wglobal-constructors"
+/// The recorder
+static RecorderTy gRec;
+#pragma clang diagnostic pop
+
+/// Add a value to the recording buffer
+template<class T>
+void RecPut (const T& val)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "can only record plain values");
+    const char* p = reinterpret_cast<const char*>(&val);
+    gRec.buf.insert(gRec.buf.end(), p, p + sizeof(T));
+}
+
+/// Add a string to the recording buffer, prefixed by its length
+static void RecPutStr (const std::string& s)
+{
+    const uint16_t len = uint16_t(std::min<size_t>(s.size(), UINT16_MAX));
+    RecPut(len);
+    gRec.buf.insert(gRec.buf.end(), s.data(), s.data() + len);
+}
+
+/// Add one column to the frame record: one value per aircraft as returned by `f`
+template<class F>
+void RecColumn (F f)
+{
+    for (const mapAcTy::value_type& pair : glob.mapAc)
+        RecPut(f(*pair.second));
+}
+
+// Record a create, model change, or destroy event if recording
+void RecordAcEvent (const Aircraft& ac, XPMPPlaneNotification _notification)
+{
+    if (!gRec.f.is_open())
+        return;
+    
+    switch (_notification) {
+        case xpmp_PlaneNotification_Created:
+        case xpmp_PlaneNotification_ModelChanged:
+            RecPut(_notification == xpmp_PlaneNotification_Created ? REC_CREATE : REC_MODEL);
+            RecPut(uint32_t(ac.GetModeS_ID()));
+            RecPutStr(ac.acIcaoType);
+            RecPutStr(ac.acIcaoAirline);
+            RecPutStr(ac.acLivery);
+            RecPutStr(ac.GetModelName());
+            break;
+        case xpmp_PlaneNotification_Destroyed:
+            RecPut(REC_DESTROY);
+            RecPut(uint32_t(ac.GetModeS_ID()));
+            gRec.mapInfo.erase(ac.GetModeS_ID());
+            break;
+    }
+}
+
+// Records the state of all aircraft if recording
+void RecordFrame (float _now)
+{
+    if (!gRec.f.is_open())
+        return;
+    
+    // Informational texts and label are recorded only when changed
+    for (const mapAcTy::value_type& pair : glob.mapAc) {
+        const Aircraft& ac = *pair.second;
+        auto& last = gRec.mapInfo[ac.GetModeS_ID()];
+        if (std::memcmp(&last.first, &ac.acInfoTexts, sizeof(XPMPInfoTexts_t)) != 0 ||
+            last.second != ac.label)
+        {
+            std::memcpy(&last.first, &ac.acInfoTexts, sizeof(XPMPInfoTexts_t));
+            last.second = ac.label;
+            RecPut(REC_INFO);
+            RecPut(uint32_t(ac.GetModeS_ID()));
+            RecPut(ac.acInfoTexts);
+            RecPutStr(ac.label);
+        }
+    }
+    
+    // The frame record, column by column
+    RecPut(REC_FRAME);
+    RecPut(_now);
+    RecPut(uint32_t(glob.mapAc.size()));
+    RecColumn([](const Aircraft& ac){ return uint32_t(ac.GetModeS_ID()); });
+    RecColumn([](const Aircraft& ac){ return ac.drawInfo.x; });
+    RecColumn([](const Aircraft& ac){ return ac.drawInfo.y; });
+    RecColumn([](const Aircraft& ac){ return ac.drawInfo.z; });
+    RecColumn([](const Aircraft& ac){ return ac.drawInfo.pitch; });
+    RecColumn([](const Aircraft& ac){ return ac.drawInfo.heading; });
+    RecColumn([](const Aircraft& ac){ return ac.drawInfo.roll; });
+    RecColumn([](const Aircraft& ac){ return uint8_t(ac.IsVisible() ? REC_FLAG_VISIBLE : 0); });
+    RecColumn([](const Aircraft& ac){ return int32_t(ac.acRadar.code); });
+    RecColumn([](const Aircraft& ac){ return uint8_t(ac.acRadar.mode); });
+    RecColumn([](const Aircraft& ac){ return uint16_t(ac.v.size()); });
+    for (const mapAcTy::value_type& pair : glob.mapAc) {
+        const char* p = reinterpret_cast<const char*>(pair.second->v.data());
+        gRec.buf.insert(gRec.buf.end(), p, p + pair.second->v.size() * sizeof(float));
+    }
+    
+    // Write the frame in one go
+    gRec.f.write(gRec.buf.data(), std::streamsize(gRec.buf.size()));
+    gRec.buf.clear();
+    gRec.nFrames++;
+}
+
+/// Stop recording, closes the file
+static void RecordStop ()
+{
+    if (!gRec.f.is_open())
+        return;
+    gRec.f.write(gRec.buf.data(), std::streamsize(gRec.buf.size()));
+    gRec.f.close();
+    LOG_MSG(logINFO, INFO_REC_STOP, gRec.nFrames);
+    gRec.buf.clear();
+    gRec.mapInfo.clear();
+    gRec.nFrames = 0;
+}
+
+//
+// MARK: Replaying
+//
+
+/// Aircraft driven by a replay, the state is set directly by the replay
+class ReplayAircraft : public Aircraft {
+public:
+    using Aircraft::Aircraft;
+    /// Nothing to do, ReplayStep() has already set all values
+    void UpdatePosition (float, int) override {}
+};
+
+/// State of the replay
+struct ReplayTy {
+    std::ifstream f;                    ///< recording file
+    std::streamoff fileSize = 0;        ///< size of the recording file
+    bool bMaxSpeed = false;             ///< replay one frame per flight loop instead of original timing?
+    bool bFramePending = false;         ///< next frame's header is read, waiting for its time to come
+    float tsFrame = 0.0f;               ///< recorded timestamp of the pending frame
+    float recTs0 = NAN;                 ///< recorded timestamp of the first replayed frame
+    float tsStart = 0.0f;               ///< network time when the first frame got replayed
+    unsigned long nFrames = 0;          ///< number of frames replayed
+    /// Replayed aircraft by recorded id
+    std::map<XPMPPlaneID, std::unique_ptr<ReplayAircraft> > mapAc;
+    std::vector<ReplayAircraft*> vecAc; ///< aircraft of the current frame in column order, `nullptr` if unknown
+    std::vector<uint16_t> vecNumV;      ///< number of \`v\` values per aircraft of the current frame
+    std::vector<char> colBuf;           ///< buffer for reading a column
+};
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wexit-time-destructors"
+#pragma clang diagnostic ignored "-Wglobal-constructors"
+/// The replay
+static ReplayTy gRep;
+#pragma clang diagnostic pop
+
+/// Read a value from the replay file
+template<class T>
+bool RepGet (T& val)
+{
+    return bool(gRep.f.read(reinterpret_cast<char*>(&val), sizeof(T)));
+}
+
+/// Read a string from the replay file
+static bool RepGetStr (std::string& s)
+{
+    uint16_t len = 0;
+    if (!RepGet(len)) return false;
+    s.resize(len);
+    return len == 0 || bool(gRep.f.read(&s[0], len));
+}
+
+/// Read one column of a frame record and apply it to the aircraft
+template<class T, class F>
+bool RepColumn (F apply)
+{
+    const size_t n = gRep.vecAc.size();
+    gRep.colBuf.resize(n * sizeof(T));
+    if (!gRep.f.read(gRep.colBuf.data(), std::streamsize(gRep.colBuf.size())))
+        return false;
+    for (size_t i = 0; i < n; ++i) {
+        if (ReplayAircraft* pAc = gRep.vecAc[i]) {
+            T val;
+            std::memcpy(&val, gRep.colBuf.data() + i * sizeof(T), sizeof(T));
+            apply(*pAc, val);
+        }
+    }
+    return true;
+}
+
+/// Return the replayed aircraft with the recorded id, `nullptr` if none
+static ReplayAircraft* ReplayFindAc (uint32_t id)
+{
+    auto iter = gRep.mapAc.find(XPMPPlaneID(id));
+    return iter == gRep.mapAc.end() ? nullptr : iter->second.get();
+}
+
+/// Read and apply a create, model change, destroy, or info event
+static bool ReplayEvent (RecTypeTy recType)
+{
+    uint32_t id = 0;
+    if (!RepGet(id)) return false;
+    switch (recType) {
+        case REC_CREATE:
+        case REC_MODEL:
+        {
+            std::string icaoType, icaoAirline, livery, modelName;
+            if (!RepGetStr(icaoType) || !RepGetStr(icaoAirline) ||
+                !RepGetStr(livery)   || !RepGetStr(modelName))
+                return false;
+            if (recType == REC_CREATE) {
+                gRep.mapAc.erase(XPMPPlaneID(id));
+                try {
+                    std::unique_ptr<ReplayAircraft> pAc =
+                    std::make_unique<ReplayAircraft>(icaoType, icaoAirline, livery,
+                                                     XPMPPlaneID(id), modelName);
+                    pAc->vertOfsRatio = 0.0f;       // recorded positions include the vertical offset already
+                    gRep.mapAc.emplace(XPMPPlaneID(id), std::move(pAc));
+                }
+                catch (const std::exception& e) {
+                    LOG_MSG(logWARN, WARN_REPLAY_CREATE, id, e.what());
+                }
+            }
+            else if (ReplayAircraft* pAc = ReplayFindAc(id)) {
+                // Try the exact model first, only if not available let matching decide
+                if (!pAc->AssignModel(modelName))
+                    pAc->ChangeModel(icaoType, icaoAirline, livery);
+            }
+            return true;
+        }
+        case REC_DESTROY:
+            gRep.mapAc.erase(XPMPPlaneID(id));
+            return true;
+        case REC_INFO:
+        {
+            XPMPInfoTexts_t infoTexts;
+            std::string label;
+            if (!RepGet(infoTexts) || !RepGetStr(label))
+                return false;
+            if (ReplayAircraft* pAc = ReplayFindAc(id)) {
+                pAc->acInfoTexts = infoTexts;
+                pAc->label = label;
+            }
+            return true;
+        }
+        case REC_FRAME:
+            break;
+    }
+    return false;
+}
+
+/// Read and apply events until the next frame's header, `false` if end of file or error
+static bool ReplayReadUntilFrame ()
+{
+    gRep.bFramePending = false;
+    uint8_t recType = 0;
+    while (RepGet(recType)) {
+        switch (recType) {
+            case REC_FRAME:
+                if (!RepGet(gRep.tsFrame)) return false;
+                gRep.bFramePending = true;
+                return true;
+            case REC_CREATE:
+            case REC_MODEL:
+            case REC_DESTROY:
+            case REC_INFO:
+                if (!ReplayEvent(RecTypeTy(recType))) return false;
+                break;
+            default:
+                LOG_MSG(logERR, ERR_REPLAY_RECORD, unsigned(recType));
+                return false;
+        }
+    }
+    return false;
+}
+
+/// Read the pending frame's columns and apply them to the aircraft
+static bool ReplayFrame ()
+{
+    // Which aircraft are in this frame?
+    uint32_t n = 0;
+    if (!RepGet(n)) return false;
+    // Don't trust the count of a corrupt file, the frame must fit into the rest of the file
+    const std::streamoff pos = gRep.f.tellg();
+    if (pos < 0 || double(n) * double(REC_FRAME_MIN_PER_AC) > double(gRep.fileSize - pos)) {
+        LOG_MSG(logERR, ERR_REPLAY_FRAME_SIZE, n);
+        return false;
+    }
+    gRep.vecAc.resize(n);
+    gRep.colBuf.resize(n * sizeof(uint32_t));
+    if (!gRep.f.read(gRep.colBuf.data(), std::streamsize(gRep.colBuf.size())))
+        return false;
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t id;
+        std::memcpy(&id, gRep.colBuf.data() + i * sizeof(id), sizeof(id));
+        gRep.vecAc[i] = ReplayFindAc(id);
+    }
+    
+    // Read all columns
+    if (!RepColumn<float>([](Aircraft& ac, float f){ ac.drawInfo.x = f; }) ||
+        !RepColumn<float>([](Aircraft& ac, float f){ ac.drawInfo.y = f; }) ||
+        !RepColumn<float>([](Aircraft& ac, float f){ ac.drawInfo.z = f; }) ||
+        !RepColumn<float>([](Aircraft& ac, float f){ ac.drawInfo.pitch = f; }) ||
+        !RepColumn<float>([](Aircraft& ac, float f){ ac.drawInfo.heading = f; }) ||
+        !RepColumn<float>([](Aircraft& ac, float f){ ac.drawInfo.roll = f; }) ||
+        !RepColumn<uint8_t>([](Aircraft& ac, uint8_t flags){ ac.SetVisible((flags & REC_FLAG_VISIBLE) != 0); }) ||
+        !RepColumn<int32_t>([](Aircraft& ac, int32_t code){ ac.acRadar.code = code; }) ||
+        !RepColumn<uint8_t>([](Aircraft& ac, uint8_t mode){ ac.acRadar.mode = XPMPTransponderMode(mode); }))
+        return false;
+    // Number of `v` values per aircraft (read for all, also unknown aircraft, to be able to skip their values)
+    std::vector<uint16_t>& vecNumV = gRep.vecNumV;
+    vecNumV.resize(n);
+    if (!gRep.f.read(reinterpret_cast<char*>(vecNumV.data()), std::streamsize(n * sizeof(uint16_t))))
+        return false;
+    for (size_t i = 0; i < n; ++i) {
+        gRep.colBuf.resize(vecNumV[i] * sizeof(float));
+        if (!gRep.f.read(gRep.colBuf.data(), std::streamsize(gRep.colBuf.size())))
+            return false;
+        if (ReplayAircraft* pAc = gRep.vecAc[i])
+            std::memcpy(pAc->v.data(), gRep.colBuf.data(),
+                        std::min<size_t>(vecNumV[i], pAc->v.size()) * sizeof(float));
+    }
+    
+    gRep.nFrames++;
+    return true;
+}
+
+/// Stop replaying, removes all replayed aircraft
+static void ReplayStop ()
+{
+    if (!gRep.f.is_open())
+        return;
+    gRep.f.close();
+    gRep.mapAc.clear();
+    gRep.vecAc.clear();
+    gRep.bFramePending = false;
+    gRep.recTs0 = NAN;
+    LOG_MSG(logINFO, INFO_REPLAY_STOP, gRep.nFrames);
+    gRep.nFrames = 0;
+}
+
+// Drives replayed aircraft if replaying
+void ReplayStep (float _now)
+{
+    if (!gRep.f.is_open())
+        return;
+    
+    // First frame defines the time base
+    if (std::isnan(gRep.recTs0)) {
+        gRep.recTs0 = gRep.tsFrame;
+        gRep.tsStart = _now;
+    }
+    
+    // Apply all frames that are due, at maximum speed exactly one per flight loop
+    try {
+        while (gRep.bFramePending &&
+               (gRep.bMaxSpeed || gRep.tsFrame - gRep.recTs0 <= _now - gRep.tsStart))
+        {
+            if (!ReplayFrame() || !ReplayReadUntilFrame()) {
+                ReplayStop();               // end of recording
+                return;
+            }
+            if (gRep.bMaxSpeed)
+                break;
+        }
+    }
+    // Don't try again with the next frame, that would likely just fail again
+    catch (const std::exception& e) {
+        LOG_MSG(logERR, ERR_REPLAY_EXCEPTION, e.what());
+        ReplayStop();
+    }
+}
+
+// Is a replay currently active?
+bool ReplayIsActive ()
+{
+    return gRep.f.is_open();
+}
+
+// Grace cleanup, stops recording and replaying
+void RecordCleanup ()
+{
+    RecordStop();
+    ReplayStop();
+}
+
+}       // namespace XPMP2
+
+//
+// MARK: Public functions
+//
+
+using namespace XPMP2;
+
+// Start recording all aircraft input into a file
+const char* XPMPStartRecording (const char* inFileName)
+{
+    RecordStop();
+    gRec.f.open(inFileName, std::ios::binary | std::ios::trunc);
+    if (!gRec.f) {
+        LOG_MSG(logERR, ERR_REC_OPEN, inFileName);
+        return "Could not open recording file";
+    }
+    gRec.f.write(REC_MAGIC, sizeof(REC_MAGIC)-1);
+    gRec.f.write(reinterpret_cast<const char*>(&REC_VERSION), sizeof(REC_VERSION));
+    LOG_MSG(logINFO, INFO_REC_START, inFileName);
+    
+    // Existing aircraft are recorded as if created now
+    for (const mapAcTy::value_type& pair : glob.mapAc)
+        RecordAcEvent(*pair.second, xpmp_PlaneNotification_Created);
+    return "";
+}
+
+// Stop recording
+void XPMPStopRecording ()
+{
+    RecordStop();
+}
+
+// Start replaying a recording
+const char* XPMPStartReplay (const char* inFileName, bool inMaxSpeed)
+{
+    ReplayStop();
+    gRep.f.open(inFileName, std::ios::binary);
+    if (!gRep.f) {
+        LOG_MSG(logERR, ERR_REPLAY_OPEN, inFileName);
+        return "Could not open recording file";
+    }
+    gRep.f.seekg(0, std::ios::end);
+    gRep.fileSize = gRep.f.tellg();
+    gRep.f.seekg(0, std::ios::beg);
+    
+    // Verify file header
+    char magic[sizeof(REC_MAGIC)-1];
+    uint32_t ver = 0;
+    if (!gRep.f.read(magic, sizeof(magic)) || !RepGet(ver) ||
+        std::memcmp(magic, REC_MAGIC, sizeof(magic)) != 0 ||
+        ver != REC_VERSION)
+    {
+        LOG_MSG(logERR, ERR_REPLAY_FORMAT, inFileName, REC_VERSION);
+        gRep.f.close();
+        return "Not an XPMP2 recording";
+    }
+    gRep.bMaxSpeed = inMaxSpeed;
+    LOG_MSG(logINFO, INFO_REPLAY_START, inFileName, inMaxSpeed ? "maximum" : "original");
+
+    // Read up to the first frame. Skip leading frames without any aircraft,
+    // creating the first aircraft also starts the flight loop, which then drives the replay.
+    bool bOK = ReplayReadUntilFrame();
+    while (bOK && gRep.mapAc.empty())
+        bOK = ReplayFrame() && ReplayReadUntilFrame();
+    if (!bOK) {
+        LOG_MSG(logERR, ERR_REPLAY_NO_AC, inFileName);
+        ReplayStop();
+        return "Recording contains no aircraft";
+    }
+    return "";
+}
+
+// Stop replaying, removes all replayed aircraft
+void XPMPStopReplay ()
+{
+    ReplayStop();
+}
@@ -0,0 +1,43 @@
+/// @file       Record.h
+/// @brief      Recording of all aircraft input per frame into a binary file, and replaying it
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#ifndef _Record_h_
+#define _Record_h_
+
+namespace XPMP2 {
+
+/// Record a create, model change, or destroy event if recording
+void RecordAcEvent (const Aircraft& ac, XPMPPlaneNotification _notification);
+
+/// Called at the end of the flight loop: Records the state of all aircraft if recording
+void RecordFrame (float _now);
+
+/// Called early in the flight loop: Drives replayed aircraft if replaying
+void ReplayStep (float _now);
+
+/// Is a replay currently active? (Keeps the flight loop running even without aircraft)
+bool ReplayIsActive ();
+
+/// Grace cleanup, stops recording and replaying
+void RecordCleanup ();
+
+}       // namespace XPMP2
+
+#endif
@@ -61,6 +61,7 @@ const char* RelatedLoad (const std::string& _path)
     // Open the related.txt file
     LOG_MSG(logDEBUG, DEBUG_READ_RELATED, StripXPSysDir(_path).c_str());
     std::ifstream fRelated (_path);
+    ProfileFile(fRelated);
     if (!fRelated || !fRelated.is_open())
         return ERR_RELATED_NOT_FOUND;
     
@@ -137,6 +138,7 @@ const char* Doc8643Load (const std::string& _path)
     
     // open the file for reading
     std::ifstream fIn (_path);
+    ProfileFile(fIn);
     if (!fIn || !fIn.is_open())
         return ERR_DOC8643_NOT_FOUND;
     LOG_MSG(logDEBUG, DEBUG_READ_DOC8643, StripXPSysDir(_path).c_str());
@@ -218,6 +220,7 @@ const char* Obj8DataRefsLoad (const std::string& _path)
     // Open the Obj8DataRefs.txt file
     LOG_MSG(logDEBUG, DEBUG_READ_OBJ8DR, StripXPSysDir(_path).c_str());
     std::ifstream fObjDR (_path);
+    ProfileFile(fObjDR);
     if (!fObjDR || !fObjDR.is_open())
         return ERR_OBJ8DR_NOT_FOUND;
     
@@ -0,0 +1,146 @@
+/// @file       Rematch.cpp
+/// @brief      Re-matches existing aircraft after models have been added to the catalog
+/// @details    When CSL packages are loaded or reloaded while aircraft exist,
+///             these aircraft would keep their models matched from the smaller catalog.
+///             Instead of matching all of them again, only the newly added models
+///             are compared to each aircraft's type, airline, and livery.
+///             Only if they achieve a better match quality than the current one
+///             the aircraft is matched again against the full catalog.\n
+///             Results are cached per type/airline/livery combination,
+///             and the work is spread over several frames.
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#include "XPMP2.h"
+
+#define INFO_REMATCH_START      "%lu models added, checking %lu aircraft for better matches"
+#define INFO_REMATCH_DONE       "Re-match done: %lu of %lu aircraft checked switch to better models"
+
+namespace XPMP2 {
+
+/// How many aircraft to check per frame at most
+constexpr size_t REMATCH_CHECKS_PER_FRAME = 100;
+/// How many aircraft to actually match again per frame at most
+constexpr size_t REMATCH_MATCHES_PER_FRAME = 5;
+
+/// Number of aircraft checked in the current run
+static size_t gnRematchChecked = 0;
+/// Number of aircraft switching to a better model in the current run
+static size_t gnRematchUpgraded = 0;
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wexit-time-destructors"
+#pragma clang diagnostic ignored "-Wglobal-constructors"
+/// Models added, which existing aircraft are still to be checked against
+static std::vector<CSLModel*> gVecRematchMdl;
+/// Aircraft still to be checked
+static std::vector<XPMPPlaneID> gVecRematchAc;
+/// Best quality the added models achieve per "type|airline|livery" key
+static std::unordered_map<std::string,int> gMapRematchQual;
+#pragma clang diagnostic pop
+
+// Models have been added to the catalog: Check all existing aircraft
+void RematchQueue (std::vector<CSLModel*>&& vecMdl)
+{
+    // Without aircraft there is nothing to improve
+    if (glob.mapAc.empty()) {
+        RematchCleanup();
+        return;
+    }
+    if (vecMdl.empty())
+        return;
+    
+    // Add to the models of a run still in progress,
+    // then all aircraft need to be checked (again)
+    if (gVecRematchMdl.empty())
+        gVecRematchMdl.swap(vecMdl);
+    else
+        gVecRematchMdl.insert(gVecRematchMdl.end(), vecMdl.begin(), vecMdl.end());
+    gMapRematchQual.clear();
+    gVecRematchAc.clear();
+    gVecRematchAc.reserve(glob.mapAc.size());
+    for (const mapAcTy::value_type& pair: glob.mapAc)
+        gVecRematchAc.push_back(pair.first);
+    gnRematchChecked = gnRematchUpgraded = 0;
+    LOG_MSG(logINFO, INFO_REMATCH_START,
+            (unsigned long)gVecRematchMdl.size(), (unsigned long)gVecRematchAc.size());
+}
+
+// Check some more aircraft
+void RematchFrame ()
+{
+    if (gVecRematchAc.empty())
+        return;
+    
+    size_t nMatched = 0;
+    for (size_t nChecked = 0;
+         nChecked < REMATCH_CHECKS_PER_FRAME &&
+         nMatched < REMATCH_MATCHES_PER_FRAME &&
+         !gVecRematchAc.empty();
+         ++nChecked)
+    {
+        const XPMPPlaneID id = gVecRematchAc.back();
+        gVecRematchAc.pop_back();
+        mapAcTy::iterator iter = glob.mapAc.find(id);
+        if (iter == glob.mapAc.end() || !iter->second->IsValid())
+            continue;                   // aircraft no longer exists
+        Aircraft& ac = *iter->second;
+        ++gnRematchChecked;
+        
+        // Can any of the new models improve the current match?
+        // (Without any model the aircraft surely needs matching.)
+        if (ac.GetModel()) {
+            const std::string key = ac.acIcaoType + '|' + ac.acIcaoAirline + '|' + ac.acLivery;
+            auto qIter = gMapRematchQual.find(key);
+            if (qIter == gMapRematchQual.end())
+                qIter = gMapRematchQual.emplace(key,
+                                                CSLModelsMatchQuality(ac.acIcaoType,
+                                                                      ac.acIcaoAirline,
+                                                                      ac.acLivery,
+                                                                      gVecRematchMdl)).first;
+            if (qIter->second >= ac.GetMatchQuality())
+                continue;
+        }
+        
+        // Match against the full catalog, switches once the better model is loaded
+        ++nMatched;
+        try {
+            if (ac.UpgradeModel())
+                ++gnRematchUpgraded;
+        }
+        CATCH_AC(ac)
+    }
+    
+    // All done?
+    if (gVecRematchAc.empty()) {
+        LOG_MSG(logINFO, INFO_REMATCH_DONE,
+                (unsigned long)gnRematchUpgraded, (unsigned long)gnRematchChecked);
+        RematchCleanup();
+    }
+}
+
+// Grace cleanup, forgets any pending checks
+void RematchCleanup ()
+{
+    gVecRematchMdl.clear();
+    gVecRematchAc.clear();
+    gMapRematchQual.clear();
+    gnRematchChecked = gnRematchUpgraded = 0;
+}
+
+}       // namespace XPMP2
@@ -0,0 +1,42 @@
+/// @file       Rematch.h
+/// @brief      Re-matches existing aircraft after models have been added to the catalog
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#ifndef _Rematch_h_
+#define _Rematch_h_
+
+namespace XPMP2 {
+
+/// @brief Models have been added to the catalog: Check all existing aircraft if they can get a better match
+/// @details The check is spread over the following frames, see RematchFrame().
+/// @param vecMdl The newly added models, usually from CSLCatalogTy::TakeAdded()
+void RematchQueue (std::vector<CSLModel*>&& vecMdl);
+
+/// @brief Check some more aircraft, called once per frame from the aircraft flight loop
+/// @details Only aircraft, for which the new models achieve a better match quality,
+///          are actually matched again. Aircraft::UpgradeModel() then keeps
+///          showing the current model until the better one is loaded.
+void RematchFrame ();
+
+/// Grace cleanup, forgets any pending checks
+void RematchCleanup ();
+
+}       // namespace XPMP2
+
+#endif
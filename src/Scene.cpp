@@ -0,0 +1,362 @@
+/// @file       Scene.cpp
+/// @brief      Snapshot and restore of the entire XPMP2 scene
+/// @details    When a plugin reloads, all aircraft are destroyed and re-created,
+///             which means full model matching, instance creation, and lost
+///             TCAS slots. A snapshot taken before the reload keeps all this
+///             information in a compact binary blob. After the reload,
+///             the plugin hands the blob back via XPMPSceneRestore() and
+///             re-creates its aircraft with the same plane ids.
+///             These aircraft then take over position, dataRef values,
+///             texts and TCAS slot from the snapshot, and also the model
+///             as long as type, airline, and livery passed to the constructor are unchanged. Instance creation
+///             is spread over several frames to avoid a stutter.
+/// @note       The blob is meant to survive a plugin reload only. It is not
+///             a file format for long-term storage or for exchange between
+///             different platforms or XPMP2 versions.
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#include "XPMP2.h"
+
+#include <cstring>
+
+#define INFO_SCENE_SNAPSHOT     "Scene snapshot taken of %lu aircraft, %lu bytes"
+#define INFO_SCENE_RESTORE      "Scene restore data available for %lu aircraft"
+#define WARN_SCENE_TIMEOUT      "Scene restore: %lu aircraft not re-created in time, restore data discarded"
+#define WARN_SCENE_NO_MODEL     "Aircraft 0x%06X: Model '%s' from scene snapshot no longer available, will match again"
+#define DEBUG_SCENE_NEW_IDENT   "Aircraft 0x%06X: Type, airline, or livery differ from scene snapshot, will match again"
+#define DEBUG_SCENE_RESTORED    "Aircraft 0x%06X: Restored from scene snapshot with model %s"
+#define ERR_SCENE_BLOB_EMPTY    "Scene blob is empty"
+#define ERR_SCENE_BLOB_HEADER   "Scene blob header invalid or from different XPMP2 version"
+#define ERR_SCENE_BLOB_CORRUPT  "Scene blob corrupt"
+
+namespace XPMP2 {
+
+/// Identifies a scene blob
+constexpr uint32_t SCENE_MAGIC = 0x4E435358;     // "XSCN"
+/// Version of the blob format, increase with any change to the layout
+constexpr uint16_t SCENE_VER   = 1;
+/// How long to keep restore data for aircraft, which are not re-created? [s]
+constexpr float SCENE_RESTORE_TIMEOUT = 60.0f;
+
+/// Everything we keep about one aircraft in a snapshot
+struct SceneAcTy {
+    std::string         mdlKey;             ///< key of the CSL model, see CSLModel::GetKeyString()
+    std::string         acIcaoType;         ///< ICAO aircraft type
+    std::string         acIcaoAirline;      ///< ICAO airline code
+    std::string         acLivery;           ///< livery
+    int32_t             matchQuality = -1;  ///< match quality
+    XPLMDrawInfo_t      drawInfo;           ///< position and attitude
+    std::vector<float>  v;                  ///< dataRef values
+    std::string         label;              ///< label
+    float               colLabel[4];        ///< label color
+    int32_t             aiPrio = 1;         ///< priority for TCAS slots
+    XPMPPlaneRadar_t    acRadar;            ///< radar status
+    XPMPInfoTexts_t     acInfoTexts;        ///< informational texts
+    int32_t             tcasTargetIdx = -1; ///< TCAS slot
+    float               camDist = 0.0f;     ///< distance to camera, defines TCAS slot ordering
+    float               camBearing = 0.0f;  ///< bearing from camera
+    bool                bVisible = true;    ///< visibility
+};
+
+/// Map of restore data, indexed by plane id
+typedef std::map<XPMPPlaneID,SceneAcTy> mapSceneAcTy;
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wexit-time-destructors"
+/// Restore data waiting for aircraft to be re-created
+static mapSceneAcTy gMapSceneAc;
+#pragma clang diagnostic pop
+
+/// When did we receive the restore data? (in XP's network time)
+static float gSceneRestoreTs = 0.0f;
+/// Max number of aircraft creating instances per frame, `0` if unlimited
+static int gInstBudget = 0;
+/// Number of aircraft, which created instances in this frame
+static int gInstCreated = 0;
+/// Did we have to deny instance creation in this frame?
+static bool gbInstDeferred = false;
+
+//
+// MARK: Blob serialization helpers
+//
+
+/// Appends a plain value to the blob
+template<class T>
+static void SceneWrite (std::vector<uint8_t>& blob, const T& val)
+{
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&val);
+    blob.insert(blob.end(), p, p + sizeof(T));
+}
+
+/// Appends a string (length-prefixed) to the blob
+static void SceneWriteStr (std::vector<uint8_t>& blob, const std::string& s)
+{
+    const uint16_t len = (uint16_t)std::min<size_t>(s.size(), UINT16_MAX);
+    SceneWrite(blob, len);
+    blob.insert(blob.end(), s.cbegin(), s.cbegin() + len);
+}
+
+/// Reads sequentially from a blob, remembers if it ran out of data
+class SceneReader {
+protected:
+    const std::vector<uint8_t>& blob;       ///< the blob we read from
+    size_t pos = 0;                         ///< current read position
+    bool bOK = true;                        ///< all reads successful so far?
+public:
+    /// Constructor takes the blob to read from
+    SceneReader (const std::vector<uint8_t>& _blob) : blob(_blob) {}
+    /// All reads successful so far?
+    operator bool () const { return bOK; }
+    /// Reached the end of the blob?
+    bool AtEnd () const { return pos >= blob.size(); }
+
+    /// Reads a plain value
+    template<class T>
+    SceneReader& Read (T& val)
+    {
+        if (bOK && pos + sizeof(T) <= blob.size()) {
+            memcpy(&val, blob.data() + pos, sizeof(T));
+            pos += sizeof(T);
+        } else
+            bOK = false;
+        return *this;
+    }
+
+    /// Reads a length-prefixed string
+    SceneReader& ReadStr (std::string& s)
+    {
+        uint16_t len = 0;
+        if (Read(len) && pos + len <= blob.size()) {
+            s.assign(reinterpret_cast<const char*>(blob.data() + pos), len);
+            pos += len;
+        } else
+            bOK = false;
+        return *this;
+    }
+};
+
+//
+// MARK: Internal functions
+//
+
+// Applies pending restore data (if any) to a just created aircraft
+bool SceneRestoreAc (Aircraft& ac,
+                     const std::string& _icaoType,
+                     const std::string& _icaoAirline,
+                     const std::string& _livery,
+                     const std::string& _modelName)
+{
+    mapSceneAcTy::iterator iter = gMapSceneAc.find(ac.GetModeS_ID());
+    if (iter == gMapSceneAc.end())
+        return false;
+    const SceneAcTy& sac = iter->second;
+
+    // Take over the model directly by its key, no matching needed,
+    // but only if the plane still is what it was when the snapshot was taken
+    bool bMdl = false;
+    CSLModel* pMdl = CSLModelByKey(sac.mdlKey);
+    if (sac.acIcaoType      != _icaoType    ||
+        sac.acIcaoAirline   != _icaoAirline ||
+        sac.acLivery        != _livery      ||
+        (pMdl && !_modelName.empty() && pMdl->GetModelName() != _modelName))
+    {
+        LOG_MSG(logDEBUG, DEBUG_SCENE_NEW_IDENT, ac.GetModeS_ID());
+    }
+    else if (pMdl && !pMdl->IsObjInvalid()) {
+        ac.pCSLMdl          = pMdl;
+        ac.pCSLMdl->IncRefCnt();
+        ac.matchQuality     = sac.matchQuality;
+        ac.acIcaoType       = _icaoType;
+        ac.acIcaoAirline    = _icaoAirline;
+        ac.acLivery         = _livery;
+        ac.acRelGrp         = RelatedGet(ac.acIcaoType);
+        ac.MapFindIcon();
+        bMdl = true;
+        LOG_MSG(logDEBUG, DEBUG_SCENE_RESTORED, ac.GetModeS_ID(),
+                ac.pCSLMdl->GetModelName().c_str());
+    } else {
+        LOG_MSG(logWARN, WARN_SCENE_NO_MODEL, ac.GetModeS_ID(), sac.mdlKey.c_str());
+    }
+
+    // Take over the dynamic data
+    ac.drawInfo         = sac.drawInfo;
+    if (sac.v.size() == ac.v.size())        // only if the set of dataRefs is unchanged
+        ac.v.assign(sac.v.data(), sac.v.data() + sac.v.size());
+    ac.label            = sac.label;
+    memmove(ac.colLabel, sac.colLabel, sizeof(ac.colLabel));
+    ac.aiPrio           = sac.aiPrio;
+    ac.acRadar          = sac.acRadar;
+    ac.acInfoTexts      = sac.acInfoTexts;
+    ac.bVisible         = sac.bVisible;
+    // Keeping the TCAS slot and the distance (which defines slot order)
+    // makes slot assignment keep the plane where it was
+    ac.tcasTargetIdx    = sac.tcasTargetIdx;
+    ac.camDist          = sac.camDist;
+    ac.camBearing       = sac.camBearing;
+
+    // restore data is consumed
+    gMapSceneAc.erase(iter);
+    return bMdl;
+}
+
+// Called at the beginning of each flight loop: Resets the instance creation budget
+void SceneFrameStart ()
+{
+    // Restore data outdated? Then we don't expect those aircraft to come back
+    if (!gMapSceneAc.empty() &&
+        GetMiscNetwTime() > gSceneRestoreTs + SCENE_RESTORE_TIMEOUT)
+    {
+        LOG_MSG(logWARN, WARN_SCENE_TIMEOUT, (unsigned long)gMapSceneAc.size());
+        gMapSceneAc.clear();
+    }
+    // Restore done? Then there's no more need to limit instance creation
+    if (gInstBudget > 0 && gMapSceneAc.empty() && !gbInstDeferred)
+        gInstBudget = 0;
+    gInstCreated = 0;
+    gbInstDeferred = false;
+}
+
+// May one more aircraft create its instances in this frame?
+bool SceneInstCreateAllowed ()
+{
+    if (gInstBudget <= 0 || gInstCreated < gInstBudget)
+        return true;
+    gbInstDeferred = true;
+    return false;
+}
+
+// Account for an aircraft, which just created its instances
+void SceneInstCreated ()
+{
+    ++gInstCreated;
+}
+
+// Grace cleanup, removes any pending restore data
+void SceneCleanup ()
+{
+    gMapSceneAc.clear();
+    gInstBudget = 0;
+}
+
+}       // namespace XPMP2
+
+//
+// MARK: Public functions
+//
+
+using namespace XPMP2;
+
+// Serializes all current aircraft into a compact binary blob
+size_t XPMPSceneSnapshot (std::vector<uint8_t>& outBlob)
+{
+    outBlob.clear();
+
+    // Header
+    SceneWrite(outBlob, SCENE_MAGIC);
+    SceneWrite(outBlob, SCENE_VER);
+    SceneWrite(outBlob, (uint16_t)sizeof(XPMPInfoTexts_t));
+    SceneWrite(outBlob, (uint32_t)glob.mapAc.size());
+
+    // One record per aircraft
+    for (const mapAcTy::value_type& pair: glob.mapAc) {
+        const Aircraft& ac = *pair.second;
+        const CSLModel* pMdl = ac.GetModel();
+        SceneWrite(outBlob, (uint32_t)ac.GetModeS_ID());
+        SceneWriteStr(outBlob, pMdl ? pMdl->GetKeyString() : std::string());
+        SceneWriteStr(outBlob, ac.acIcaoType);
+        SceneWriteStr(outBlob, ac.acIcaoAirline);
+        SceneWriteStr(outBlob, ac.acLivery);
+        SceneWrite(outBlob, (int32_t)ac.GetMatchQuality());
+        SceneWrite(outBlob, ac.drawInfo);
+        SceneWrite(outBlob, (uint16_t)ac.v.size());
+        for (float f: ac.v)
+            SceneWrite(outBlob, f);
+        SceneWriteStr(outBlob, ac.label);
+        SceneWrite(outBlob, ac.colLabel);
+        SceneWrite(outBlob, (int32_t)ac.aiPrio);
+        SceneWrite(outBlob, (int32_t)ac.acRadar.code);
+        SceneWrite(outBlob, (int32_t)ac.acRadar.mode);
+        SceneWrite(outBlob, ac.acInfoTexts);
+        SceneWrite(outBlob, (int32_t)ac.GetTcasTargetIdx());
+        SceneWrite(outBlob, ac.GetCameraDist());
+        SceneWrite(outBlob, ac.GetCameraBearing());
+        SceneWrite(outBlob, (uint8_t)ac.IsVisible());
+    }
+
+    LOG_MSG(logINFO, INFO_SCENE_SNAPSHOT,
+            (unsigned long)glob.mapAc.size(), (unsigned long)outBlob.size());
+    return glob.mapAc.size();
+}
+
+// Provides a previously taken snapshot for restoring aircraft
+const char* XPMPSceneRestore (const std::vector<uint8_t>& inBlob,
+                              int inMaxInstPerFrame)
+{
+    if (inBlob.empty())
+        return ERR_SCENE_BLOB_EMPTY;
+
+    // Verify the header
+    SceneReader rd(inBlob);
+    uint32_t magic = 0, numAc = 0;
+    uint16_t ver = 0, szInfoTexts = 0;
+    rd.Read(magic).Read(ver).Read(szInfoTexts).Read(numAc);
+    if (!rd || magic != SCENE_MAGIC || ver != SCENE_VER ||
+        szInfoTexts != sizeof(XPMPInfoTexts_t))
+        return ERR_SCENE_BLOB_HEADER;
+
+    // Read all aircraft records into a temporary map first,
+    // so that a corrupt blob doesn't leave half the data behind
+    mapSceneAcTy mapSac;
+    for (uint32_t i = 0; i < numAc && rd; ++i) {
+        uint32_t id = 0;
+        SceneAcTy sac;
+        uint16_t numV = 0;
+        int32_t radarCode = 0, radarMode = 0;
+        uint8_t bVisible = 1;
+        rd.Read(id).ReadStr(sac.mdlKey).
+        ReadStr(sac.acIcaoType).ReadStr(sac.acIcaoAirline).ReadStr(sac.acLivery).
+        Read(sac.matchQuality).Read(sac.drawInfo).Read(numV);
+        sac.v.resize(numV);
+        for (float& f: sac.v)
+            rd.Read(f);
+        rd.ReadStr(sac.label).Read(sac.colLabel).Read(sac.aiPrio).
+        Read(radarCode).Read(radarMode).Read(sac.acInfoTexts).
+        Read(sac.tcasTargetIdx).Read(sac.camDist).Read(sac.camBearing).Read(bVisible);
+        sac.acRadar.code = radarCode;
+        sac.acRadar.mode = XPMPTransponderMode(radarMode);
+        sac.bVisible = bVisible != 0;
+        if (rd)
+            mapSac.emplace(XPMPPlaneID(id), std::move(sac));
+    }
+    if (!rd || !rd.AtEnd())
+        return ERR_SCENE_BLOB_CORRUPT;
+
+    // Make the data available for the re-creation of aircraft
+    gMapSceneAc = std::move(mapSac);
+    gSceneRestoreTs = GetMiscNetwTime();
+    gInstBudget = std::max(inMaxInstPerFrame, 0);
+    LOG_MSG(logINFO, INFO_SCENE_RESTORE, (unsigned long)gMapSceneAc.size());
+    return "";
+}
+
+// Discards any restore data not yet used
+void XPMPSceneRestoreDiscard ()
+{
+    SceneCleanup();
+}
@@ -0,0 +1,54 @@
+/// @file       Scene.h
+/// @brief      Snapshot and restore of the entire XPMP2 scene
+/// @details    A snapshot serializes all aircraft into a compact binary blob,
+///             which the plugin can hand back after a reload.
+///             Aircraft re-created with the same plane id then skip model matching.
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#ifndef _Scene_h_
+#define _Scene_h_
+
+namespace XPMP2 {
+
+/// @brief Applies pending restore data (if any) to a just created aircraft
+/// @details The identity passed to the aircraft's constructor is kept.
+///          The snapshot's model is only taken over if type, airline, livery,
+///          and the model name (if given) are the same as when the snapshot was taken.
+/// @return Could the CSL model be assigned from the snapshot, ie. can matching be skipped?
+bool SceneRestoreAc (Aircraft& ac,
+                     const std::string& _icaoType,
+                     const std::string& _icaoAirline,
+                     const std::string& _livery,
+                     const std::string& _modelName);
+
+/// Called at the beginning of each flight loop: Resets the instance creation budget
+void SceneFrameStart ();
+
+/// May one more aircraft create its instances in this frame?
+bool SceneInstCreateAllowed ();
+
+/// Account for an aircraft, which just created its instances
+void SceneInstCreated ();
+
+/// Grace cleanup, removes any pending restore data
+void SceneCleanup ();
+
+}       // namespace XPMP2
+
+#endif
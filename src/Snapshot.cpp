@@ -0,0 +1,145 @@
+/// @file       Snapshot.cpp
+/// @brief      Per-frame, immutable snapshot of all aircraft states for readers on other threads
+/// @details    Reading XPMP2::Aircraft objects from other threads races with the flight loop.
+///             Instead, the flight loop copies the state of all aircraft into
+///             one of three buffers once per frame and then publishes that buffer's index.\n
+///             Readers pin the latest buffer by incrementing its reader counter and
+///             then re-checking that it is still the latest.
+///             The flight loop only ever writes into a buffer, which is neither
+///             the latest nor pinned by any reader. If there is no such buffer,
+///             it skips publishing for this frame rather than waiting.
+///             So neither side ever blocks the other.
+/// @author     Birger Hoppe
+/// @copyright  (c) 2020 Birger Hoppe
+/// @copyright  Permission is hereby granted, free of charge, to any person obtaining a
+///             copy of this software and associated documentation files (the "Software"),
+///             to deal in the Software without restriction, including without limitation
+///             the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///             and/or sell copies of the Software, and to permit persons to whom the
+///             Software is furnished to do so, subject to the following conditions:\n
+///             The above copyright notice and this permission notice shall be included in
+///             all copies or substantial portions of the Software.\n
+///             THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///             IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///             FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///             AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///             LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///             OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///             THE SOFTWARE.
+
+#include "XPMP2.h"
+
+namespace XPMP2 {
+
+/// Number of snapshot buffers
+constexpr int SNAP_NUM_BUF = 3;
+
+/// One snapshot buffer
+struct SnapBufTy {
+    std::vector<XPMPAcState_t> vecAc;   ///< states of all aircraft
+    float ts = 0.0f;                    ///< network time of the snapshot
+    std::atomic<int> nReaders{0};       ///< number of readers currently copying from this buffer
+};
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wexit-time-destructors"
+#pragma clang diagnostic ignored "-Wglobal-constructors"
+/// The snapshot buffers
+static std::array<SnapBufTy, SNAP_NUM_BUF> gSnapBuf;
+#pragma clang diagnostic pop
+
+/// Index of the latest published buffer, `-1` if none
+static std::atomic<int> gSnapLatest{-1};
+/// Has anyone asked for a snapshot yet? Only then we spend time on publishing
+static std::atomic<bool> gbSnapWanted{false};
+
+/// Fill a buffer with the current state of all aircraft
+static void SnapshotFill (SnapBufTy& buf, float _now)
+{
+    buf.ts = _now;
+    buf.vecAc.resize(glob.mapAc.size());
+    size_t i = 0;
+    for (const mapAcTy::value_type& pair : glob.mapAc) {
+        const Aircraft& ac = *pair.second;
+        XPMPAcState_t& st = buf.vecAc[i++];
+        st.id               = ac.GetModeS_ID();
+        ac.GetLocation(st.lat, st.lon, st.alt_ft);
+        const XPLMDrawInfo_t& di = ac.GetLocation();
+        st.x                = di.x;
+        st.y                = di.y;
+        st.z                = di.z;
+        st.pitch            = di.pitch;
+        st.heading          = di.heading;
+        st.roll             = di.roll;
+        st.gearRatio        = ac.GetGearRatio();
+        st.flapRatio        = ac.GetFlapRatio();
+        st.speedbrakeRatio  = ac.GetSpeedbrakeRatio();
+        st.thrustRatio      = ac.GetThrustRatio();
+        st.lightsTaxi       = ac.GetLightsTaxi();
+        st.lightsLanding    = ac.GetLightsLanding();
+        st.lightsBeacon     = ac.GetLightsBeacon();
+        st.lightsStrobe     = ac.GetLightsStrobe();
+        st.lightsNav        = ac.GetLightsNav();
+        st.bVisible         = ac.IsVisible();
+        st.bRendered        = ac.IsRenderAdmitted();
+        STRCPY_S(st.cslModel, ac.GetModelName().c_str());
+    }
+}
+
+// Publishes a new snapshot if anyone has asked for one
+void SnapshotPublish (float _now)
+{
+    if (!gbSnapWanted)
+        return;
+    
+    // Find a buffer, which is neither the latest nor being read
+    const int latest = gSnapLatest;
+    for (int i = 0; i < SNAP_NUM_BUF; ++i) {
+        if (i == latest || gSnapBuf[size_t(i)].nReaders > 0)
+            continue;
+        SnapshotFill(gSnapBuf[size_t(i)], _now);
+        gSnapLatest = i;
+        return;
+    }
+    // All busy: skip this frame, readers get the previous snapshot
+}
+
+// Stops publishing and frees the buffers
+void SnapshotCleanup ()
+{
+    gbSnapWanted = false;
+    gSnapLatest = -1;
+    for (SnapBufTy& buf : gSnapBuf)
+        buf.vecAc = std::vector<XPMPAcState_t>();
+}
+
+}       // namespace XPMP2
+
+//
+// MARK: Public functions
+//
+
+using namespace XPMP2;
+
+// Copies the aircraft snapshot of the last frame, callable from any thread
+bool XPMPGetAircraftSnapshot (std::vector<XPMPAcState_t>& outStates, float* outTs)
+{
+    gbSnapWanted = true;
+    for (;;) {
+        const int i = gSnapLatest;
+        if (i < 0)
+            return false;
+        // Pin the buffer, then verify it is still the latest,
+        // otherwise the flight loop might already be writing into it
+        SnapBufTy& buf = gSnapBuf[size_t(i)];
+        ++buf.nReaders;
+        if (gSnapLatest == i) {
+            outStates = buf.vecAc;
+            if (outTs) *outTs = buf.ts;
+            --buf.nReaders;
+            return true;
+        }
+        // A newer snapshot got published in between, try that one
+        --buf.nReaders;
+    }
+}
@@ -83,15 +83,38 @@ void GlobVars::UpdateCfgVals ()
     // Ask for replacing textures in OBJ8 files
     bObjReplTextures = prefsFuncInt(XPMP_CFG_SEC_MODELS, XPMP_CFG_ITM_REPLTEXTURE, bObjReplTextures) != 0;
     
+    // Ask for load-aware model matching
+    bMatchPreferLoaded = prefsFuncInt(XPMP_CFG_SEC_MODELS, XPMP_CFG_ITM_MATCHLOADED, bMatchPreferLoaded) != 0;
+    bMatchProgressive = prefsFuncInt(XPMP_CFG_SEC_MODELS, XPMP_CFG_ITM_MATCHPROGRESS, bMatchProgressive) != 0;
+    
+    // Ask for watching CSL folders
+    bWatchCSL = prefsFuncInt(XPMP_CFG_SEC_MODELS, XPMP_CFG_ITM_WATCHCSL, bWatchCSL) != 0;
+    WatchUpdate();
+    
+    // Ask for sharing the CSL catalog with other plugins
+    bSharedCatalog = prefsFuncInt(XPMP_CFG_SEC_MODELS, XPMP_CFG_ITM_SHAREDCAT, bSharedCatalog) != 0;
+    
     // Ask for clam-to-ground config
     bClampAll = prefsFuncInt(XPMP_CFG_SEC_PLANES, XPMP_CFG_ITM_CLAMPALL, bClampAll) != 0;
 
     // Ask for handling of duplicate XPMP2::Aircraft::modeS_id
     bHandleDupId = prefsFuncInt(XPMP_CFG_SEC_PLANES, XPMP_CFG_ITM_HANDLE_DUP_ID, bHandleDupId) != 0;
 
+    // Ask for a cap on rendered aircraft
+    maxRenderedAc = std::max(prefsFuncInt(XPMP_CFG_SEC_PLANES, XPMP_CFG_ITM_MAXRENDERED, maxRenderedAc), 0);
+
+    // Ask for a target frame time for the quality governor
+    frameTimeTarget = std::max(prefsFuncInt(XPMP_CFG_SEC_PLANES, XPMP_CFG_ITM_FRAMETIME, frameTimeTarget), 0);
+
     // Ask for model matching logging
     bLogMdlMatch = prefsFuncInt(XPMP_CFG_SEC_DEBUG, XPMP_CFG_ITM_MODELMATCHING, bLogMdlMatch) != 0;
     
+    // Ask for profiling startup
+    bProfileStartup = prefsFuncInt(XPMP_CFG_SEC_DEBUG, XPMP_CFG_ITM_PROFILESTARTUP, bProfileStartup) != 0;
+    
+    // Ask for cost attribution
+    bCostAttribution = prefsFuncInt(XPMP_CFG_SEC_DEBUG, XPMP_CFG_ITM_COSTATTR, bCostAttribution) != 0;
+    
 }
 
 // Read version numbers into verXplane/verXPLM
@@ -134,6 +157,15 @@ bool IsDir (const std::string& path)
     return S_ISDIR(buffer.st_mode);         // check for S_IFDIR mode flag
 }
 
+// Last modification time of a file or directory
+time_t GetFileModTime (const std::string& path)
+{
+    struct stat buffer;
+    if (stat (path.c_str(), &buffer) != 0)  // get stats...error?
+        return 0;
+    return buffer.st_mtime;
+}
+
 // Create directory if it does not exist
 bool CreateDir(const std::string& path)
 {
@@ -232,6 +264,80 @@ std::list<std::string> GetDirContents (const std::string& path)
     return l;
 }
 
+//
+// MARK: Directory listing cache
+//
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wexit-time-destructors"
+#pragma clang diagnostic ignored "-Wglobal-constructors"
+/// Cached directory listings: POSIX directory path -> names of entries in that directory
+static std::unordered_map<std::string, std::unordered_set<std::string> > gMapDirCache;
+#pragma clang diagnostic pop
+static unsigned long gDirCacheHits = 0;     ///< existence checks answered from the cache
+static unsigned long gDirCacheStats = 0;    ///< existence checks, which needed a `stat` call
+
+/// Is the directory cache currently active?
+static bool gbDirCache = false;
+
+// Start caching directory listings
+void DirCacheBegin ()
+{
+    gMapDirCache.clear();
+    gDirCacheHits = gDirCacheStats = 0;
+    gbDirCache = true;
+}
+
+// Add an already available directory listing to the cache
+void DirCacheAdd (const std::string& path, const std::list<std::string>& files)
+{
+    if (gbDirCache)
+        gMapDirCache[TOPOSIX(path)] = std::unordered_set<std::string>(files.cbegin(), files.cend());
+}
+
+// Stop caching and release all cached listings
+void DirCacheEnd ()
+{
+    if (gbDirCache) {
+        LOG_MSG(logDEBUG, "Directory cache: %lu directories listed, %lu lookups answered from cache, %lu needed stat",
+                (unsigned long)gMapDirCache.size(), gDirCacheHits, gDirCacheStats);
+    }
+    gMapDirCache.clear();
+    gbDirCache = false;
+}
+
+/// @details Splits `filename` into directory and file name. The directory is
+///          listed once (and kept in the cache until DirCacheEnd()),
+///          the file name is then looked up in that listing.
+///          Only positive answers are taken from the cache: On a miss
+///          (file created in the meantime, differences in case on
+///          case-insensitive file systems, hidden files) we still `stat`.
+bool ExistsFileCached (const std::string& filename)
+{
+    if (gbDirCache) {
+        const std::string::size_type pos = filename.find_last_of("/\\");
+        if (pos != std::string::npos && pos > 0) {
+            const std::string dir = filename.substr(0, pos);
+            auto iter = gMapDirCache.find(dir);
+            if (iter == gMapDirCache.end()) {
+                // not yet cached: list the directory now, once
+                const std::list<std::string> files = GetDirContents(FROMPOSIX(dir));
+                ProfileFile();
+                iter = gMapDirCache.emplace(dir, std::unordered_set<std::string>(files.cbegin(), files.cend())).first;
+            }
+            if (iter->second.count(filename.substr(pos+1)) > 0) {
+                ++gDirCacheHits;
+                return true;
+            }
+        }
+        ++gDirCacheStats;
+    }
+    
+    // fallback: ask the file system directly
+    ProfileFile();
+    return ExistsFile(filename);
+}
+
 /// @details Read a text line, handling both Windows (CRLF) and Unix (LF) ending
 /// Code makes use of the fact that in both cases LF is the terminal character.
 /// So we read from file until LF (_without_ widening!).
@@ -59,6 +59,9 @@ bool ExistsFile (const std::string& filename);
 /// Is path a directory?
 bool IsDir (const std::string& path);
 
+/// Last modification time of a file or directory, `0` if it doesn't exist
+time_t GetFileModTime (const std::string& path);
+
 /// @brief Create directory if it does not exist
 /// @return Does directory (now) exist?
 bool CreateDir(const std::string& path);
@@ -70,6 +73,17 @@ bool CopyFileIfNewer(const std::string& source, const std::string& destDir);
 /// List of files in a directory (wrapper around XPLMGetDirectoryContents)
 std::list<std::string> GetDirContents (const std::string& path);
 
+/// @brief Start caching directory listings for ExistsFileCached()
+/// @details Used while loading CSL packages, where thousands of files are
+///          tested for existence, to replace one `stat` per file with one listing per directory
+void DirCacheBegin ();
+/// Add an already read directory listing (as returned by GetDirContents()) to the cache
+void DirCacheAdd (const std::string& path, const std::list<std::string>& files);
+/// Stop caching and release all cached directory listings
+void DirCacheEnd ();
+/// Does a file path exist? Answered from cached directory listings if caching is active, falls back to ExistsFile()
+bool ExistsFileCached (const std::string& filename);
+
 /// Read a line from a text file, no matter if ending on CRLF or LF
 std::istream& safeGetline(std::istream& is, std::string& t);
 
@@ -162,6 +176,88 @@ inline float angleLocCoord (float x1, float z1, float x2, float z2)
 /// (Shortest) difference between 2 angles: How much to turn to go from h1 to h2?
 float headDiff (float head1, float head2);
 
+//
+// MARK: Containers
+//
+
+/// @brief Vector-like container, which keeps up to `N` elements inline
+/// @details Only if more than `N` elements are stored the data moves to the heap.
+///          Elements are always stored contiguously, so that data() can be
+///          passed on as an array, e.g. to `XPLMInstanceSetPosition`.
+///          Provides the subset of the `std::vector` interface needed
+///          for short-lived arrays in the per-frame path, which then don't allocate.
+/// @note Only for trivially copyable types like `float` or pointers
+template<class T, size_t N>
+class SmallVecTy {
+    static_assert(std::is_trivially_copyable<T>::value, "SmallVecTy requires trivially copyable types");
+protected:
+    T       inl[N];                 ///< inline storage
+    T*      pData = inl;            ///< points to either `inl` or heap storage
+    size_t  nSize = 0;              ///< number of elements in use
+    size_t  nCap  = N;              ///< number of elements available in `pData`
+public:
+    /// Standard constructor creates an empty container
+    SmallVecTy () {}
+    /// Creates `n` elements with value `val`
+    SmallVecTy (size_t n, const T& val) { resize(n, val); }
+    /// Copy constructor
+    SmallVecTy (const SmallVecTy& o) { assign(o.begin(), o.end()); }
+    /// Copy assignment
+    SmallVecTy& operator = (const SmallVecTy& o) { if (this != &o) assign(o.begin(), o.end()); return *this; }
+    /// Destructor frees heap storage if any
+    ~SmallVecTy () { if (pData != inl) delete[] pData; }
+
+    size_t size () const                { return nSize; }           ///< number of elements
+    bool empty () const                 { return nSize == 0; }      ///< no elements?
+    size_t capacity () const            { return nCap; }            ///< number of elements that fit without reallocation
+    bool IsInline () const              { return pData == inl; }    ///< is data stored inline, ie. not on the heap?
+    T* data ()                          { return pData; }           ///< pointer to contiguous data
+    const T* data () const              { return pData; }           ///< pointer to contiguous data
+    T& operator [] (size_t i)           { return pData[i]; }        ///< element access (unchecked)
+    const T& operator [] (size_t i) const { return pData[i]; }      ///< element access (unchecked)
+    T& back ()                          { return pData[nSize-1]; }  ///< last element
+    T* begin ()                         { return pData; }           ///< iterator to first element
+    T* end ()                           { return pData + nSize; }   ///< iterator beyond last element
+    const T* begin () const             { return pData; }           ///< iterator to first element
+    const T* end () const               { return pData + nSize; }   ///< iterator beyond last element
+
+    /// Ensures capacity for at least `n` elements, moves to the heap if needed
+    void reserve (size_t n)
+    {
+        if (n <= nCap) return;
+        T* p = new T[n];
+        std::copy(begin(), end(), p);
+        if (pData != inl) delete[] pData;
+        pData = p;
+        nCap = n;
+    }
+    /// Change the number of elements, new elements receive `val`
+    void resize (size_t n, const T& val = T())
+    {
+        reserve(n);
+        std::fill(pData + std::min(n, nSize), pData + n, val);
+        nSize = n;
+    }
+    /// Replace content with the given range
+    void assign (const T* first, const T* last)
+    {
+        nSize = 0;
+        reserve(size_t(last - first));
+        std::copy(first, last, pData);
+        nSize = size_t(last - first);
+    }
+    /// Add an element at the end
+    void push_back (const T& val)
+    {
+        if (nSize == nCap) reserve(2 * nCap);
+        pData[nSize++] = val;
+    }
+    /// Remove the last element
+    void pop_back ()                    { --nSize; }
+    /// Remove all elements (capacity is kept)
+    void clear ()                       { nSize = 0; }
+};
+
 //
 // MARK: Misc
 //
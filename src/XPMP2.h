@@ -48,16 +48,24 @@
 // Standard C++
 #include <string>
 #include <list>
+#include <deque>
 #include <map>
+#include <unordered_set>
+#include <unordered_map>
 #include <array>
 #include <vector>
 #include <valarray>
 #include <algorithm>
 #include <numeric>
+#include <limits>
 #include <fstream>
 #include <regex>
 #include <bitset>
 #include <future>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <type_traits>
 
 // XPlaneMP 2 - Internal Header Files
 #include "Utilities.h"
@@ -67,6 +75,17 @@
 #include "2D.h"
 #include "AIMultiplayer.h"
 #include "Map.h"
+#include "Scene.h"
+#include "LOD.h"
+#include "Governor.h"
+#include "Cost.h"
+#include "Alloc.h"
+#include "Snapshot.h"
+#include "Record.h"
+#include "CSLWatch.h"
+#include "CSLCache.h"
+#include "Rematch.h"
+#include "Profile.h"
 
 // On Windows, 'max' and 'min' are defined macros in conflict with C++ library. Let's undefine them!
 #if IBM
@@ -97,9 +116,26 @@ struct XPMPPlaneNotifierTy {
 
 typedef std::list<XPMPPlaneNotifierTy> listXPMPPlaneNotifierTy;
 
-/// Send a notification to all observers
+/// Stores the function and refcon pointer for batched notifications
+struct XPMPPlaneNotifierBatchTy {
+    XPMPPlaneNotifierBatch_f    func    = nullptr;
+    void*                       refcon  = nullptr;
+    
+    XPMPPlaneNotifierBatchTy (XPMPPlaneNotifierBatch_f _func = nullptr, void* _refcon = nullptr) :
+    func(_func), refcon(_refcon) {}
+    
+    bool operator == (const XPMPPlaneNotifierBatchTy& o)
+    { return func == o.func && refcon == o.refcon; }
+};
+
+typedef std::list<XPMPPlaneNotifierBatchTy> listXPMPPlaneNotifierBatchTy;
+
+/// Send a notification to all observers (and queue it for batch observers)
 void XPMPSendNotification (const Aircraft& plane, XPMPPlaneNotification _notification);
 
+/// Deliver all queued notifications to batch observers, called once per frame
+void XPMPFlushNotifications ();
+
 /// All global config settings and variables are kept in one structure for convenient access and central definition
 struct GlobVars {
 public:
@@ -108,15 +144,31 @@ public:
     logLevelTy      logLvl      = logINFO;
     /// Debug model matching?
     bool            bLogMdlMatch= false;
+    /// Profile startup phases and CSL package loading?
+    bool            bProfileStartup = false;
+    /// Sample time spent per aircraft, aircraft class, and model?
+    bool            bCostAttribution = false;
     /// Clamp all planes to the ground? Default is `false` as clamping is kinda expensive due to Y-Testing.
     bool            bClampAll   = false;
     /// Handle duplicate XPMP2::Aircraft::modeS_id by overwriting with unique id
     bool            bHandleDupId= false;
+    /// Maximum number of aircraft rendered, `0` = unlimited
+    int             maxRenderedAc = 0;
+    /// Target frame time for the quality governor [ms], `0` = off
+    int             frameTimeTarget = 0;
     
     /// Replace dataRefs in `.obj` files on load? (defaults to OFF!)
     bool            bObjReplDataRefs = false;
     /// Replace textures in `.obj` files on load if needed?
     bool            bObjReplTextures = true;
+    /// Model matching: Prefer already loaded models among equally good matches?
+    bool            bMatchPreferLoaded = false;
+    /// Model matching: Show a loaded lesser match first, switch to the best match once it is loaded?
+    bool            bMatchProgressive = false;
+    /// Watch loaded CSL folders for changes and reload changed packages?
+    bool            bWatchCSL = false;
+    /// Share the parsed CSL catalog with other plugins via a cache file?
+    bool            bSharedCatalog = false;
     /// Path to the `Obj8DataRefs.txt` file
     std::string     pathObj8DataRefs;
     /// List of dataRef replacement in `.obj` files
@@ -131,6 +183,8 @@ public:
     int (*prefsFuncInt)(const char *, const char *, int) = XPMP2::PrefsFuncIntDefault;
     /// List of notifier functions registered for being notified of creation/destruction/model change
     listXPMPPlaneNotifierTy listObservers;
+    /// List of notifier functions registered for being notified once per frame with a batch of events
+    listXPMPPlaneNotifierBatchTy listBatchObservers;
     
     /// Path to Doc8643.txt file
     std::string     pathDoc8643;
@@ -143,8 +197,8 @@ public:
 
     /// Global map of all CSL Packages, indexed by `xsb_aircraft.txt::EXPORT_NAME`
     mapCSLPackageTy mapCSLPkgs;
-    /// Global map of all CSL Models, indexed by related group, aircraft type, and model id
-    mapCSLModelTy   mapCSLModels;
+    /// Global catalog of all CSL Models, indexed by related group, aircraft type, and model id
+    CSLCatalogTy    catCSLModels;
     /// Default ICAO aircraft type designator if no match can be found
     std::string     defaultICAO = "A320";
     /// Ground vehicle type identifier (map decides icon based on this)
@@ -157,7 +157,11 @@ const char *    XPMPMultiplayerInit(const char* inPluginName,
     glob.UpdateCfgVals();
 
     // Look for all supplemental files
-    const char* ret = XPMPValidateResourceFiles(resourceDir);
+    const char* ret = nullptr;
+    {
+        ProfilePhase prof("XPMPValidateResourceFiles");
+        ret = XPMPValidateResourceFiles(resourceDir);
+    }
     if (ret[0]) return ret;
     
     // Define the default ICAO aircraft type
@@ -171,16 +175,25 @@ const char *    XPMPMultiplayerInit(const char* inPluginName,
     MapInit();
     
     // Load related.txt
-    ret = RelatedLoad(glob.pathRelated);
+    {
+        ProfilePhase prof("RelatedLoad");
+        ret = RelatedLoad(glob.pathRelated);
+    }
     if (ret[0]) return ret;
 
     // Load Doc8643.txt
-    ret = Doc8643Load(glob.pathDoc8643);
+    {
+        ProfilePhase prof("Doc8643Load");
+        ret = Doc8643Load(glob.pathDoc8643);
+    }
     if (ret[0]) return ret;
     
     // If available (it is not required) load the Obj8DataRefs.txt file
     if (!glob.pathObj8DataRefs.empty()) {
-        ret = Obj8DataRefsLoad(glob.pathObj8DataRefs);
+        {
+            ProfilePhase prof("Obj8DataRefsLoad");
+            ret = Obj8DataRefsLoad(glob.pathObj8DataRefs);
+        }
         if (ret[0]) return ret;
     }
 
@@ -203,14 +216,25 @@ void XPMPMultiplayerCleanup()
     LOG_MSG(logINFO, "XPMP2 cleaning up...")
 
     // Cleanup all modules in revers order of initialization
+    WatchCleanup();
+    RematchCleanup();
+    RecordCleanup();
+    SnapshotCleanup();
+    SceneCleanup();
+    CostCleanup();
+    GovCleanup();
+    LODCleanup();
     MapCleanup();
     AIMultiCleanup();
     TwoDCleanup();
     AcCleanup();
     CSLModelsCleanup();
+    ProfileCleanup();
     
     // Unregister all notification callbacks
     glob.listObservers.clear();
+    glob.listBatchObservers.clear();
+    XPMPFlushNotifications();                   // effectively just drops queued events
 }
 
 // OBJ7 is not supported
@@ -229,7 +253,14 @@ const char *    XPMPLoadCSLPackage(const char * inCSLFolder)
     // Do load the CSL Models in the given path
     if (inCSLFolder) {
         LOG_MSG(logINFO, INFO_LOAD_CSL_PACKAGE, StripXPSysDir(inCSLFolder).c_str());
-        return CSLModelsLoad(inCSLFolder);
+        const char* ret = nullptr;
+        {
+            ProfilePhase prof("XPMPLoadCSLPackage", inCSLFolder);
+            ret = CSLModelsLoad(inCSLFolder);
+        }
+        if (glob.bProfileStartup)
+            ProfileReport();
+        return ret;
     }
     else
         return "<nullptr> provided";
@@ -242,35 +273,22 @@ void            XPMPLoadPlanesIfNecessary()
 // returns the number of found models
 int XPMPGetNumberOfInstalledModels()
 {
-    return (int)glob.mapCSLModels.size();
+    return (int)glob.catCSLModels.size();
 }
 
 // return model info (unsafe)
 void XPMPGetModelInfo(int inIndex, const char **outModelName, const char **outIcao, const char **outAirline, const char **outLivery)
 {
     // sanity check: index too high?
-    if (inIndex >= XPMPGetNumberOfInstalledModels()) {
-        LOG_MSG(logDEBUG, "inIndex %d too high, have only %d models",
+    if (inIndex < 0 || inIndex >= XPMPGetNumberOfInstalledModels()) {
+        LOG_MSG(logDEBUG, "inIndex %d out of range, have only %d models",
                 inIndex, (int)XPMPGetNumberOfInstalledModels());
         return;
     }
     
-    // get the inIndex-th model
-    mapCSLModelTy::const_iterator iterMdl = glob.mapCSLModels.cbegin();
-    std::advance(iterMdl, inIndex);
-#if IBM
-#pragma warning(push)
-    // I don't know why, but in this function, and only in this, MS warns about throwing an exception
-#pragma warning(disable: 4297)
-#endif
-    LOG_ASSERT(iterMdl != glob.mapCSLModels.cend());
-#if IBM
-#pragma warning(pop)
-#endif
-
     // Copy string pointers back. We just pass back pointers into our CSL Model object
     // as we can assume that the CSL Model object exists quite long.
-    const CSLModel& csl = iterMdl->second;
+    const CSLModel& csl = glob.catCSLModels[size_t(inIndex)];
     if (outModelName)   *outModelName   = csl.GetId().data();
     if (outIcao)        *outIcao        = csl.GetIcaoType().data();
     if (outAirline)     *outAirline     = csl.GetIcaoAirline().data();
@@ -281,27 +299,14 @@ void XPMPGetModelInfo(int inIndex, const char **outModelName, const char **outIc
 void XPMPGetModelInfo2(int inIndex, std::string& outModelName,  std::string& outIcao, std::string& outAirline, std::string& outLivery)
 {
     // sanity check: index too high?
-    if (inIndex >= XPMPGetNumberOfInstalledModels()) {
-        LOG_MSG(logDEBUG, "inIndex %d too high, have only %d models",
+    if (inIndex < 0 || inIndex >= XPMPGetNumberOfInstalledModels()) {
+        LOG_MSG(logDEBUG, "inIndex %d out of range, have only %d models",
                 inIndex, (int)XPMPGetNumberOfInstalledModels());
         return;
     }
     
-    // get the inIndex-th model
-    mapCSLModelTy::const_iterator iterMdl = glob.mapCSLModels.cbegin();
-    std::advance(iterMdl, inIndex);
-#if IBM
-#pragma warning(push)
-    // I don't know why, but in this function, and only in this, MS warns about throwing an exception
-#pragma warning(disable: 4297)
-#endif
-    LOG_ASSERT(iterMdl != glob.mapCSLModels.cend());
-#if IBM
-#pragma warning(pop)
-#endif
-
     // Copy strings into provided buffers
-    const CSLModel& csl = iterMdl->second;
+    const CSLModel& csl = glob.catCSLModels[size_t(inIndex)];
     outModelName = csl.GetId();
     outIcao      = csl.GetIcaoType();
     outAirline   = csl.GetIcaoAirline();
@@ -550,15 +555,131 @@ void            XPMPUnregisterPlaneNotifierFunc(XPMPPlaneNotifier_f     inFunc,
     }
 }
 
+/*
+ * XPMPRegisterPlaneNotifierBatchFunc
+ *
+ * This function registers a notifier function, which receives all events once per frame.
+ *
+ */
+void            XPMPRegisterPlaneNotifierBatchFunc(XPMPPlaneNotifierBatch_f  inFunc,
+                                                   void *                    inRefcon)
+{
+    // Avoid duplicate entries
+    XPMPPlaneNotifierBatchTy observer (inFunc, inRefcon);
+    if (std::find(glob.listBatchObservers.begin(),
+                  glob.listBatchObservers.end(),
+                  observer) == glob.listBatchObservers.end()) {
+        glob.listBatchObservers.emplace_back(std::move(observer));
+        LOG_MSG(logDEBUG, "%lu batch observers registered",
+                (unsigned long)glob.listBatchObservers.size());
+    }
+}
+
+/*
+ * XPMPUnregisterPlaneNotifierBatchFunc
+ *
+ * This function cancels a registration for a batched notifier function.
+ */
+void            XPMPUnregisterPlaneNotifierBatchFunc(XPMPPlaneNotifierBatch_f inFunc,
+                                                     void *                   inRefcon)
+{
+    auto iter = std::find(glob.listBatchObservers.begin(),
+                          glob.listBatchObservers.end(),
+                          XPMPPlaneNotifierBatchTy (inFunc, inRefcon));
+    if (iter != glob.listBatchObservers.cend()) {
+        glob.listBatchObservers.erase(iter);
+        LOG_MSG(logDEBUG, "%lu batch observers registered",
+                (unsigned long)glob.listBatchObservers.size());
+    }
+}
+
 namespace XPMP2 {
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wexit-time-destructors"
+/// Events queued for batch observers, delivered once per frame
+static std::vector<XPMPPlaneNotificationEvent_t> gVecNotifQueue;
+#pragma clang diagnostic pop
+
+/// Queue an event for batch observers, cancelling out create/destroy pairs of the same frame
+static void XPMPQueueNotification (XPMPPlaneID _id, XPMPPlaneNotification _notification)
+{
+    switch (_notification) {
+        case xpmp_PlaneNotification_Destroyed:
+        {
+            // Was the plane created in this very frame? Then nobody needs to know about it at all
+            auto iterCreated =
+            std::find_if(gVecNotifQueue.rbegin(), gVecNotifQueue.rend(),
+                         [_id](const XPMPPlaneNotificationEvent_t& e)
+                         { return e.planeId == _id &&
+                                  e.notification != xpmp_PlaneNotification_ModelChanged; });
+            if (iterCreated != gVecNotifQueue.rend() &&
+                iterCreated->notification == xpmp_PlaneNotification_Created)
+            {
+                // remove the creation and all later events of this plane
+                const auto iterFirst = std::prev(iterCreated.base());
+                gVecNotifQueue.erase(std::remove_if(iterFirst, gVecNotifQueue.end(),
+                                                    [_id](const XPMPPlaneNotificationEvent_t& e)
+                                                    { return e.planeId == _id; }),
+                                     gVecNotifQueue.end());
+                return;
+            }
+            break;
+        }
+        case xpmp_PlaneNotification_ModelChanged:
+        {
+            // Report a model change only once per frame
+            auto iterLast =
+            std::find_if(gVecNotifQueue.crbegin(), gVecNotifQueue.crend(),
+                         [_id](const XPMPPlaneNotificationEvent_t& e)
+                         { return e.planeId == _id; });
+            if (iterLast != gVecNotifQueue.crend() &&
+                iterLast->notification == xpmp_PlaneNotification_ModelChanged)
+                return;
+            break;
+        }
+        case xpmp_PlaneNotification_Created:
+            break;
+    }
+    gVecNotifQueue.push_back({_id, _notification});
+}
+
 // Send a notification to all observers
 void XPMPSendNotification (const Aircraft& plane, XPMPPlaneNotification _notification)
 {
+    RecordAcEvent(plane, _notification);
+    
     for (const XPMPPlaneNotifierTy& n: glob.listObservers)
         n.func(plane.GetModeS_ID(),
                _notification,
                n.refcon);
+    
+    // Batch observers get informed later
+    if (!glob.listBatchObservers.empty())
+        XPMPQueueNotification(plane.GetModeS_ID(), _notification);
 }
+
+// Deliver all queued notifications to batch observers, called once per frame
+void XPMPFlushNotifications ()
+{
+    if (gVecNotifQueue.empty())
+        return;
+    
+    // Swap into a local vector first: Observers might create or destroy planes
+    std::vector<XPMPPlaneNotificationEvent_t> vecEvents;
+    vecEvents.swap(gVecNotifQueue);
+    for (const XPMPPlaneNotifierBatchTy& n: glob.listBatchObservers)
+        n.func(vecEvents.data(),
+               (int)vecEvents.size(),
+               n.refcon);
+    
+    // Return the (cleared) buffer for reuse, unless new events came in meanwhile
+    if (gVecNotifQueue.empty()) {
+        vecEvents.clear();
+        vecEvents.swap(gVecNotifQueue);
+    }
+}
+
 }
 
 